@@ -7,42 +7,315 @@
  * Assignment #6.
  */
 #include <cctype>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <string>
+#include <thread>
+#include <unistd.h>
+#include "analysis.h"
 #include "exp.h"
 #include "parser.h"
 #include "program.h"
+#include "profile.h"
+#include "arena.h"
+#include "image.h"
+#include "server.h"
 #include "../StanfordCPPLib/error.h"
 #include "../StanfordCPPLib/tokenscanner.h"
 #include "../StanfordCPPLib/simpio.h"
 #include "../StanfordCPPLib/strlib.h"
 using namespace std;
 
+/*
+ * Type: SessionOptions
+ * --------------------
+ * The limits a session runs under, as given on the command line; a
+ * limit of 0 means none.
+ */
+
+struct SessionOptions {
+   int callDepth;          /* how deep GOSUB may nest            */
+   long long stepLimit;    /* see EvalState::setStepLimit        */
+   size_t memoryLimit;     /* bytes, see EvalState::setMemoryLimit */
+   bool interactive;       /* flush after every line of output   */
+   bool fileAccess;        /* see EvalState::setFileAccess       */
+};
+
 /* Function prototypes */
 
-void processLine(string line, Program & program, EvalState & state);
+void runSession(istream & in, ostream & os, const SessionOptions & options);
+bool processLine(string line, Program & program, EvalState & state);
+void runProfile(Program & program, EvalState & state);
+void saveImage(string filename, Program & program);
+void loadImage(string filename, Program & program, EvalState & state);
+Bytecode & compileProgram(Program & program, EvalState & state);
+int runBatch(const char *programFile, const char *inputFile, const SessionOptions & options);
+bool readWholeFile(const char *path, string & text);
+Statement *newStatement(string token, string line);
+Statement *parseStatement(string token, string line, Arena *arena);
+
+/*
+ * Main program
+ * ------------
+ * Usage: Basic [options]                          (interactive)
+ *        Basic [options] prog.bas [input-file]    (batch)
+ *        Basic [options] -s socket-path           (server)
+ *        Basic [options] -j job-directory         (server)
+ * With no arguments the interpreter reads commands from cin until
+ * QUIT or the end of the input.  Given a program file it loads, runs
+ * and exits; see runBatch for the exit status.  The server modes run
+ * one session per connection or job file on a pool of threads; see
+ * Server.  The options are
+ *
+ *   -d depth    how deep GOSUB may nest (Bytecode::DEFAULT_CALL_DEPTH)
+ *   -l steps    the step budget of a session
+ *   -m MB       the memory cap of a session: its program, variables and
+ *               arrays, and in a server the input of a session as well
+ *   -w workers  the number of server threads (one per core)
+ *
+ * The interpreter has no limits by default, a server session has
+ * SERVER_STEP_LIMIT steps and SERVER_MEMORY_MB megabytes, and cannot
+ * SAVE or LOAD.
+ */
 
-/* Main program */
+static const long long SERVER_STEP_LIMIT = 100000000;
+static const size_t SERVER_MEMORY_MB = 64;
 
-int main() {
+static int usage(const char *name) {
+   cerr << "usage: " << name << " [-d depth] [-l steps] [-m MB] [-w workers]"
+        << " [program-file [input-file] | -s socket-path | -j job-directory]" << endl;
+   return 2;
+}
+
+int main(int argc, char **argv) {
+   SessionOptions options = { Bytecode::DEFAULT_CALL_DEPTH, -1, 0, false, true };
+   long long memoryMB = -1;
+   int workers = thread::hardware_concurrency();
+   string socketPath, jobDirectory;
+   int c;
+   opterr = 0;
+   while ((c = getopt(argc, argv, "d:l:m:w:s:j:")) != -1) {
+      switch (c) {
+      case 'd': options.callDepth = atoi(optarg); if (options.callDepth < 1) return usage(argv[0]); break;
+      case 'l': options.stepLimit = atoll(optarg); if (options.stepLimit < 0) return usage(argv[0]); break;
+      case 'm': memoryMB = atoll(optarg); if (memoryMB < 0) return usage(argv[0]); break;
+      case 'w': workers = atoi(optarg); if (workers < 1) return usage(argv[0]); break;
+      case 's': socketPath = optarg; break;
+      case 'j': jobDirectory = optarg; break;
+      default: return usage(argv[0]);
+      }
+   }
+   bool serving = !socketPath.empty() || !jobDirectory.empty();
+   if (argc - optind > (serving ? 0 : 2) || (!socketPath.empty() && !jobDirectory.empty())) {
+      return usage(argv[0]);
+   }
+   if (options.stepLimit < 0) options.stepLimit = serving ? SERVER_STEP_LIMIT : 0;
+   if (memoryMB < 0) memoryMB = serving ? SERVER_MEMORY_MB : 0;
+   options.memoryLimit = memoryMB << 20;
+   options.fileAccess = !serving;
+   ios::sync_with_stdio(false);   //lets cin read the input in blocks
+   if (serving) {
+      Server server(workers, [&options](istream & in, ostream & os) {
+         runSession(in, os, options);
+      });
+      server.setInputLimit(options.memoryLimit);
+      if (!socketPath.empty()) return server.serveSocket(socketPath);
+      return server.serveDirectory(jobDirectory);
+   }
+   if (argc > optind) {
+      return runBatch(argv[optind], (argc > optind + 1) ? argv[optind + 1] : NULL, options);
+   }
+   options.interactive = isatty(0);   //a user at a terminal sees each line at once
+   runSession(cin, cout, options);
+   return 0;
+}
+
+/*
+ * Function: runSession
+ * Usage: runSession(in, os, options);
+ * -----------------------------------
+ * Runs one interpreter on its own: commands and the values for INPUT
+ * come from in, everything the session prints goes to os, until QUIT
+ * or the end of in.  All the state is local, down to the table the
+ * variable names are interned in, so any number of sessions can run at
+ * once on different threads.
+ *
+ * Output is flushed whenever the session is about to wait for its next
+ * command, so a client on a socket sees the reply to LIST or HELP
+ * before it has to send anything more; a script piped in all at once
+ * still has its output written in large blocks.
+ */
+
+void runSession(istream & in, ostream & os, const SessionOptions & options) {
+   OutputSink out(os);
+   out.setInteractive(options.interactive);
    EvalState state;
+   state.setInput(in);
+   state.setOutput(out);
+   state.setStepLimit(options.stepLimit);
+   state.setMemoryLimit(options.memoryLimit);
+   state.setFileAccess(options.fileAccess);
+   SymbolScope scope(state.getSymbols());
    Program program;
+   program.getBytecode().setCallDepth(options.callDepth);
   // cout << "Stub implementation of BASIC" << endl;
-   while (true) {
+   string line;
+   while (getline(in, line)) {
       try {
-         processLine(getLine(), program, state);    //processing the every input line
+         if (!processLine(line, program, state)) break;    //processing the every input line
+         if (in.rdbuf()->in_avail() <= 0) out.flush();     //nothing more to read yet
       } catch (ErrorException & ex) {
-         cout << ex.getMessage() << endl;   //show the five types of errors
+         out.writeLine(ex.getMessage());   //show the five types of errors
+         out.flush();
       }
    }
-    return 0;
+   out.flush();
 }
 
 /*
- * Function: processLine
- * Usage: processLine(line, program, state);
+ * Function: readWholeFile
+ * Usage: if (readWholeFile(path, text)) ...
  * -----------------------------------------
- * Processes a single line entered by the user.  In this version,
+ * Reads the whole file into text with a single read, returning false
+ * if it cannot be opened.
+ */
+
+bool readWholeFile(const char *path, string & text) {
+   ifstream file(path, ios::in | ios::binary);
+   if (!file) return false;
+   file.seekg(0, ios::end);
+   streamoff size = file.tellg();
+   if (size < 0) return false;
+   text.resize(size);
+   file.seekg(0, ios::beg);
+   if (size > 0) file.read(&text[0], size);
+   return !file.fail();
+}
+
+/*
+ * Function: runBatch
+ * Usage: int status = runBatch(programFile, inputFile, options);
+ * --------------------------------------------------------------
+ * Loads every numbered line of programFile in one pass, runs the
+ * program with INPUT reading from inputFile (cin if NULL) under the
+ * limits in options, and returns the exit status:
+ *
+ *   0  the program ran to its end
+ *   1  the program stopped with an error, printed as RUN would
+ *   2  a file could not be read, or a line is not a valid numbered
+ *      statement (reported on cerr with its position in the file)
+ */
+
+int runBatch(const char *programFile, const char *inputFile, const SessionOptions & options) {
+   string text;
+   if (!readWholeFile(programFile, text)) {
+      cerr << programFile << ": cannot read file" << endl;
+      return 2;
+   }
+   ifstream input;
+   EvalState state;
+   SymbolScope scope(state.getSymbols());
+   Program program;
+   state.setStepLimit(options.stepLimit);
+   state.setMemoryLimit(options.memoryLimit);
+   if (inputFile != NULL) {
+      input.open(inputFile);
+      if (!input) {
+         cerr << inputFile << ": cannot read file" << endl;
+         return 2;
+      }
+      state.setInput(input);
+   }
+   int fileLine = 0;
+   size_t start = 0;
+   while (start < text.size()) {
+      size_t end = text.find('\n', start);
+      if (end == string::npos) end = text.size();
+      string line = text.substr(start, end - start);
+      if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+      start = end + 1;
+      fileLine++;
+      try {
+         Lexer lexer;
+         lexer.ignoreWhitespace();
+         lexer.scanNumbers();
+         lexer.setInput(line);
+         if (!lexer.hasMoreTokens()) continue;
+         if (lexer.next().type != NUMBER) error("SYNTAX ERROR");
+         processLine(line, program, state);
+      } catch (ErrorException & ex) {
+         cerr << programFile << ":" << fileLine << ": " << ex.getMessage() << endl;
+         return 2;
+      }
+   }
+   try {
+      Bytecode & code = compileProgram(program, state);
+      code.setCallDepth(options.callDepth);
+      code.run(state);
+   } catch (ErrorException & ex) {
+      state.getOutput().writeLine(ex.getMessage());
+      state.getOutput().flush();
+      return 1;
+   }
+   return 0;
+}
+
+/*
+ * Function: newStatement
+ * Usage: Statement *stmt = newStatement(token, line);
+ * ---------------------------------------------------
+ * Creates the statement named by token from the rest of the line, or
+ * returns NULL if token names no statement.  The substring is supposed
+ * to omit the statement type.
+ */
+
+Statement *newStatement(string token, string line) {
+    line=line.substr(line.find(token)+token.size());
+    if (token=="LET") return new LetStmt(line);
+    if (token=="PRINT") return new PrintStmt(line);
+    if (token=="INPUT") return new InputStmt(line);
+    if (token=="REM") return new RemStmt(line);
+    if (token=="GOTO") return new GotoStmt(line);
+    if (token=="IF") return new IfStmt(line);
+    if (token=="END") return new EndStmt(line);
+    if (token=="DIM") return new DimStmt(line);
+    if (token=="FOR") return new ForStmt(line);
+    if (token=="NEXT") return new NextStmt(line);
+    if (token=="GOSUB") return new GosubStmt(line);
+    if (token=="RETURN") return new ReturnStmt(line);
+    return NULL;
+}
+
+/*
+ * Function: parseStatement
+ * Usage: Statement *stmt = parseStatement(token, line, arena);
+ * ------------------------------------------------------------
+ * Builds and checks a statement with everything it allocates placed in
+ * arena.  If the check fails, the statement is freed before the error
+ * goes on, and whatever the parser left behind stays in the arena for
+ * the caller to drop, so nothing leaks.
+ */
+
+Statement *parseStatement(string token, string line, Arena *arena) {
+    ArenaScope scope(arena);
+    Statement *stmt=newStatement(token,line);
+    if (stmt==NULL) error("SYNTAX ERROR");  //if token is not a valid statement type
+    try {
+        stmt->valid();
+    } catch (...) {
+        delete stmt;
+        throw;
+    }
+    return stmt;
+}
+
+/*
+ * Function: processLine
+ * Usage: if (!processLine(line, program, state)) . . .
+ * ----------------------------------------------------
+ * Processes a single line entered by the user, returning false if it
+ * was QUIT.  In this version,
  * the implementation does exactly what the interpreter program
  * does in Chapter 19: read a line, parse it as an expression,
  * and then print the result.In your implementation, you will
@@ -51,137 +324,245 @@ int main() {
  * or one of the BASIC commands, such as LIST or RUN.
  */
 
-void processLine(string line, Program & program, EvalState & state) {
+bool processLine(string line, Program & program, EvalState & state) {
    
-   TokenScanner scanner;
-   scanner.ignoreWhitespace();
-   scanner.scanNumbers();
-   scanner.setInput(line);
-   if (!scanner.hasMoreTokens()) return ;   //NUll line should be ignored
-   string token=scanner.nextToken();
-   TokenType tpye=scanner.getTokenType(token);
+   Lexer lexer;    //tokens are views into line,nothing is copied until needed
+   lexer.ignoreWhitespace();
+   lexer.scanNumbers();
+   lexer.setInput(line);
+   if (!lexer.hasMoreTokens()) return true;   //NUll line should be ignored
+   Token first=lexer.next();
+   string token=first.toString();
+   TokenType tpye=first.type;
    /*store the linenumber and the respective statement*/
     if (tpye==NUMBER) {
         int lineNumber=stringToInteger(token);       
-        program.addSourceLine(lineNumber,line);
-        if (!scanner.hasMoreTokens()) { //NULL statement are supposed to remove the line
+        if (!lexer.hasMoreTokens()) { //NULL statement are supposed to remove the line
         program.removeSourceLine(lineNumber);
-        return ;
+        state.setProgramBytes(program.getBytes());
+        return true;
         }
-        token=scanner.nextToken();
+        token=lexer.next().toString();
         /*
-         * seven types of statement shares the similar way to store
-         * substring is supposed to omit the statement type  
+         * twelve types of statement shares the similar way to store
          * the first check of validation of the statement is about the judgement of the form   
          * then store the statement and corresponding linenumber
+         * a line that fails the check leaves the old one untouched
+         * each line gets its own arena,which the program frees with the line
         */
-        if (token=="LET") {
-        line=line.substr(line.find("LET")+3);
-        Statement* stmt=new LetStmt(line);
-        if (stmt->valid()) program.setParsedStatement(lineNumber,stmt);
-        return ;
-        }
-        if (token=="PRINT") {
-        line=line.substr(line.find("PRINT")+5);
-        Statement* stmt=new PrintStmt(line);
-        if (stmt->valid())  program.setParsedStatement(lineNumber,stmt);
-        return ;
-        }
-        if (token=="INPUT") {
-        line=line.substr(line.find("INPUT")+5);
-        Statement* stmt=new InputStmt(line);
-        if (stmt->valid()) program.setParsedStatement(lineNumber,stmt);
-        return ;
-        }
-        if (token=="REM") {
-        line=line.substr(line.find("REM")+3);
-        Statement* stmt=new RemStmt(line);
-        if (stmt->valid()) program.setParsedStatement(lineNumber,stmt);
-        return ;
-        }
-        if (token=="GOTO") {
-        line=line.substr(line.find("GOTO")+4);
-        Statement* stmt=new GotoStmt(line);
-        if (stmt->valid()) program.setParsedStatement(lineNumber,stmt);
-        return ;
+        Arena *arena=new Arena();
+        Statement *stmt=NULL;
+        try {
+            stmt=parseStatement(token,line,arena);
+            state.setProgramBytes(program.getBytesWith(lineNumber,line,arena));   //a line over the cap is refused
+        } catch (...) {
+            delete stmt;
+            delete arena;
+            throw;
         }
-        if (token=="IF") {
-        line=line.substr(line.find("IF")+2);
-        Statement* stmt=new IfStmt(line);
-        if (stmt->valid()) program.setParsedStatement(lineNumber,stmt);
-        return ;
-        }
-        if (token=="END") {
-        line=line.substr(line.find("END")+3);
-        Statement* stmt=new EndStmt(line);
-        if (stmt->valid()) program.setParsedStatement(lineNumber,stmt);
-        return ;
-         }
-        error("SYNTAX ERROR");  //if token is not a valid statement type
+        program.addSourceLine(lineNumber,line);
+        program.setParsedStatement(lineNumber,stmt,arena);
+        return true;
     }
     /*
-     * 8 types of commands are processed distinctively
-     * 3 types of control statement are processed in the same way as shown above
+     * 11 types of commands are processed distinctively
+     * 4 types of control statement are processed in the same way as shown above
      */
-    if (token=="RUN"){
-        if (scanner.hasMoreTokens()) error("SYNTAX ERROR"); 
-        int lineNumber=program.getFirstLineNumber();
-        while (lineNumber!=-1) { //which means the program has run to the end
-            StatementType type=program.getParsedStatement(lineNumber)->getType();
-            if ((type==END)||(type==GOTO)||(type==IF)) {    //control statement is enabled to change the current linenumber
-                int copy=lineNumber;    //to judge whether the condition of  if statement is false  
-                program.getParsedStatement(lineNumber)->execute(state,lineNumber);
-                if (lineNumber==copy) lineNumber=program.getNextLineNumber(lineNumber);
-                }
-            else {program.getParsedStatement(lineNumber)->execute(state);   //just execute and go on the program
-            lineNumber=program.getNextLineNumber(lineNumber);
-            }
-            if ((program.getParsedStatement(lineNumber)==NULL)&&(lineNumber!=-1)) error("LINE NUMBER ERROR");   //wrong linenumber is given
+    if (token=="RUN"){  //run the compiled program on the bytecode machine
+        if (!lexer.hasMoreTokens()) {
+            compileProgram(program,state).run(state);
+            return true;
         }
-        return ;
+        token=lexer.next().toString();
+        if (token!="PROFILE") error("SYNTAX ERROR");
+    }
+    if (token=="PROFILE"){  //RUN PROFILE works too
+        if (lexer.hasMoreTokens()) error("SYNTAX ERROR");
+        runProfile(program,state);
+        return true;
+    }
+    if (token=="COMPILE"){  //show what RUN is going to execute
+        if (lexer.hasMoreTokens()) error("SYNTAX ERROR");
+        state.getOutput().write(compileProgram(program,state).toString());
+        return true;
+    }
+    if (token=="CHECK"){ //what can be told without running:dead lines,missing lines,undefined reads
+        if (lexer.hasMoreTokens()) error("SYNTAX ERROR");
+        state.getOutput().write(Analysis(program).toString());
+        return true;
+    }
+    if (token=="JIT"){  //JIT ON or JIT OFF switches the native tier of RUN
+        token=lexer.next().toString();
+        if (((token!="ON")&&(token!="OFF"))||lexer.hasMoreTokens()) error("SYNTAX ERROR");
+        program.getBytecode().setJitEnabled(token=="ON");
+        return true;
     }
     if (token=="LIST"){ //just list
-        if (scanner.hasMoreTokens()) error("SYNTAX ERROR");
-        int lineNumber=program.getFirstLineNumber();
-        while (lineNumber!=-1)
-        {
-            cout<<program.getSourceLine(lineNumber)<<endl;
-            lineNumber=program.getNextLineNumber(lineNumber);
-        }
-        return;
+        if (lexer.hasMoreTokens()) error("SYNTAX ERROR");
+        OutputSink & out=state.getOutput();
+        for (ProgramLine *p=program.getFirstLine();p!=NULL;p=p->next) out.writeLine(p->source);
+        return true;
+    }
+    if ((token=="SAVE")||(token=="LOAD")){  //the file name is the rest of the line
+        string filename=trim(line.substr(line.find(token)+token.size()));
+        if (filename.empty()) error("SYNTAX ERROR");
+        if (!state.hasFileAccess()) error("FILE ACCESS DENIED");   //a server session must not reach the server's files
+        if (token=="SAVE") saveImage(filename,program);
+        else loadImage(filename,program,state);
+        return true;
     }
     if (token=="HELP"){ //just help
-        if (scanner.hasMoreTokens()) error("SYNTAX ERROR");
-        cout<<"Yet another basic interpreter"<<endl;
-        return;
+        if (lexer.hasMoreTokens()) error("SYNTAX ERROR");
+        state.getOutput().writeLine("Yet another basic interpreter");
+        return true;
     }
     if (token=="CLEAR"){    //just clear the state and the lines
-        if (scanner.hasMoreTokens()) error("SYNTAX ERROR");
+        if (lexer.hasMoreTokens()) error("SYNTAX ERROR");
         program.clear(state);
-        return;
+        return true;
     }
     if (token=="QUIT"){ //just quit
-        if (scanner.hasMoreTokens()) error("SYNTAX ERROR");
-        exit(0);
+        if (lexer.hasMoreTokens()) error("SYNTAX ERROR");
+        state.getOutput().flush();
+        return false;
     }
-    if (token=="LET"){  //just let var=value
-        line=line.substr(line.find("LET")+3);
-        Statement* stmt=new LetStmt(line);
-        if (stmt->valid()) stmt->execute(state);
-        return;
-    }
-     if (token=="INPUT"){   //just input
-        line=line.substr(line.find("INPUT")+5);
-        Statement* stmt=new InputStmt(line);
-        if (stmt->valid()) stmt->execute(state);
-        return;
-    }
-     if (token=="PRINT"){   //just print
-        line=line.substr(line.find("PRINT")+5);
-        Statement* stmt=new PrintStmt(line);
-        if (stmt->valid()) stmt->execute(state);
-        return;
+    if ((token=="LET")||(token=="INPUT")||(token=="PRINT")||(token=="DIM")){   //just execute it once,in a scratch arena
+        Arena arena;
+        Statement *stmt=parseStatement(token,line,&arena);
+        try {
+            stmt->execute(state);
+        } catch (...) {
+            delete stmt;
+            throw;
+        }
+        delete stmt;
+        return true;
     }
     error("SYNTAX ERROR");  //unsolvable tokentype
-  
-}
\ No newline at end of file
+    return true;
+}
+
+/*
+ * Function: runProfile
+ * Usage: runProfile(program, state);
+ * ----------------------------------
+ * Runs the program with the profiling hooks switched on and prints the
+ * hot-line report after it, also when the program stops with an error
+ * (whose message comes first, as RUN would show it).
+ */
+
+void runProfile(Program & program, EvalState & state) {
+   Profile profile;
+   OutputSink & out = state.getOutput();
+   try {
+      compileProgram(program, state).runProfiled(state, profile);
+   } catch (ErrorException & ex) {
+      out.writeLine(ex.getMessage());
+   }
+   out.write(profile.toString(program));
+   out.flush();
+}
+
+/*
+ * Function: compileProgram
+ * Usage: compileProgram(program, state).run(state);
+ * -------------------------------------------------
+ * Returns the bytecode of the program, compiling it if a line changed,
+ * and charges it to the memory cap of the session along with the
+ * lines.  A program whose bytecode does not fit raises OUT OF MEMORY
+ * instead of running.
+ */
+
+Bytecode & compileProgram(Program & program, EvalState & state) {
+   Bytecode & code = program.getBytecode();
+   state.setProgramBytes(program.getBytes());
+   return code;
+}
+
+/*
+ * Function: saveImage
+ * Usage: saveImage(filename, program);
+ * ------------------------------------
+ * Writes the program to filename as an image (see image.h): for each
+ * line its number, its source text, its statement type (-1 if it was
+ * never parsed) and the operands the statement saves.
+ */
+
+void saveImage(string filename, Program & program) {
+   ImageWriter image;
+   for (ProgramLine *p = program.getFirstLine(); p != NULL; p = p->next) {
+      image.writeInt(p->number);
+      image.writeString(p->source);
+      if (p->stmt == NULL) {
+         image.writeInt(-1);
+         continue;
+      }
+      image.writeInt(p->stmt->getType());
+      p->stmt->save(image);
+   }
+   image.save(filename);
+}
+
+/*
+ * Function: loadImage
+ * Usage: loadImage(filename, program, state);
+ * -------------------------------------------
+ * Replaces the program and clears the variables, like CLEAR followed by
+ * typing the lines of the image, but without scanning any of them:
+ * each statement is created empty and filled by its load method.  The
+ * whole image is read before the program is touched, so a bad file
+ * leaves the current program as it was.
+ */
+
+void loadImage(string filename, Program & program, EvalState & state) {
+   static const char *tokens[] = {
+      "LET", "PRINT", "INPUT", "REM", "GOTO", "IF", "END", "DIM", "FOR", "NEXT",
+      "GOSUB", "RETURN"
+   };
+   struct Line {
+      int number;
+      string source;
+      Statement *stmt;
+      Arena *arena;
+   };
+   ImageReader image(filename);
+   vector<Line> lines;
+   try {
+      while (!image.atEnd()) {
+         Line line = { 0, "", NULL, NULL };
+         line.number = image.readInt();
+         line.source = image.readString();
+         int type = image.readInt();
+         if (type != -1) {
+            if (type < LET || type > RETURN) error("BAD IMAGE FILE");
+            if (line.source.find(tokens[type]) == string::npos) error("BAD IMAGE FILE");
+            line.arena = new Arena();
+            lines.push_back(line);
+            ArenaScope scope(line.arena);
+            lines.back().stmt = newStatement(tokens[type], line.source);
+            lines.back().stmt->load(image);
+         } else {
+            lines.push_back(line);
+         }
+      }
+      size_t bytes = 0;
+      for (size_t i = 0; i < lines.size(); i++) {
+         bytes += Program::lineBytes(lines[i].source, lines[i].arena);
+      }
+      state.setProgramBytes(bytes);   //the old program goes, but the new one must fit
+   } catch (...) {
+      for (size_t i = 0; i < lines.size(); i++) {
+         delete lines[i].stmt;
+         delete lines[i].arena;
+      }
+      throw;
+   }
+   program.clear(state);
+   for (size_t i = 0; i < lines.size(); i++) {
+      program.addSourceLine(lines[i].number, lines[i].source);
+      if (lines[i].stmt != NULL) {
+         program.setParsedStatement(lines[i].number, lines[i].stmt, lines[i].arena);
+      }
+   }
+   state.setProgramBytes(program.getBytes());
+}
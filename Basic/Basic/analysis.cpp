@@ -0,0 +1,265 @@
+/*
+ * File: analysis.cpp
+ * ------------------
+ * This file implements the Analysis class.
+ */
+
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "analysis.h"
+#include "evalstate.h"
+#include "statement.h"
+#include "../StanfordCPPLib/strlib.h"
+using namespace std;
+
+Analysis::Analysis(Program & program) {
+   for (ProgramLine *entry = program.getFirstLine(); entry != NULL;
+        entry = entry->next) {
+      Node node = { entry, vector<int>(), vector<int>(), -1, false };
+      index[entry] = nodes.size();
+      nodes.push_back(node);
+   }
+   words = 0;
+   checked = false;
+   pairLoops();
+   buildGraph();
+   findReachable();
+   findDefined();
+}
+
+bool Analysis::isReachable(ProgramLine *entry) {
+   map<ProgramLine *,int>::iterator it = index.find(entry);
+   return it != index.end() && nodes[it->second].reachable;
+}
+
+bool Analysis::isDefined(ProgramLine *entry, int slot) {
+   if (!checked) return false;
+   map<ProgramLine *,int>::iterator it = index.find(entry);
+   map<int,int>::iterator bit = tracked.find(slot);
+   if (it == index.end() || bit == tracked.end() || !nodes[it->second].reachable) {
+      return false;
+   }
+   unsigned long long word = defined[(size_t) it->second * words + bit->second / 64];
+   return (word >> (bit->second % 64)) & 1;
+}
+
+ProgramLine *Analysis::getLoopExit(ProgramLine *entry) {
+   map<ProgramLine *,ProgramLine *>::iterator it = loopExits.find(entry);
+   return (it == loopExits.end()) ? NULL : it->second;
+}
+
+/*
+ * Implementation notes: pairLoops
+ * -------------------------------
+ * FOR and NEXT are paired by nesting: a NEXT closes the innermost open
+ * FOR on its variable, and any loops opened inside it, and a bare NEXT
+ * closes the innermost one.  A FOR that is never closed has no entry,
+ * which getLoopExit reports as the end of the program.
+ */
+
+void Analysis::pairLoops() {
+   vector<ProgramLine *> open;
+   for (size_t i = 0; i < nodes.size(); i++) {
+      ProgramLine *entry = nodes[i].entry;
+      Statement *stmt = entry->stmt;
+      if (stmt == NULL) continue;
+      if (stmt->getType() == FOR) open.push_back(entry);
+      if (stmt->getType() != NEXT) continue;
+      int slot = ((NextStmt *) stmt)->getSlot();
+      for (int k = open.size() - 1; k >= 0; k--) {
+         if (slot != -1 && ((ForStmt *) open[k]->stmt)->getSlot() != slot) continue;
+         loopExits[open[k]] = entry->next;
+         open.resize(k);
+         break;
+      }
+   }
+}
+
+static void addReads(FlatExp & exp, vector<int> & reads) {
+   for (int i = 0; i < exp.size(); i++) {
+      const ExpNode & node = exp.getNode(i);
+      if (node.type == IDENTIFIER) reads.push_back(node.value);
+   }
+}
+
+static bool canJump(IfStmt *ifs) {      /* like Bytecode::compile */
+   string op = ifs->getOp();
+   return op == "=" || op == "<" || op == ">";
+}
+
+void Analysis::buildGraph() {
+   for (size_t i = 0; i < nodes.size(); i++) {
+      Node & node = nodes[i];
+      Statement *stmt = node.entry->stmt;
+      if (stmt == NULL) continue;            /* a LINE NUMBER ERROR trap */
+      int next = (i + 1 < nodes.size()) ? i + 1 : -1;
+      int target = (node.entry->target == NULL) ? -1 : index[node.entry->target];
+      bool falls = true;
+      switch (stmt->getType()) {
+      case LET: {
+         LetStmt *let = (LetStmt *) stmt;
+         if (let->isElement()) addReads(let->getIndex(), node.reads);
+         addReads(let->getExp(), node.reads);
+         if (!let->isElement()) node.defines = let->getSlot();
+         break;
+      }
+      case PRINT:
+         addReads(((PrintStmt *) stmt)->getExp(), node.reads);
+         break;
+      case INPUT: {
+         InputStmt *input = (InputStmt *) stmt;
+         if (input->isElement()) {
+            addReads(input->getIndex(), node.reads);
+         } else {
+            node.defines = input->getSlot();
+         }
+         break;
+      }
+      case DIM:
+         addReads(((DimStmt *) stmt)->getBound(), node.reads);
+         break;
+      case GOTO:
+         falls = false;
+         if (target != -1) node.successors.push_back(target);
+         break;
+      case IF: {
+         IfStmt *ifs = (IfStmt *) stmt;
+         addReads(ifs->getLHS(), node.reads);
+         addReads(ifs->getRHS(), node.reads);
+         if (canJump(ifs) && target != -1) node.successors.push_back(target);
+         break;
+      }
+      case FOR: {
+         ForStmt *loop = (ForStmt *) stmt;
+         addReads(loop->getStart(), node.reads);
+         addReads(loop->getLimit(), node.reads);
+         addReads(loop->getStep(), node.reads);
+         node.defines = loop->getSlot();
+         ProgramLine *after = getLoopExit(node.entry);
+         if (after != NULL) node.successors.push_back(index[after]);
+         break;
+      }
+      case GOSUB:
+         falls = (target != -1);
+         if (target != -1) node.successors.push_back(target);
+         break;
+      case END: case RETURN:
+         falls = false;
+         break;
+      default:
+         break;
+      }
+      if (falls && next != -1) node.successors.push_back(next);
+   }
+}
+
+void Analysis::findReachable() {
+   if (nodes.empty()) return;
+   vector<int> work(1, 0);
+   nodes[0].reachable = true;
+   while (!work.empty()) {
+      Node & node = nodes[work.back()];
+      work.pop_back();
+      for (size_t k = 0; k < node.successors.size(); k++) {
+         Node & next = nodes[node.successors[k]];
+         if (next.reachable) continue;
+         next.reachable = true;
+         work.push_back(node.successors[k]);
+      }
+   }
+}
+
+/*
+ * Implementation notes: findDefined
+ * ---------------------------------
+ * The sets are bit rows over the variables that some reachable line
+ * reads; no other variable needs an answer.  Every row but the first
+ * starts full and only shrinks: a line passes on its row plus what it
+ * defines, and a successor keeps the intersection of all it is given.
+ * Each reachable line is queued once at the start, so every edge is
+ * used at least once, and again whenever its row changes, which after
+ * a few rounds it stops doing.
+ */
+
+void Analysis::findDefined() {
+   for (size_t i = 0; i < nodes.size(); i++) {
+      if (!nodes[i].reachable) continue;
+      for (size_t k = 0; k < nodes[i].reads.size(); k++) {
+         int slot = nodes[i].reads[k];
+         if (tracked.find(slot) == tracked.end()) tracked.insert(make_pair(slot, (int) tracked.size()));
+      }
+   }
+   words = (tracked.size() + 63) / 64;
+   if ((size_t) words * nodes.size() > MAX_WORDS) return;
+   checked = true;
+   if (words == 0) return;
+   defined.assign((size_t) words * nodes.size(), ~0ULL);
+   for (int w = 0; w < words; w++) defined[w] = 0;
+   deque<int> work;
+   vector<char> queued(nodes.size(), 0);
+   for (size_t i = 0; i < nodes.size(); i++) {
+      if (!nodes[i].reachable) continue;
+      work.push_back(i);
+      queued[i] = 1;
+   }
+   vector<unsigned long long> out(words);
+   while (!work.empty()) {
+      int i = work.front();
+      work.pop_front();
+      queued[i] = 0;
+      const Node & node = nodes[i];
+      for (int w = 0; w < words; w++) out[w] = defined[(size_t) i * words + w];
+      map<int,int>::iterator bit = tracked.find(node.defines);
+      if (bit != tracked.end()) out[bit->second / 64] |= 1ULL << (bit->second % 64);
+      for (size_t k = 0; k < node.successors.size(); k++) {
+         int next = node.successors[k];
+         bool changed = false;
+         for (int w = 0; w < words; w++) {
+            unsigned long long & row = defined[(size_t) next * words + w];
+            if ((row & out[w]) != row) {
+               row &= out[w];
+               changed = true;
+            }
+         }
+         if (changed && !queued[next]) {
+            work.push_back(next);
+            queued[next] = 1;
+         }
+      }
+   }
+}
+
+string Analysis::toString() {
+   string report;
+   if (!checked) report += "READS NOT CHECKED: PROGRAM TOO LARGE\n";
+   for (size_t i = 0; i < nodes.size(); i++) {
+      ProgramLine *entry = nodes[i].entry;
+      string prefix = "LINE " + integerToString(entry->number) + ": ";
+      if (!nodes[i].reachable) {
+         report += prefix + "UNREACHABLE\n";
+         continue;
+      }
+      Statement *stmt = entry->stmt;
+      if (stmt != NULL && entry->target == NULL) {
+         int target = -1;
+         if (stmt->getType() == GOTO) target = ((GotoStmt *) stmt)->getTarget();
+         if (stmt->getType() == GOSUB) target = ((GosubStmt *) stmt)->getTarget();
+         if (stmt->getType() == IF && canJump((IfStmt *) stmt)) {
+            target = ((IfStmt *) stmt)->getTarget();
+         }
+         if (target != -1) report += prefix + "NO LINE " + integerToString(target) + "\n";
+      }
+      if (!checked) continue;
+      set<int> seen;
+      for (size_t k = 0; k < nodes[i].reads.size(); k++) {
+         int slot = nodes[i].reads[k];
+         if (isDefined(entry, slot) || !seen.insert(slot).second) continue;
+         report += prefix + EvalState::nameOf(slot) + " MAY BE UNDEFINED\n";
+      }
+   }
+   if (report.empty()) report = "NO PROBLEMS FOUND\n";
+   return report;
+}
@@ -0,0 +1,128 @@
+/*
+ * File: analysis.h
+ * ----------------
+ * This interface exports the Analysis class, which studies the control
+ * flow of a program without running it: which lines can be reached and
+ * which variables are certain to be defined when a line starts.
+ */
+
+#ifndef _analysis_h
+#define _analysis_h
+
+#include <map>
+#include <string>
+#include <vector>
+#include "program.h"
+
+/*
+ * Class: Analysis
+ * ---------------
+ * An analysis is made of a program as it is at construction and must
+ * not be used after any line changes.  The flow graph has a node per
+ * line, with edges for falling through, for GOTO, IF and GOSUB targets
+ * that exist and from a FOR to the line after its loop.  Jumps that go
+ * back to where control already was have no edges: the line after a
+ * GOSUB is treated as if the subroutine came straight back, and NEXT
+ * as if it never looped.  Variables are never undefined while a
+ * program runs, so a RETURN or NEXT arrives with everything that was
+ * defined when the GOSUB or FOR ran, and those edges could not change
+ * either answer.
+ *
+ * The answers are conservative: a line called unreachable is never
+ * executed, and a variable called defined has a value in every run
+ * that gets to the line, whatever the variables held before RUN.
+ */
+
+class Analysis {
+
+public:
+
+/*
+ * Constructor: Analysis
+ * Usage: Analysis analysis(program);
+ * ----------------------------------
+ * Builds the flow graph of program and solves both questions for it.
+ */
+
+   Analysis(Program & program);
+
+/*
+ * Method: isReachable
+ * Usage: if (analysis.isReachable(entry)) . . .
+ * ---------------------------------------------
+ * Returns false if no run of the program can execute the line.
+ */
+
+   bool isReachable(ProgramLine *entry);
+
+/*
+ * Method: isDefined
+ * Usage: if (analysis.isDefined(entry, slot)) . . .
+ * -------------------------------------------------
+ * Returns true if the variable in slot is defined whenever the line
+ * starts, so that reading it there needs no check.
+ */
+
+   bool isDefined(ProgramLine *entry, int slot);
+
+/*
+ * Method: getLoopExit
+ * Usage: ProgramLine *after = analysis.getLoopExit(entry);
+ * --------------------------------------------------------
+ * Returns the line after the NEXT that closes the FOR on entry, where
+ * the loop continues when it runs zero times, or NULL if that is the
+ * end of the program.  See Bytecode::compile for how they are paired.
+ */
+
+   ProgramLine *getLoopExit(ProgramLine *entry);
+
+/*
+ * Method: toString
+ * Usage: string report = analysis.toString();
+ * -------------------------------------------
+ * Returns what the CHECK command prints: a line for each unreachable
+ * line, each jump to a line that does not exist and each read of a
+ * variable that may be undefined, in line order.
+ */
+
+   std::string toString();
+
+/*
+ * Constant: MAX_WORDS
+ * -------------------
+ * The most 64-bit words the definedness sets may take together.  A
+ * larger program is only checked for reachability, and all its reads
+ * are treated as possibly undefined.
+ */
+
+   static const size_t MAX_WORDS = 1 << 20;
+
+private:
+
+   struct Node {
+      ProgramLine *entry;
+      std::vector<int> successors;
+      std::vector<int> reads;       /* variables read, in order      */
+      int defines;                  /* variable defined, or -1       */
+      bool reachable;
+   };
+
+   std::vector<Node> nodes;
+   std::map<ProgramLine *,int> index;
+   std::map<ProgramLine *,ProgramLine *> loopExits;
+   std::map<int,int> tracked;        /* slot -> bit, for slots read   */
+   std::vector<unsigned long long> defined;   /* words per node, row-major */
+   int words;
+   bool checked;                     /* false if over MAX_WORDS       */
+
+   void pairLoops();
+   void buildGraph();
+   void findReachable();
+   void findDefined();
+
+   Analysis(const Analysis &);
+   Analysis & operator=(const Analysis &);
+
+};
+
+#endif
@@ -0,0 +1,111 @@
+/*
+ * File: arena.cpp
+ * ---------------
+ * This file implements the arena.h interface.
+ */
+
+#include <cstdlib>
+#include <new>
+#include "arena.h"
+using namespace std;
+
+/*
+ * Implementation notes: alignment
+ * -------------------------------
+ * Every block is rounded up to ALIGN bytes, and ArenaObject puts a
+ * header of the same size in front of each object to remember which
+ * arena (if any) it came from.
+ */
+
+static const size_t ALIGN = 16;
+
+static size_t roundUp(size_t size) {
+   return (size + ALIGN - 1) & ~(ALIGN - 1);
+}
+
+static thread_local Arena *currentArena = NULL;
+
+Arena::Arena() {
+   cursor = first.bytes;
+   limit = first.bytes + INLINE_SIZE;
+   chunks = NULL;
+   bytes = sizeof(Arena);
+}
+
+Arena::~Arena() {
+   while (chunks != NULL) {
+      Chunk *next = chunks->next;
+      free(chunks);
+      chunks = next;
+   }
+}
+
+/*
+ * Implementation notes: allocate
+ * ------------------------------
+ * A request that does not fit in the current chunk starts a new one;
+ * requests bigger than a chunk get a chunk of their own.  The bytes
+ * left over in the old chunk are simply abandoned.
+ */
+
+void *Arena::allocate(size_t size) {
+   size = roundUp(size);
+   if ((size_t) (limit - cursor) < size) {
+      size_t header = roundUp(sizeof(Chunk));
+      size_t length = (size > CHUNK_SIZE - header) ? size + header : CHUNK_SIZE;
+      Chunk *chunk = (Chunk *) malloc(length);
+      if (chunk == NULL) throw bad_alloc();
+      chunk->next = chunks;
+      chunks = chunk;
+      bytes += length;
+      cursor = (char *) chunk + header;
+      limit = (char *) chunk + length;
+   }
+   void *result = cursor;
+   cursor += size;
+   return result;
+}
+
+size_t Arena::getBytes() {
+   return bytes;
+}
+
+Arena *Arena::current() {
+   return currentArena;
+}
+
+ArenaScope::ArenaScope(Arena *arena) {
+   saved = currentArena;
+   currentArena = arena;
+}
+
+ArenaScope::~ArenaScope() {
+   currentArena = saved;
+}
+
+/*
+ * Implementation notes: ArenaObject
+ * ---------------------------------
+ * The header holds the owning arena, or NULL for heap objects.  delete
+ * frees only the latter; the former go away with their arena.
+ */
+
+union ObjectHeader {
+   Arena *arena;
+   char pad[ALIGN];
+};
+
+void *ArenaObject::operator new(size_t size) {
+   Arena *arena = currentArena;
+   size_t total = sizeof(ObjectHeader) + size;
+   ObjectHeader *header = (ObjectHeader *)
+      ((arena != NULL) ? arena->allocate(total) : ::operator new(total));
+   header->arena = arena;
+   return header + 1;
+}
+
+void ArenaObject::operator delete(void *ptr) {
+   if (ptr == NULL) return;
+   ObjectHeader *header = (ObjectHeader *) ptr - 1;
+   if (header->arena == NULL) ::operator delete(header);
+}
@@ -0,0 +1,146 @@
+/*
+ * File: arena.h
+ * -------------
+ * This interface exports the Arena class, a region allocator that owns
+ * everything built for one program line, and the ArenaObject base that
+ * lets Statement and Expression objects be placed in an arena.
+ */
+
+#ifndef _arena_h
+#define _arena_h
+
+#include <cstddef>
+
+/*
+ * Class: Arena
+ * ------------
+ * An arena hands out memory by bumping a pointer through large chunks
+ * and gives all of it back at once when it is destroyed.  Allocating
+ * a statement and its expression nodes costs one malloc per chunk
+ * instead of one per object, and dropping a line is a single release.
+ */
+
+class Arena {
+
+public:
+
+/*
+ * Constructor: Arena
+ * Usage: Arena *arena = new Arena();
+ * ----------------------------------
+ * Creates an empty arena.  The first chunk lives inside the object,
+ * so a short line needs no further allocation.
+ */
+
+   Arena();
+
+/*
+ * Destructor: ~Arena
+ * Usage: delete arena;
+ * --------------------
+ * Releases every chunk.  Objects placed in the arena are not destroyed
+ * here; anything that owns other heap memory must be deleted first.
+ */
+
+   ~Arena();
+
+/*
+ * Method: allocate
+ * Usage: void *mem = arena->allocate(size);
+ * -----------------------------------------
+ * Returns size bytes aligned for any type, valid until the arena dies.
+ */
+
+   void *allocate(std::size_t size);
+
+/*
+ * Method: getBytes
+ * Usage: size_t bytes = arena->getBytes();
+ * ----------------------------------------
+ * Returns the memory the arena holds, the object itself included.
+ */
+
+   std::size_t getBytes();
+
+/*
+ * Static method: current
+ * Usage: Arena *arena = Arena::current();
+ * ---------------------------------------
+ * Returns the arena installed by the innermost ArenaScope of the
+ * calling thread, or NULL if objects go to the ordinary heap.
+ */
+
+   static Arena *current();
+
+private:
+
+   static const std::size_t INLINE_SIZE = 512;
+   static const std::size_t CHUNK_SIZE = 4096;
+
+   struct Chunk {
+      Chunk *next;
+   };
+
+   char *cursor, *limit;
+   Chunk *chunks;
+   std::size_t bytes;
+   union {
+      long double align;
+      char bytes[INLINE_SIZE];
+   } first;
+
+   Arena(const Arena &);
+   Arena & operator=(const Arena &);
+
+};
+
+/*
+ * Class: ArenaScope
+ * -----------------
+ * While an ArenaScope is alive, every ArenaObject created with new on
+ * this thread is placed in its arena.  Scopes nest.
+ *
+ *<pre>
+ *    Arena *arena = new Arena();
+ *    {
+ *       ArenaScope scope(arena);
+ *       stmt = new LetStmt(line);     // lives in arena
+ *    }
+ *</pre>
+ */
+
+class ArenaScope {
+
+public:
+
+   ArenaScope(Arena *arena);
+   ~ArenaScope();
+
+private:
+
+   Arena *saved;
+
+   ArenaScope(const ArenaScope &);
+   ArenaScope & operator=(const ArenaScope &);
+
+};
+
+/*
+ * Class: ArenaObject
+ * ------------------
+ * Base class whose operator new honours the current ArenaScope.  Each
+ * object records where it came from, so delete still runs destructors
+ * as usual but only hands heap memory back to the heap; arena memory
+ * is reclaimed when the arena goes.
+ */
+
+class ArenaObject {
+
+public:
+
+   static void *operator new(std::size_t size);
+   static void operator delete(void *ptr);
+
+};
+
+#endif
@@ -0,0 +1,592 @@
+/*
+ * File: bytecode.cpp
+ * ------------------
+ * This file implements the Bytecode class: the compiler that lowers
+ * a Program into instructions and the dispatch loop that runs them.
+ */
+
+#include <iostream>
+#include <map>
+#include <string>
+#include "analysis.h"
+#include "bytecode.h"
+#include "jit.h"
+#include "profile.h"
+#include "program.h"
+#include "statement.h"
+#include "../StanfordCPPLib/error.h"
+#include "../StanfordCPPLib/strlib.h"
+using namespace std;
+
+/*
+ * Constant: JIT_THRESHOLD
+ * -----------------------
+ * How often a backward jump must be taken before its loop is compiled.
+ */
+
+static const int JIT_THRESHOLD = 1000;
+
+Bytecode::Bytecode() {
+   emit(OP_HALT, 0, -1);
+   maxStack = 0;
+   jit = new Jit();
+   jitEnabled = Jit::isSupported();
+   callDepth = DEFAULT_CALL_DEPTH;
+   resetLoops();
+}
+
+Bytecode::~Bytecode() {
+   delete jit;
+}
+
+void Bytecode::setJitEnabled(bool flag) {
+   jitEnabled = flag && Jit::isSupported();
+   resetLoops();
+}
+
+bool Bytecode::isJitEnabled() {
+   return jitEnabled;
+}
+
+void Bytecode::setCallDepth(int depth) {
+   if (depth < 1) error("INVALID CALL DEPTH");
+   callDepth = depth;
+}
+
+int Bytecode::getCallDepth() {
+   return callDepth;
+}
+
+/*
+ * Implementation notes: resetLoops
+ * --------------------------------
+ * Drops the native code and restarts the counters.  A counter of zero
+ * means the jump is never compiled, which is how the tier is switched
+ * off and how a loop the Jit refused is remembered.
+ */
+
+void Bytecode::resetLoops() {
+   HotLoop cold = { jitEnabled ? JIT_THRESHOLD : 0, -1, NULL };
+   jit->clear();
+   hot.assign(code.size(), cold);
+}
+
+/*
+ * Implementation notes: enterLoop
+ * -------------------------------
+ * Called by the dispatch loop after the instruction at offset at went
+ * back to start.  Returns where to continue: start while the loop is
+ * still cold, or whatever the native code stopped at.  For a NEXT, loop
+ * is the ForLoop it is stepping.  A NEXT may close
+ * loops that begin at different places; native code compiled for one
+ * of them is only used when the loop starts there again.
+ */
+
+int Bytecode::enterLoop(int at, int start, int *values, char *defined,
+                        IntArray *arrays, ForLoop *loop) {
+   HotLoop & entry = hot[at];
+   if (entry.loop == NULL) {
+      if (entry.heat == 0 || --entry.heat > 0) return start;
+      entry.start = start;
+      entry.loop = jit->compile(code, start, at);
+      if (entry.loop == NULL) return start;
+   }
+   if (entry.start != start) return start;
+   return entry.loop(values, defined, arrays, loop);
+}
+
+void Bytecode::emit(OpCode op, int arg, int line) {
+   Instruction ins;
+   ins.op = op;
+   ins.arg = arg;
+   ins.line = line;
+   code.push_back(ins);
+}
+
+/*
+ * Implementation notes: compileExp
+ * --------------------------------
+ * The nodes of a FlatExp are already in postorder, which is exactly
+ * the order of stack code: one instruction per node.  The return value
+ * is the number of stack cells the expression needs, which run() uses
+ * to size the operand stack once.
+ */
+
+int Bytecode::compileExp(FlatExp & exp, int line) {
+   static const OpCode opcodes[] = { OP_ADD, OP_SUB, OP_MUL, OP_DIV };
+   int depth = 0, maxDepth = 0;
+   for (int i = 0; i < exp.size(); i++) {
+      const ExpNode & node = exp.getNode(i);
+      switch (node.type) {
+      case CONSTANT:
+         emit(OP_PUSH, node.value, line);
+         depth++;
+         break;
+      case IDENTIFIER:
+         emit(OP_LOAD, node.value, line);
+         depth++;
+         break;
+      case COMPOUND:
+         emit(opcodes[node.op], 0, line);
+         depth--;
+         break;
+      case ARRAY:
+         emit(OP_ALOAD, node.value, line);
+         break;
+      }
+      if (depth > maxDepth) maxDepth = depth;
+   }
+   return maxDepth;
+}
+
+/*
+ * Implementation notes: compile
+ * -----------------------------
+ * Lines are compiled in order, so falling through from one line to the
+ * next needs no instruction.  The line table has already resolved every
+ * GOTO, IF and GOSUB to an entry; jumps are emitted against that entry and
+ * patched with its offset once every line has one.  A jump whose line
+ * does not exist is pointed at a shared trap after the final HALT, and
+ * a line whose text was entered but never parsed compiles to the trap
+ * itself, since reaching it is a LINE NUMBER ERROR too.
+ *
+ * A FOR is followed by a jump to the line after its NEXT, which is
+ * taken when the loop runs zero times.  FOR and NEXT are paired by
+ * nesting first: a NEXT names the innermost open FOR on its variable,
+ * closing any loops opened inside it, and a bare NEXT closes the
+ * innermost one.  A FOR without a NEXT skips to the end.
+ *
+ * The pairing comes from an Analysis of the program, which also proves
+ * which reads are always defined; those loads become FETCH, with no
+ * check.
+ */
+
+void Bytecode::compile(Program & program) {
+   code.clear();
+   maxStack = 0;
+   map<ProgramLine *,int> offsets;
+   vector< pair<int,ProgramLine *> > jumps;
+   vector< pair<int,ProgramLine *> > skips;   /* jump, the FOR it skips */
+   Analysis analysis(program);
+   for (ProgramLine *entry = program.getFirstLine(); entry != NULL;
+        entry = entry->next) {
+      Statement *stmt = entry->stmt;
+      int line = entry->number;
+      if (stmt == NULL) {
+         emit(OP_LINE_ERROR, 0, line);
+         continue;
+      }
+      offsets[entry] = code.size();
+      int depth = 0;
+      switch (stmt->getType()) {
+      case LET: {
+         LetStmt *let = (LetStmt *) stmt;
+         if (let->isElement()) {
+            int index = compileExp(let->getIndex(), line);
+            int value = compileExp(let->getExp(), line) + 1;
+            depth = (index > value) ? index : value;
+            emit(OP_ASTORE, let->getSlot(), line);
+         } else {
+            depth = compileExp(let->getExp(), line);
+            emit(OP_STORE, let->getSlot(), line);
+         }
+         break;
+      }
+      case PRINT:
+         depth = compileExp(((PrintStmt *) stmt)->getExp(), line);
+         emit(OP_PRINT, 0, line);
+         break;
+      case INPUT: {
+         InputStmt *input = (InputStmt *) stmt;
+         if (input->isElement()) {
+            depth = compileExp(input->getIndex(), line);
+            emit(OP_AINPUT, input->getSlot(), line);
+         } else {
+            emit(OP_INPUT, input->getSlot(), line);
+         }
+         break;
+      }
+      case DIM: {
+         DimStmt *dim = (DimStmt *) stmt;
+         depth = compileExp(dim->getBound(), line);
+         emit(OP_DIM, dim->getSlot(), line);
+         break;
+      }
+      case REM:
+         break;
+      case GOTO:
+         jumps.push_back(make_pair((int) code.size(), entry->target));
+         emit(OP_JUMP, 0, line);
+         break;
+      case GOSUB:
+         jumps.push_back(make_pair((int) code.size(), entry->target));
+         emit(OP_GOSUB, 0, line);
+         break;
+      case RETURN:
+         emit(OP_RETURN, 0, line);
+         break;
+      case IF: {
+         IfStmt *ifs = (IfStmt *) stmt;
+         int left = compileExp(ifs->getLHS(), line);
+         int right = compileExp(ifs->getRHS(), line) + 1;
+         depth = (left > right) ? left : right;
+         string op = ifs->getOp();
+         if (op == "=" || op == "<" || op == ">") {
+            jumps.push_back(make_pair((int) code.size(), entry->target));
+            emit((op == "=") ? OP_JEQ : (op == "<") ? OP_JLT : OP_JGT, 0, line);
+         } else {
+            emit(OP_POP, 0, line);      /* never true, like execute() */
+            emit(OP_POP, 0, line);
+         }
+         break;
+      }
+      case FOR: {
+         ForStmt *loop = (ForStmt *) stmt;
+         int start = compileExp(loop->getStart(), line);
+         int limit = compileExp(loop->getLimit(), line) + 1;
+         int step = compileExp(loop->getStep(), line) + 2;
+         depth = (start > limit) ? start : limit;
+         if (step > depth) depth = step;
+         emit(OP_FOR, loop->getSlot(), line);
+         skips.push_back(make_pair((int) code.size(), entry));
+         emit(OP_JUMP, 0, line);
+         break;
+      }
+      case NEXT:
+         emit(OP_NEXT, ((NextStmt *) stmt)->getSlot(), line);
+         break;
+      case END:
+         emit(OP_HALT, 0, line);
+         break;
+      }
+      if (depth > maxStack) maxStack = depth;
+      for (size_t i = offsets[entry]; i < code.size(); i++) {
+         if (code[i].op == OP_LOAD && analysis.isDefined(entry, code[i].arg)) {
+            code[i].op = OP_FETCH;
+         }
+      }
+   }
+   int halt = code.size();
+   emit(OP_HALT, 0, -1);
+   int trap = code.size();
+   emit(OP_LINE_ERROR, 0, -1);
+   for (size_t i = 0; i < jumps.size(); i++) {
+      map<ProgramLine *,int>::iterator it = offsets.find(jumps[i].second);
+      code[jumps[i].first].arg = (it == offsets.end()) ? trap : it->second;
+   }
+   for (size_t i = 0; i < skips.size(); i++) {
+      ProgramLine *after = analysis.getLoopExit(skips[i].second);
+      map<ProgramLine *,int>::iterator it = offsets.find(after);
+      code[skips[i].first].arg = (after == NULL) ? halt
+                               : (it == offsets.end()) ? trap : it->second;
+   }
+   resetLoops();
+}
+
+static bool inRange(long long value, const ForLoop & loop) {
+   return (loop.step >= 0) ? value <= loop.limit : value >= loop.limit;
+}
+
+/*
+ * Type: Return
+ * ------------
+ * An entry of the return stack: the offset right after the GOSUB and
+ * the depth of the loop stack when it was executed.
+ */
+
+struct Return {
+   int pc;
+   int loops;
+};
+
+/*
+ * Implementation notes: run
+ * -------------------------
+ * The slot tables of the state are grown to cover every interned name
+ * up front, which lets the loop index them without bounds checks and
+ * keeps them in place while it runs; DIM only replaces the storage an
+ * IntArray points to.
+ *
+ * FOR pushes a ForLoop after dropping any active loop on the same
+ * counter (and those inside it), as jumping out of a loop and starting
+ * it again is common; this keeps the stack as small as the number of
+ * counters.  NEXT works on the innermost loop on its counter, dropping
+ * loops above it, and raises NEXT WITHOUT FOR if there is none.  The
+ * counter is stepped with wraparound, but the test is made on the
+ * exact sum, so a loop up to INT_MAX still ends.
+ *
+ * The return stack is allocated once at callDepth entries, so GOSUB is
+ * a bounds check and two stores.  A return address is the offset of
+ * the instruction after the GOSUB, which is where the next line starts
+ * since GOSUB ends its own.  RETURN also drops the FOR loops entered
+ * by the subroutine and still open, so a loop left by RETURN cannot be
+ * stepped by a later NEXT.
+ * Output is flushed when the program halts; on an error the caller
+ * flushes after adding the message.
+ *
+ * The loop is a template so that the profiling hooks and the step
+ * count are compiled out of the copy that run uses.  Taken backward
+ * jumps go through enterLoop in that copy only, so a profile always
+ * measures the interpreter and a step limit sees every instruction;
+ * native code has no way to count them.  When profiling, starts[i] is
+ * the index of the line whose first instruction is i, or -1.
+ */
+
+void Bytecode::run(EvalState & state) {
+   if (state.hasStepLimit()) {
+      execute<false,true>(state, NULL, NULL);
+   } else {
+      execute<false,false>(state, NULL, NULL);
+   }
+}
+
+void Bytecode::runProfiled(EvalState & state, Profile & profile) {
+   vector<int> starts(code.size(), -1);
+   vector<int> numbers;
+   for (size_t i = 0; i < code.size(); i++) {
+      int line = code[i].line;
+      if (line != -1 && (i == 0 || code[i - 1].line != line)) {
+         starts[i] = numbers.size();
+         numbers.push_back(line);
+      }
+   }
+   profile.start(numbers);
+   try {
+      if (state.hasStepLimit()) {
+         execute<true,true>(state, &profile, &starts[0]);
+      } else {
+         execute<true,false>(state, &profile, &starts[0]);
+      }
+   } catch (...) {
+      profile.finish();
+      throw;
+   }
+   profile.finish();
+}
+
+template <bool profiling, bool limited>
+void Bytecode::execute(EvalState & state, Profile *profile, const int *starts) {
+   const bool native = !profiling && !limited;
+   state.reserve();
+   int *values = state.values.data();
+   char *defined = state.defined.data();
+   IntArray *arrays = state.arrays.data();
+   OutputSink & out = state.getOutput();
+   vector<int> stack(maxStack + 1);
+   vector<ForLoop> loops;
+   vector<Return> returns(callDepth);
+   int calls = 0;
+   int *sp = &stack[0];
+   const Instruction *pc = &code[0];
+   const Instruction *base = pc;
+   while (true) {
+      if (limited && --state.stepsLeft < 0) error("STEP LIMIT EXCEEDED");
+      if (profiling && starts[pc - base] >= 0) profile->enterLine(starts[pc - base]);
+      const Instruction & ins = *pc++;
+      switch (ins.op) {
+      case OP_PUSH:
+         *sp++ = ins.arg;
+         break;
+      case OP_LOAD:
+         if (!defined[ins.arg]) error("VARIABLE NOT DEFINED");
+         *sp++ = values[ins.arg];
+         break;
+      case OP_FETCH:
+         *sp++ = values[ins.arg];
+         break;
+      case OP_STORE:
+         values[ins.arg] = *--sp;
+         defined[ins.arg] = 1;
+         break;
+      case OP_ADD:
+         sp--;
+         sp[-1] += sp[0];
+         break;
+      case OP_SUB:
+         sp--;
+         sp[-1] -= sp[0];
+         break;
+      case OP_MUL:
+         sp--;
+         sp[-1] *= sp[0];
+         break;
+      case OP_DIV:
+         sp--;
+         if (!sp[0]) error("DIVIDE BY ZERO");
+         sp[-1] /= sp[0];
+         break;
+      case OP_POP:
+         sp--;
+         break;
+      case OP_PRINT:
+         out.writeInteger(*--sp);
+         out.endLine();
+         break;
+      case OP_INPUT:
+         if (profiling) profile->pause();
+         values[ins.arg] = readInputValue(state);
+         if (profiling) profile->resume();
+         defined[ins.arg] = 1;
+         break;
+      case OP_ALOAD: {
+         const IntArray & array = arrays[ins.arg];
+         if ((unsigned) sp[-1] >= (unsigned) array.length) state.indexError(ins.arg);
+         sp[-1] = array.data[sp[-1]];
+         break;
+      }
+      case OP_ASTORE: {
+         const IntArray & array = arrays[ins.arg];
+         sp -= 2;
+         if ((unsigned) sp[0] >= (unsigned) array.length) state.indexError(ins.arg);
+         array.data[sp[0]] = sp[1];
+         break;
+      }
+      case OP_AINPUT: {
+         int index = *--sp;
+         state.getElement(ins.arg, index);
+         if (profiling) profile->pause();
+         int value = readInputValue(state);
+         if (profiling) profile->resume();
+         state.setElement(ins.arg, index, value);
+         break;
+      }
+      case OP_DIM:
+         state.dimension(ins.arg, *--sp);
+         break;
+      case OP_FOR: {
+         sp -= 3;
+         ForLoop loop = { ins.arg, sp[1], sp[2], (int) (pc - base) + 1 };
+         for (size_t k = loops.size(); k-- > 0; ) {
+            if (loops[k].slot == ins.arg) {
+               loops.resize(k);
+               break;
+            }
+         }
+         values[ins.arg] = sp[0];
+         defined[ins.arg] = 1;
+         if (inRange(sp[0], loop)) {
+            loops.push_back(loop);
+            pc++;
+         }
+         break;
+      }
+      case OP_NEXT: {
+         while (!loops.empty() && ins.arg != -1 && loops.back().slot != ins.arg) {
+            loops.pop_back();
+         }
+         if (loops.empty()) error("NEXT WITHOUT FOR");
+         const ForLoop & loop = loops.back();
+         long long next = (long long) values[loop.slot] + loop.step;
+         values[loop.slot] = (int) next;
+         if (profiling) profile->branch(inRange(next, loop));
+         if (!inRange(next, loop)) {
+            loops.pop_back();
+            break;
+         }
+         pc = base + loop.head;
+         if (native) {
+            ForLoop *active = &loops.back();
+            pc = base + enterLoop(&ins - base, loop.head, values, defined, arrays,
+                                  active);
+         }
+         break;
+      }
+      case OP_GOSUB:
+         if (calls == callDepth) error("GOSUB STACK OVERFLOW");
+         returns[calls].pc = pc - base;
+         returns[calls].loops = loops.size();
+         calls++;
+         pc = base + ins.arg;
+         if (profiling) {
+            profile->branch(true);
+            profile->call();
+         }
+         break;
+      case OP_RETURN:
+         if (calls == 0) error("RETURN WITHOUT GOSUB");
+         calls--;
+         if (loops.size() > (size_t) returns[calls].loops) loops.resize(returns[calls].loops);
+         pc = base + returns[calls].pc;
+         if (profiling) profile->ret();
+         break;
+      case OP_JUMP:
+         pc = base + ins.arg;
+         if (profiling) {
+            profile->branch(true);
+         } else if (native && pc <= &ins) {
+            pc = base + enterLoop(&ins - base, ins.arg, values, defined, arrays, NULL);
+         }
+         break;
+      case OP_JEQ:
+         sp -= 2;
+         if (sp[0] == sp[1]) {
+            pc = base + ins.arg;
+            if (native && pc <= &ins) {
+               pc = base + enterLoop(&ins - base, ins.arg, values, defined, arrays, NULL);
+            }
+         }
+         if (profiling) profile->branch(sp[0] == sp[1]);
+         break;
+      case OP_JLT:
+         sp -= 2;
+         if (sp[0] < sp[1]) {
+            pc = base + ins.arg;
+            if (native && pc <= &ins) {
+               pc = base + enterLoop(&ins - base, ins.arg, values, defined, arrays, NULL);
+            }
+         }
+         if (profiling) profile->branch(sp[0] < sp[1]);
+         break;
+      case OP_JGT:
+         sp -= 2;
+         if (sp[0] > sp[1]) {
+            pc = base + ins.arg;
+            if (native && pc <= &ins) {
+               pc = base + enterLoop(&ins - base, ins.arg, values, defined, arrays, NULL);
+            }
+         }
+         if (profiling) profile->branch(sp[0] > sp[1]);
+         break;
+      case OP_HALT:
+         out.flush();
+         return;
+      case OP_LINE_ERROR:
+         error("LINE NUMBER ERROR");
+      }
+   }
+}
+
+size_t Bytecode::getBytes() {
+   return code.capacity() * sizeof(Instruction) + hot.capacity() * sizeof(HotLoop);
+}
+
+string Bytecode::toString() {
+   static const char *mnemonics[] = {
+      "PUSH", "LOAD", "FETCH", "STORE", "ADD", "SUB", "MUL", "DIV", "POP",
+      "PRINT", "INPUT", "ALOAD", "ASTORE", "AINPUT", "DIM", "FOR", "NEXT",
+      "GOSUB", "RETURN", "JUMP", "JEQ", "JLT", "JGT", "HALT", "TRAP"
+   };
+   string listing;
+   for (size_t i = 0; i < code.size(); i++) {
+      const Instruction & ins = code[i];
+      listing += integerToString(i) + "\t";
+      listing += (ins.line == -1) ? "" : integerToString(ins.line);
+      listing += "\t" + string(mnemonics[ins.op]);
+      switch (ins.op) {
+      case OP_PUSH: case OP_GOSUB: case OP_JUMP: case OP_JEQ: case OP_JLT: case OP_JGT:
+         listing += " " + integerToString(ins.arg);
+         break;
+      case OP_LOAD: case OP_FETCH: case OP_STORE: case OP_INPUT:
+      case OP_ALOAD: case OP_ASTORE: case OP_AINPUT: case OP_DIM: case OP_FOR:
+         listing += " " + EvalState::nameOf(ins.arg);
+         break;
+      case OP_NEXT:
+         if (ins.arg != -1) listing += " " + EvalState::nameOf(ins.arg);
+         break;
+      default:
+         break;
+      }
+      listing += "\n";
+   }
+   return listing;
+}
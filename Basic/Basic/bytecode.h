@@ -0,0 +1,243 @@
+/*
+ * File: bytecode.h
+ * ----------------
+ * This interface exports the Bytecode class, a flat compiled form of
+ * a BASIC program.  A Program is lowered into an array of instructions
+ * for a small stack machine: variables become EvalState slots and the
+ * targets of GOTO, IF and GOSUB become instruction offsets, so running the
+ * program needs neither virtual calls nor map lookups.
+ */
+
+#ifndef _bytecode_h
+#define _bytecode_h
+
+#include <string>
+#include <vector>
+#include "evalstate.h"
+#include "exp.h"
+
+class Program;
+class Profile;
+class Jit;
+
+/*
+ * Type: OpCode
+ * ------------
+ * The instructions of the machine.  Expressions are evaluated on an
+ * operand stack; arg holds the constant, slot or jump target.
+ */
+
+enum OpCode {
+   OP_PUSH,         /* push the constant arg                          */
+   OP_LOAD,         /* push slot arg, VARIABLE NOT DEFINED if unset    */
+   OP_FETCH,        /* push slot arg, proven defined by Analysis       */
+   OP_STORE,        /* pop into slot arg                              */
+   OP_ADD, OP_SUB, OP_MUL, OP_DIV,
+   OP_POP,          /* discard the top of the stack                   */
+   OP_PRINT,        /* pop and print                                  */
+   OP_INPUT,        /* read a number into slot arg                    */
+   OP_ALOAD,        /* replace the index on top by element of array arg */
+   OP_ASTORE,       /* pop value and index, store into array arg       */
+   OP_AINPUT,       /* pop index, read a number into array arg         */
+   OP_DIM,          /* pop bound, dimension array arg                  */
+   OP_FOR,          /* pop start, limit, step; enter the loop on slot
+                       arg and skip the next instruction, or run it
+                       (the jump past NEXT) if the loop is empty      */
+   OP_NEXT,         /* step the loop on slot arg (-1: innermost)      */
+   OP_GOSUB,        /* push the return address, continue at arg       */
+   OP_RETURN,       /* continue at the address pushed by the last GOSUB */
+   OP_JUMP,         /* continue at arg                                */
+   OP_JEQ, OP_JLT, OP_JGT,  /* pop rhs and lhs, jump to arg if it holds */
+   OP_HALT,         /* END, or falling off the last line              */
+   OP_LINE_ERROR    /* a missing line was reached                     */
+};
+
+/*
+ * Type: Instruction
+ * -----------------
+ * One instruction together with the BASIC line it was compiled from.
+ */
+
+struct Instruction {
+   OpCode op;
+   int arg;
+   int line;
+};
+
+/*
+ * Type: ForLoop
+ * -------------
+ * An active FOR loop on the loop stack of the machine: its counter,
+ * the limit and step computed once by FOR, and the offset of the first
+ * instruction of its body.
+ */
+
+struct ForLoop {
+   int slot;
+   int limit;
+   int step;
+   int head;
+};
+
+/*
+ * Type: NativeLoop
+ * ----------------
+ * A loop compiled by the Jit class (see jit.h).  It runs on the slot
+ * tables of an EvalState and returns the offset of the instruction
+ * where the machine has to continue, always with an empty operand
+ * stack.  A loop closed by NEXT also gets the ForLoop it steps, NULL
+ * otherwise.
+ */
+
+typedef int (*NativeLoop)(int *values, char *defined, IntArray *arrays,
+                          ForLoop *loop);
+
+/*
+ * Class: Bytecode
+ * ---------------
+ * This class holds a compiled program and the virtual machine that
+ * executes it.  Output and error messages are exactly those of the
+ * tree-walking Statement::execute path.
+ */
+
+class Bytecode {
+
+public:
+
+/*
+ * Constructor: Bytecode
+ * Usage: Bytecode code;
+ * ---------------------
+ * Creates an empty program, which halts immediately when run.
+ */
+
+   Bytecode();
+
+/*
+ * Destructor: ~Bytecode
+ * Usage: usually implicit
+ * -----------------------
+ * Frees the instructions and any native code compiled from them.
+ */
+
+   ~Bytecode();
+
+/*
+ * Method: compile
+ * Usage: code.compile(program);
+ * -----------------------------
+ * Replaces the contents of this object with the translation of the
+ * whole program.  Compilation never fails: a jump to a line that does
+ * not exist is compiled into a LINE NUMBER ERROR trap.
+ */
+
+   void compile(Program & program);
+
+/*
+ * Method: run
+ * Usage: code.run(state);
+ * -----------------------
+ * Executes the compiled program.  The slot operands are EvalState
+ * slots, so the machine reads and writes the variables of state in
+ * place.  If state has a step limit, every instruction counts as a
+ * step and the native tier stays off for the run.
+ */
+
+   void run(EvalState & state);
+
+/*
+ * Method: runProfiled
+ * Usage: code.runProfiled(state, profile);
+ * ----------------------------------------
+ * Executes the program like run, recording per-line counts, times and
+ * jumps in profile.  The counters live in a separate copy of the
+ * dispatch loop, so run itself pays nothing for them.
+ */
+
+   void runProfiled(EvalState & state, Profile & profile);
+
+/*
+ * Methods: setJitEnabled, isJitEnabled
+ * Usage: code.setJitEnabled(false);
+ * ---------------------------------
+ * Controls the native tier.  When it is on (the default where Jit is
+ * supported), a loop whose backward jump has been taken JIT_THRESHOLD
+ * times is compiled to machine code and run natively from then on.
+ * Recompiling the program drops all native code.
+ */
+
+   void setJitEnabled(bool flag);
+   bool isJitEnabled();
+
+/*
+ * Methods: setCallDepth, getCallDepth
+ * Usage: code.setCallDepth(depth);
+ * --------------------------------
+ * Sets how many GOSUBs may be active at once, DEFAULT_CALL_DEPTH unless
+ * changed.  The return stack is allocated at this size when the program
+ * starts, and a GOSUB beyond it raises GOSUB STACK OVERFLOW.
+ */
+
+   static const int DEFAULT_CALL_DEPTH = 1024;
+
+   void setCallDepth(int depth);
+   int getCallDepth();
+
+/*
+ * Method: getBytes
+ * Usage: size_t bytes = code.getBytes();
+ * --------------------------------------
+ * Returns the memory taken by the instructions and the table of loops
+ * kept beside them.
+ */
+
+   size_t getBytes();
+
+/*
+ * Method: toString
+ * Usage: string listing = code.toString();
+ * ----------------------------------------
+ * Returns a readable listing of the instructions, one per line.
+ */
+
+   std::string toString();
+
+private:
+
+   std::vector<Instruction> code;
+   int maxStack;
+   Jit *jit;
+   bool jitEnabled;
+   int callDepth;
+
+/*
+ * Type: HotLoop
+ * -------------
+ * The JIT state of the backward jump at one offset.  heat counts down
+ * the jumps left until the loop is compiled; zero means never.
+ */
+
+   struct HotLoop {
+      int heat;
+      int start;          /* first instruction of the compiled loop */
+      NativeLoop loop;
+   };
+
+   std::vector<HotLoop> hot;          /* indexed by instruction       */
+
+   void emit(OpCode op, int arg, int line);
+   int compileExp(FlatExp & exp, int line);
+
+   int enterLoop(int at, int start, int *values, char *defined,
+                 IntArray *arrays, ForLoop *loop);
+   void resetLoops();
+
+   Bytecode(const Bytecode &);
+   Bytecode & operator=(const Bytecode &);
+
+   template <bool profiling, bool limited>
+   void execute(EvalState & state, Profile *profile, const int *starts);
+
+};
+
+#endif
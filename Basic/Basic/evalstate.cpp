@@ -6,34 +6,238 @@
  * methods are simple enough that they need no individual documentation.
  */
 
+#include <iostream>
+#include <map>
 #include <string>
+#include <vector>
 #include "evalstate.h"
-
-#include "../StanfordCPPLib/map.h"
+#include "../StanfordCPPLib/error.h"
 using namespace std;
 
+/*
+ * The table of the innermost SymbolScope.  Each thread runs one session
+ * at a time and each session has its own table, so no table is ever
+ * touched by two threads at once and none of them needs a lock.
+ */
+
+static thread_local SymbolTable *currentSymbols = NULL;
+
+/*
+ * Implementation notes: memory
+ * ----------------------------
+ * A name is kept twice, as a map key and in names, and costs a map node
+ * besides.  Each slot also takes a value, a defined flag and an array
+ * header in every EvalState that uses the table.
+ */
+
+static const size_t SLOT_BYTES = sizeof(int) + sizeof(char) + sizeof(IntArray);
+
+/* Implementation of the SymbolTable class */
+
+SymbolTable::SymbolTable() {
+   bytes = 0;
+}
+
+int SymbolTable::intern(const string & var) {
+   map<string,int>::iterator it = slots.find(var);
+   if (it != slots.end()) return it->second;
+   int slot = names.size();
+   names.push_back(var);
+   slots[var] = slot;
+   bytes += 2 * (sizeof(string) + var.size()) + 4 * sizeof(void *) + SLOT_BYTES;
+   return slot;
+}
+
+int SymbolTable::find(const string & var) {
+   map<string,int>::iterator it = slots.find(var);
+   return (it == slots.end()) ? -1 : it->second;
+}
+
+string SymbolTable::nameOf(int slot) {
+   return names[slot];
+}
+
+int SymbolTable::size() {
+   return names.size();
+}
+
+size_t SymbolTable::getBytes() {
+   return bytes;
+}
+
+SymbolTable & SymbolTable::current() {
+   if (currentSymbols == NULL) error("No symbol table in scope");
+   return *currentSymbols;
+}
+
+SymbolScope::SymbolScope(SymbolTable & symbols) {
+   saved = currentSymbols;
+   currentSymbols = &symbols;
+}
+
+SymbolScope::~SymbolScope() {
+   currentSymbols = saved;
+}
+
 /* Implementation of the EvalState class */
 
 EvalState::EvalState() {
-   /* Empty */
+   input = &cin;
+   output = &standardOutput();
+   stepLimited = false;
+   stepsLeft = 0;
+   memoryLimit = arrayBytes = programBytes = 0;
+   fileAccess = true;
 }
 
 EvalState::~EvalState() {
-   /* Empty */
+   clearArrays();
+}
+
+int EvalState::intern(string var) {
+   return SymbolTable::current().intern(var);
+}
+
+string EvalState::nameOf(int slot) {
+   return SymbolTable::current().nameOf(slot);
+}
+
+SymbolTable & EvalState::getSymbols() {
+   return symbols;
 }
 
 void EvalState::setValue(string var, int value) {
-   symbolTable.put(var, value);
+   setValue(symbols.intern(var), value);
+}
+
+void EvalState::setValue(int slot, int value) {
+   if (slot >= (int) values.size()) reserve();
+   values[slot] = value;
+   defined[slot] = 1;
 }
 
 int EvalState::getValue(string var) {
-   return symbolTable.get(var);
+   int slot = symbols.find(var);
+   return (slot < 0) ? 0 : getValue(slot);
+}
+
+int EvalState::getValue(int slot) {
+   return (slot < (int) values.size()) ? values[slot] : 0;
 }
 
 bool EvalState::isDefined(string var) {
-   return symbolTable.containsKey(var);
+   int slot = symbols.find(var);
+   return slot >= 0 && isDefined(slot);
+}
+
+bool EvalState::isDefined(int slot) {
+   return slot < (int) defined.size() && defined[slot];
+}
+
+void EvalState::reserve() {   //make room for every slot interned so far
+   IntArray none = { NULL, 0 };
+   int count = symbols.size();
+   checkMemory(arrayBytes, programBytes);
+   values.resize(count);
+   defined.resize(count);
+   arrays.resize(count, none);
+}
+
+void EvalState::dimension(int slot, int bound) {
+   if (bound < 0 || bound > MAX_ARRAY_BOUND) error("INVALID ARRAY SIZE");
+   if (slot >= (int) arrays.size()) reserve();
+   IntArray & array = arrays[slot];
+   size_t bytes = arrayBytes - array.length * sizeof(int) + (bound + 1) * sizeof(int);
+   checkMemory(bytes, programBytes);
+   int *data = new int[bound + 1]();
+   delete[] array.data;
+   array.data = data;
+   array.length = bound + 1;
+   arrayBytes = bytes;
+}
+
+int EvalState::getElement(int slot, int index) {
+   if (slot >= (int) arrays.size()) reserve();
+   IntArray & array = arrays[slot];
+   if ((unsigned) index >= (unsigned) array.length) indexError(slot);
+   return array.data[index];
+}
+
+void EvalState::setElement(int slot, int index, int value) {
+   if (slot >= (int) arrays.size()) reserve();
+   IntArray & array = arrays[slot];
+   if ((unsigned) index >= (unsigned) array.length) indexError(slot);
+   array.data[index] = value;
+}
+
+void EvalState::indexError(int slot) {
+   if (arrays[slot].data == NULL) error("VARIABLE NOT DEFINED");
+   error("INDEX OUT OF RANGE");
+}
+
+void EvalState::clearArrays() {
+   for (size_t i = 0; i < arrays.size(); i++) {
+      delete[] arrays[i].data;
+      arrays[i].data = NULL;
+      arrays[i].length = 0;
+   }
+   arrayBytes = 0;
+}
+
+void EvalState::setInput(istream & in) {
+   input = &in;
+}
+
+istream & EvalState::getInput() {
+   return *input;
+}
+
+void EvalState::setOutput(OutputSink & out) {
+   output = &out;
+}
+
+OutputSink & EvalState::getOutput() {
+   return *output;
+}
+
+void EvalState::setStepLimit(long long steps) {
+   stepLimited = steps > 0;
+   stepsLeft = steps;
+}
+
+bool EvalState::hasStepLimit() {
+   return stepLimited;
+}
+
+long long EvalState::getStepsLeft() {
+   return (stepsLeft > 0) ? stepsLeft : 0;
+}
+
+void EvalState::setMemoryLimit(size_t bytes) {
+   memoryLimit = bytes;
+}
+
+void EvalState::setProgramBytes(size_t bytes) {
+   if (bytes > programBytes) checkMemory(arrayBytes, bytes);
+   programBytes = bytes;
+}
+
+void EvalState::setFileAccess(bool flag) {
+   fileAccess = flag;
+}
+
+bool EvalState::hasFileAccess() {
+   return fileAccess;
+}
+
+void EvalState::checkMemory(size_t arrays, size_t program) {   //with the symbols, against the limit
+   if (memoryLimit != 0 && arrays + program + symbols.getBytes() > memoryLimit) {
+      error("OUT OF MEMORY");
+   }
 }
 
 void EvalState::clean(){
-    symbolTable.clear();
-}
\ No newline at end of file
+    values.assign(values.size(), 0);
+    defined.assign(defined.size(), 0);
+    clearArrays();
+}
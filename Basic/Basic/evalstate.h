@@ -9,8 +9,136 @@
 #ifndef _evalstate_h
 #define _evalstate_h
 
+#include <iostream>
+#include <map>
 #include <string>
-#include "../StanfordCPPLib/map.h"
+#include <vector>
+#include "output.h"
+
+/*
+ * Type: IntArray
+ * --------------
+ * The storage of one array: length ints at data, all of them defined.
+ * An array that has not been dimensioned has length 0, so the single
+ * bounds check on every access also catches it.
+ */
+
+struct IntArray {
+   int *data;
+   int length;
+};
+
+/*
+ * Class: SymbolTable
+ * ------------------
+ * Interns variable names into dense integer slots, numbered from 0 in
+ * the order the names are first seen.  Every session has a table of its
+ * own, kept in its EvalState, so the names one session makes up cost
+ * the others nothing.
+ */
+
+class SymbolTable {
+
+public:
+
+/*
+ * Constructor: SymbolTable
+ * Usage: SymbolTable symbols;
+ * ---------------------------
+ * Creates a table with no names in it.
+ */
+
+   SymbolTable();
+
+/*
+ * Method: intern
+ * Usage: int slot = symbols.intern(var);
+ * --------------------------------------
+ * Returns the slot of var, allocating the next free slot the first time
+ * the name is seen.
+ */
+
+   int intern(const std::string & var);
+
+/*
+ * Method: find
+ * Usage: int slot = symbols.find(var);
+ * ------------------------------------
+ * Returns the slot of var, or -1 if it was never interned.
+ */
+
+   int find(const std::string & var);
+
+/*
+ * Method: nameOf
+ * Usage: string var = symbols.nameOf(slot);
+ * -----------------------------------------
+ * Returns the name that was interned into slot.
+ */
+
+   std::string nameOf(int slot);
+
+/*
+ * Method: size
+ * Usage: int count = symbols.size();
+ * ----------------------------------
+ * Returns the number of slots handed out so far.
+ */
+
+   int size();
+
+/*
+ * Method: getBytes
+ * Usage: size_t bytes = symbols.getBytes();
+ * -----------------------------------------
+ * Returns the memory the table and the slot arrays of its EvalState
+ * take, or will take once they have grown to cover every slot.
+ */
+
+   size_t getBytes();
+
+/*
+ * Static method: current
+ * Usage: SymbolTable & symbols = SymbolTable::current();
+ * ------------------------------------------------------
+ * Returns the table installed by the innermost SymbolScope of the
+ * calling thread.  Raises an error if there is none.
+ */
+
+   static SymbolTable & current();
+
+private:
+
+   std::map<std::string,int> slots;
+   std::vector<std::string> names;
+   size_t bytes;
+
+};
+
+/*
+ * Class: SymbolScope
+ * ------------------
+ * While a SymbolScope is alive, the names parsed on this thread are
+ * interned into its table.  A session installs the table of its
+ * EvalState for as long as it runs, so that the slots in its program
+ * index that state.  Scopes nest.
+ */
+
+class SymbolScope {
+
+public:
+
+   SymbolScope(SymbolTable & symbols);
+   ~SymbolScope();
+
+private:
+
+   SymbolTable *saved;
+
+   SymbolScope(const SymbolScope &);
+   SymbolScope & operator=(const SymbolScope &);
+
+};
 
 /*
  * Class: EvalState
@@ -22,6 +150,13 @@
  * is a symbol table that maps variable names into their values.
  * Several of the exercises, however, require you to include
  * additional information in the EvalState class.
+ *
+ * Variable names are interned once, when a line is parsed, into the
+ * dense integer slots of the SymbolTable the state owns.  The values live in
+ * a flat array indexed by slot, with a defined flag per slot, so reads
+ * and writes on the evaluation path never compare or hash a string.
+ * An array uses the slot of its name as well, in a table of its own,
+ * so A and A(i) are different variables.
  */
 
 class EvalState {
@@ -46,37 +181,211 @@ public:
 
    ~EvalState();
 
+/*
+ * Static method: intern
+ * Usage: int slot = EvalState::intern(var);
+ * -----------------------------------------
+ * Returns the slot of the specified variable name in the current
+ * SymbolTable, allocating the next free slot the first time a name is
+ * seen.
+ */
+
+   static int intern(std::string var);
+
+/*
+ * Static method: nameOf
+ * Usage: string var = EvalState::nameOf(slot);
+ * --------------------------------------------
+ * Returns the variable name that was interned into slot of the current
+ * SymbolTable.
+ */
+
+   static std::string nameOf(int slot);
+
+/*
+ * Method: getSymbols
+ * Usage: SymbolScope scope(state.getSymbols());
+ * ---------------------------------------------
+ * Returns the table that the variables of this state are interned in.
+ */
+
+   SymbolTable & getSymbols();
+
 /*
  * Method: setValue
  * Usage: state.setValue(var, value);
- * ----------------------------------
+ *        state.setValue(slot, value);
+ * -----------------------------------
  * Sets the value associated with the specified var.
  */
 
    void setValue(std::string var, int value);
+   void setValue(int slot, int value);
 
 /*
  * Method: getValue
  * Usage: int value = state.getValue(var);
- * ---------------------------------------
+ *        int value = state.getValue(slot);
+ * ----------------------------------------
  * Returns the value associated with the specified variable.
  */
 
    int getValue(std::string var);
+   int getValue(int slot);
 
 /*
  * Method: isDefined
  * Usage: if (state.isDefined(var)) . . .
- * --------------------------------------
+ *        if (state.isDefined(slot)) . . .
+ * ---------------------------------------
  * Returns true if the specified variable is defined.
  */
 
    bool isDefined(std::string var);
+   bool isDefined(int slot);
+
+/*
+ * Method: dimension
+ * Usage: state.dimension(slot, bound);
+ * ------------------------------------
+ * Gives the array in slot the elements 0 through bound, all zero,
+ * replacing any previous contents.  Raises INVALID ARRAY SIZE if bound
+ * is negative or larger than MAX_ARRAY_BOUND.
+ */
+
+   void dimension(int slot, int bound);
+
+/*
+ * Methods: getElement, setElement
+ * Usage: int value = state.getElement(slot, index);
+ *        state.setElement(slot, index, value);
+ * -------------------------------------------------
+ * Read and write one element.  An index outside the array raises INDEX
+ * OUT OF RANGE, and an array that was never dimensioned raises VARIABLE
+ * NOT DEFINED, like a scalar that was never set.
+ */
+
+   int getElement(int slot, int index);
+   void setElement(int slot, int index, int value);
+
+/*
+ * Method: indexError
+ * Usage: state.indexError(slot);
+ * ------------------------------
+ * Raises the error for an access to slot that failed the bounds check.
+ */
+
+   void indexError(int slot);
+
+/*
+ * Constant: MAX_ARRAY_BOUND
+ * -------------------------
+ * The largest bound DIM accepts, which keeps a typo from asking for
+ * gigabytes.
+ */
+
+   static const int MAX_ARRAY_BOUND = (1 << 24) - 1;
+
+/*
+ * Methods: setInput, getInput
+ * Usage: state.setInput(file);
+ *        int value = readInputValue(state.getInput());
+ * ---------------------------------------------------
+ * INPUT statements read their values from this stream, which is cin
+ * unless another one is set.  The stream must outlive its use.
+ */
+
+   void setInput(std::istream & in);
+   std::istream & getInput();
+
+/*
+ * Methods: setOutput, getOutput
+ * Usage: state.getOutput().writeLine(text);
+ * -----------------------------------------
+ * PRINT and the commands write through this sink, which is the shared
+ * sink in front of cout unless another one is set.
+ */
+
+   void setOutput(OutputSink & out);
+   OutputSink & getOutput();
+
+/*
+ * Methods: setStepLimit, hasStepLimit, getStepsLeft
+ * Usage: state.setStepLimit(steps);
+ * ---------------------------------
+ * Gives the programs run against this state a budget of steps (machine
+ * instructions, see bytecode.h) shared by every RUN.  A run that needs
+ * more stops with STEP LIMIT EXCEEDED, and so does every run after it.
+ * A limit of 0 means none, the default.
+ */
+
+   void setStepLimit(long long steps);
+   bool hasStepLimit();
+   long long getStepsLeft();
+
+/*
+ * Method: setMemoryLimit
+ * Usage: state.setMemoryLimit(bytes);
+ * -----------------------------------
+ * Caps the memory of the session this state belongs to: its arrays,
+ * its variables and their names, and its program.  A DIM, a new
+ * variable or a program line that would go beyond it raises OUT OF
+ * MEMORY.  A limit of 0 means none, the default.
+ */
+
+   void setMemoryLimit(size_t bytes);
+
+/*
+ * Method: setProgramBytes
+ * Usage: state.setProgramBytes(program.getBytes());
+ * -------------------------------------------------
+ * Tells the state how much memory the program of the session takes,
+ * which counts against the memory limit.  Raises OUT OF MEMORY,
+ * leaving the old figure in place, if the program has grown beyond
+ * what the limit leaves it; the caller checks a line this way before
+ * adding it.
+ */
+
+   void setProgramBytes(size_t bytes);
+
+/*
+ * Methods: setFileAccess, hasFileAccess
+ * Usage: state.setFileAccess(false);
+ * ----------------------------------
+ * Controls whether SAVE and LOAD may touch the file system, which they
+ * may by default.  A server turns this off, since the files would be
+ * those of the server process, shared by every client.
+ */
+
+   void setFileAccess(bool flag);
+   bool hasFileAccess();
 
    void clean();
 private:
 
-   Map<std::string,int> symbolTable;
+   std::istream *input;
+   OutputSink *output;
+   bool stepLimited;
+   long long stepsLeft;         //goes negative once the budget is spent
+   size_t memoryLimit;
+   size_t arrayBytes;           //held by arrays right now
+   size_t programBytes;         //as last set, see setProgramBytes
+   bool fileAccess;
+
+   SymbolTable symbols;
+
+   std::vector<int> values;     //indexed by slot
+   std::vector<char> defined;   //nonzero once the slot has been set
+   std::vector<IntArray> arrays;   //indexed by slot as well
+
+   void reserve();
+   void clearArrays();
+   void checkMemory(size_t arrays, size_t program);
+
+   EvalState(const EvalState &);
+   EvalState & operator=(const EvalState &);
+
+   friend class Bytecode;       //runs directly on the slot arrays
 
 };
 
@@ -59,21 +59,23 @@ int ConstantExp::getValue() {
  * Implementation notes: the IdentifierExp subclass
  * ------------------------------------------------
  * The IdentifierExp subclass declares a single instance variable that
- * stores the name of the variable.  The implementation of eval must
- * look this variable up in the evaluation state.
+ * stores the slot the name of the variable is interned into; the name
+ * itself is recovered from the intern table.  The implementation of
+ * eval looks the slot up in the evaluation state, which is a plain
+ * array access.
  */
 
 IdentifierExp::IdentifierExp(string name) {
-   this->name = name;
+   this->slot = EvalState::intern(name);
 }
 
 int IdentifierExp::eval(EvalState & state) {
-   if (!state.isDefined(name)) error("VARIABLE NOT DEFINED");
-   return state.getValue(name);
+   if (!state.isDefined(slot)) error("VARIABLE NOT DEFINED");
+   return state.getValue(slot);
 }
 
 string IdentifierExp::toString() {
-   return name;
+   return EvalState::nameOf(slot);
 }
 
 ExpressionType IdentifierExp::getType() {
@@ -81,7 +83,80 @@ ExpressionType IdentifierExp::getType() {
 }
 
 string IdentifierExp::getName() {
-   return name;
+   return EvalState::nameOf(slot);
+}
+
+int IdentifierExp::getSlot() {
+   return slot;
+}
+
+/*
+ * Implementation notes: the ArrayExp subclass
+ * -------------------------------------------
+ * The index is evaluated first; the bounds check is in EvalState.
+ */
+
+ArrayExp::ArrayExp(string name, Expression *index) {
+   this->slot = EvalState::intern(name);
+   this->index = index;
+}
+
+ArrayExp::~ArrayExp() {
+   delete index;
+}
+
+int ArrayExp::eval(EvalState & state) {
+   return state.getElement(slot, index->eval(state));
+}
+
+string ArrayExp::toString() {
+   return EvalState::nameOf(slot) + '(' + index->toString() + ')';
+}
+
+ExpressionType ArrayExp::getType() {
+   return ARRAY;
+}
+
+string ArrayExp::getName() {
+   return EvalState::nameOf(slot);
+}
+
+int ArrayExp::getSlot() {
+   return slot;
+}
+
+Expression *ArrayExp::getIndex() {
+   return index;
+}
+
+void ArrayExp::setIndex(Expression *index) {
+   this->index = index;
+}
+
+/*
+ * Implementation notes: operators
+ * -------------------------------
+ * The operator is decoded from its spelling once, when the node is
+ * built; evaluation never looks at the string again.
+ */
+
+Operator toOperator(string token) {
+   if (token == "+") return PLUS;
+   if (token == "-") return MINUS;
+   if (token == "*") return TIMES;
+   if (token == "/") return DIVIDE;
+   error("SYNTAX ERROR");
+   return PLUS;
+}
+
+string operatorName(Operator op) {
+   switch (op) {
+   case PLUS: return "+";
+   case MINUS: return "-";
+   case TIMES: return "*";
+   case DIVIDE: return "/";
+   }
+   return "?";
 }
 
 /*
@@ -93,6 +168,12 @@ string IdentifierExp::getName() {
  */
 
 CompoundExp::CompoundExp(string op, Expression *lhs, Expression *rhs) {
+   this->op = toOperator(op);
+   this->lhs = lhs;
+   this->rhs = rhs;
+}
+
+CompoundExp::CompoundExp(Operator op, Expression *lhs, Expression *rhs) {
    this->op = op;
    this->lhs = lhs;
    this->rhs = rhs;
@@ -127,16 +208,18 @@ int CompoundExp::eval(EvalState & state) {
    }*/
    int left = lhs->eval(state);
    int right = rhs->eval(state);
-   if (op == "+") return left + right;
-   if (op == "-") return left - right;
-   if (op == "*") return left * right;
-   if (op == "/") {if (!right) error("DIVIDE BY ZERO");return left / right;}
+   switch (op) {
+   case PLUS: return left + right;
+   case MINUS: return left - right;
+   case TIMES: return left * right;
+   case DIVIDE: if (!right) error("DIVIDE BY ZERO"); return left / right;
+   }
    error("SYNTAX ERROR");
    return 0;
 }
 
 string CompoundExp::toString() {
-   return '(' + lhs->toString() + ' ' + op + ' ' + rhs->toString() + ')';
+   return '(' + lhs->toString() + ' ' + operatorName(op) + ' ' + rhs->toString() + ')';
 }
 
 ExpressionType CompoundExp::getType() {
@@ -144,6 +227,10 @@ ExpressionType CompoundExp::getType() {
 }
 
 string CompoundExp::getOp() {
+   return operatorName(op);
+}
+
+Operator CompoundExp::getOperator() {
    return op;
 }
 
@@ -154,3 +241,121 @@ Expression *CompoundExp::getLHS() {
 Expression *CompoundExp::getRHS() {
    return rhs;
 }
+
+void CompoundExp::setLHS(Expression *lhs) {
+   this->lhs = lhs;
+}
+
+void CompoundExp::setRHS(Expression *rhs) {
+   this->rhs = rhs;
+}
+
+/*
+ * Implementation notes: the FlatExp class
+ * ---------------------------------------
+ * add appends the nodes of a subtree in postorder and returns the index
+ * of its root, so the parent always lands after both of its operands.
+ */
+
+FlatExp::FlatExp() {
+   /* Empty */
+}
+
+FlatExp::FlatExp(Expression *exp) {
+   add(exp);
+   values.resize(nodes.size());
+}
+
+FlatExp::FlatExp(const vector<ExpNode> & nodes) {
+   this->nodes = nodes;
+   values.resize(nodes.size());
+}
+
+int FlatExp::add(Expression *exp) {
+   ExpNode node;
+   node.type = exp->getType();
+   node.op = PLUS;
+   node.value = 0;
+   node.lhs = node.rhs = -1;
+   switch (node.type) {
+   case CONSTANT:
+      node.value = ((ConstantExp *) exp)->getValue();
+      break;
+   case IDENTIFIER:
+      node.value = ((IdentifierExp *) exp)->getSlot();
+      break;
+   case COMPOUND:
+      node.op = ((CompoundExp *) exp)->getOperator();
+      node.lhs = add(((CompoundExp *) exp)->getLHS());
+      node.rhs = add(((CompoundExp *) exp)->getRHS());
+      break;
+   case ARRAY:
+      node.value = ((ArrayExp *) exp)->getSlot();
+      node.lhs = add(((ArrayExp *) exp)->getIndex());
+      break;
+   }
+   nodes.push_back(node);
+   return nodes.size() - 1;
+}
+
+int FlatExp::eval(EvalState & state) {
+   int n = nodes.size();
+   if (n == 0) return 0;
+   const ExpNode *node = &nodes[0];
+   int *value = &values[0];
+   for (int i = 0; i < n; i++) {
+      switch (node[i].type) {
+      case CONSTANT:
+         value[i] = node[i].value;
+         break;
+      case IDENTIFIER:
+         if (!state.isDefined(node[i].value)) error("VARIABLE NOT DEFINED");
+         value[i] = state.getValue(node[i].value);
+         break;
+      case COMPOUND: {
+         int left = value[node[i].lhs];
+         int right = value[node[i].rhs];
+         switch (node[i].op) {
+         case PLUS: value[i] = left + right; break;
+         case MINUS: value[i] = left - right; break;
+         case TIMES: value[i] = left * right; break;
+         case DIVIDE:
+            if (!right) error("DIVIDE BY ZERO");
+            value[i] = left / right;
+            break;
+         }
+         break;
+      }
+      case ARRAY:
+         value[i] = state.getElement(node[i].value, value[node[i].lhs]);
+         break;
+      }
+   }
+   return value[n - 1];
+}
+
+string FlatExp::toString() {
+   return nodes.empty() ? "" : toString(nodes.size() - 1);
+}
+
+string FlatExp::toString(int index) {
+   const ExpNode & node = nodes[index];
+   switch (node.type) {
+   case CONSTANT: return integerToString(node.value);
+   case IDENTIFIER: return EvalState::nameOf(node.value);
+   case COMPOUND:
+      return '(' + toString(node.lhs) + ' ' + operatorName(node.op) + ' '
+                 + toString(node.rhs) + ')';
+   case ARRAY:
+      return EvalState::nameOf(node.value) + '(' + toString(node.lhs) + ')';
+   }
+   return "";
+}
+
+int FlatExp::size() {
+   return nodes.size();
+}
+
+const ExpNode & FlatExp::getNode(int index) {
+   return nodes[index];
+}
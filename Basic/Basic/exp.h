@@ -9,16 +9,48 @@
 #ifndef _exp_h
 #define _exp_h
 
+#include <string>
+#include <vector>
 #include "evalstate.h"
+#include "arena.h"
 
 /*
  * Type: ExpressionType
  * --------------------
- * This enumerated type is used to differentiate the three different
- * expression types: CONSTANT, IDENTIFIER, and COMPOUND.
+ * This enumerated type is used to differentiate the four different
+ * expression types: CONSTANT, IDENTIFIER, COMPOUND, and ARRAY.
  */
 
-enum ExpressionType { CONSTANT, IDENTIFIER, COMPOUND };
+enum ExpressionType { CONSTANT, IDENTIFIER, COMPOUND, ARRAY };
+
+/*
+ * Type: Operator
+ * --------------
+ * This enumerated type identifies the operator of a compound
+ * expression, so that evaluation can switch on it instead of
+ * comparing strings.
+ */
+
+enum Operator { PLUS, MINUS, TIMES, DIVIDE };
+
+/*
+ * Function: toOperator
+ * Usage: Operator op = toOperator(token);
+ * ---------------------------------------
+ * Returns the operator spelled by token, or raises SYNTAX ERROR if the
+ * token is not one of + - * /.
+ */
+
+Operator toOperator(std::string token);
+
+/*
+ * Function: operatorName
+ * Usage: string token = operatorName(op);
+ * ---------------------------------------
+ * Returns the spelling of the operator.
+ */
+
+std::string operatorName(Operator op);
 
 /*
  * Class: Expression
@@ -26,12 +58,13 @@ enum ExpressionType { CONSTANT, IDENTIFIER, COMPOUND };
  * This class is used to represent a node in an expression tree.
  * Expression is an example of an abstract class, which defines
  * the structure and behavior of a set of classes but has no
- * objects of its own.  Any object must be one of the three
+ * objects of its own.  Any object must be one of the four
  * concrete subclasses of Expression:
  *
  *  1. ConstantExp   -- an integer constant
  *  2. IdentifierExp -- a string representing an identifier
  *  3. CompoundExp   -- two expressions combined by an operator
+ *  4. ArrayExp      -- an element of an array, A(i)
  *
  * The Expression class defines the interface common to all
  * Expression objects; each subclass provides its own specific
@@ -41,9 +74,12 @@ enum ExpressionType { CONSTANT, IDENTIFIER, COMPOUND };
  * class is marked with the designation = 0 on the prototype line.
  * This notation is used in C++ to indicate that this method is
  * purely virtual and will always be supplied by the subclass.
+ *
+ * Expression nodes are ArenaObjects: created inside an ArenaScope they
+ * are placed in that arena and their memory goes away with it.
  */
 
-class Expression {
+class Expression : public ArenaObject {
 
 public:
 
@@ -91,7 +127,7 @@ public:
  * Usage: ExpressionType type = exp->getType();
  * --------------------------------------------
  * Returns the type of the expression, which must be one of the constants
- * CONSTANT, IDENTIFIER, or COMPOUND.
+ * CONSTANT, IDENTIFIER, COMPOUND, or ARRAY.
  */
 
    virtual ExpressionType getType() = 0;
@@ -186,9 +222,19 @@ public:
 
    std::string getName();
 
+/*
+ * Method: getSlot
+ * Usage: int slot = ((IdentifierExp *) exp)->getSlot();
+ * -----------------------------------------------------
+ * Returns the EvalState slot the name was interned into when the
+ * node was built.
+ */
+
+   int getSlot();
+
 private:
 
-   std::string name;
+   int slot;    /* the name is kept only in the EvalState intern table */
 
 };
 
@@ -209,10 +255,12 @@ public:
  * -------------------------------------------------------
  * The constructor initializes a new compound expression
  * which is composed of the operator (op) and the left and
- * right subexpression (lhs and rhs).
+ * right subexpression (lhs and rhs).  The operator may be given
+ * by its spelling or as an Operator.
  */
 
    CompoundExp(std::string op, Expression *lhs, Expression *rhs);
+   CompoundExp(Operator op, Expression *lhs, Expression *rhs);
 
 /*
  * Prototypes for the virtual methods
@@ -240,11 +288,163 @@ public:
    Expression *getLHS();
    Expression *getRHS();
 
+/*
+ * Method: getOperator
+ * Usage: Operator op = ((CompoundExp *) exp)->getOperator();
+ * ----------------------------------------------------------
+ * Returns the operator as an Operator rather than as a string.
+ */
+
+   Operator getOperator();
+
+/*
+ * Methods: setLHS, setRHS
+ * Usage: ((CompoundExp *) exp)->setLHS(lhs);
+ * ------------------------------------------
+ * Replace a subexpression without freeing the old one, which lets a
+ * rewriting pass move subtrees between nodes.  Setting NULL detaches
+ * the subtree so that deleting this node leaves it alone.
+ */
+
+   void setLHS(Expression *lhs);
+   void setRHS(Expression *rhs);
+
 private:
 
-   std::string op;
+   Operator op;
    Expression *lhs, *rhs;
 
 };
 
+/*
+ * Class: ArrayExp
+ * ---------------
+ * This subclass represents an element of an array, selected by an
+ * index expression.
+ */
+
+class ArrayExp: public Expression {
+
+public:
+
+/*
+ * Constructor: ArrayExp
+ * Usage: Expression *exp = new ArrayExp(name, index);
+ * ---------------------------------------------------
+ * The constructor initializes a new element expression for the array
+ * named by name.  The node takes over index.
+ */
+
+   ArrayExp(std::string name, Expression *index);
+
+/*
+ * Prototypes for the virtual methods
+ * ----------------------------------
+ * These methods have the same prototypes as those in the Expression
+ * base class and don't require additional documentation.
+ */
+
+   virtual ~ArrayExp();
+   virtual int eval(EvalState & state);
+   virtual std::string toString();
+   virtual ExpressionType getType();
+
+/*
+ * Methods: getName, getSlot, getIndex, setIndex
+ * Usage: int slot = ((ArrayExp *) exp)->getSlot();
+ * ------------------------------------------------
+ * Give access to the array and the index expression.  setIndex works
+ * like CompoundExp::setLHS.
+ */
+
+   std::string getName();
+   int getSlot();
+   Expression *getIndex();
+   void setIndex(Expression *index);
+
+private:
+
+   int slot;
+   Expression *index;
+
+};
+
+/*
+ * Type: ExpNode
+ * -------------
+ * One node of a FlatExp.  For a CONSTANT, value is the constant; for an
+ * IDENTIFIER, value is the EvalState slot; for a COMPOUND, op is the
+ * operator and lhs and rhs are the indices of the operand nodes; for an
+ * ARRAY, value is the slot and lhs the index of the index node.
+ */
+
+struct ExpNode {
+   ExpressionType type;
+   Operator op;
+   int value;
+   int lhs, rhs;
+};
+
+/*
+ * Class: FlatExp
+ * --------------
+ * This class is a compact, non-virtual copy of an expression tree.  The
+ * nodes sit in one array in postorder, children before their parent and
+ * the root last, so eval is a single loop over the array with a switch
+ * on each node and no virtual calls or pointer chasing.  Operands are
+ * evaluated in the same order as Expression::eval, so the same error is
+ * raised first.
+ */
+
+class FlatExp {
+
+public:
+
+/*
+ * Constructor: FlatExp
+ * Usage: FlatExp flat;
+ *        FlatExp flat(exp);
+ *        FlatExp flat(nodes);
+ * ---------------------------
+ * Creates an empty expression or a flattened copy of the tree exp.
+ * The tree still belongs to the caller.  The last form takes nodes
+ * that are already in postorder, as getNode returns them; the caller
+ * is responsible for their shape.
+ */
+
+   FlatExp();
+   FlatExp(Expression *exp);
+   FlatExp(const std::vector<ExpNode> & nodes);
+
+/*
+ * Methods: eval, toString
+ * -----------------------
+ * These methods behave exactly like the ones of the tree that was
+ * flattened.
+ */
+
+   int eval(EvalState & state);
+   std::string toString();
+
+/*
+ * Methods: size, getNode
+ * Usage: for (int i = 0; i < flat.size(); i++) ... flat.getNode(i) ...
+ * ---------------------------------------------------------------------
+ * Give access to the nodes in postorder, for clients such as the
+ * bytecode compiler that translate them one by one.
+ */
+
+   int size();
+   const ExpNode & getNode(int index);
+
+private:
+
+   std::vector<ExpNode> nodes;
+   std::vector<int> values;     /* scratch space for eval, one per node */
+
+   int add(Expression *exp);
+   std::string toString(int index);
+
+};
+
 #endif
@@ -0,0 +1,161 @@
+/*
+ * File: fold.cpp
+ * --------------
+ * Implements the fold.h interface.
+ */
+
+#include <climits>
+#include <utility>
+#include "exp.h"
+#include "fold.h"
+using namespace std;
+
+/*
+ * Implementation notes: arithmetic
+ * --------------------------------
+ * Folded values are computed in unsigned arithmetic, which wraps the way
+ * the int operations of eval() do on every machine this runs on, so a
+ * folded chain produces the same bits as the unfolded one.  A division
+ * is folded only when eval() could not fail or trap on it.
+ */
+
+static int wrap(unsigned value) {
+   return (int) value;
+}
+
+static bool canDivide(int left, int right) {
+   return right != 0 && !(left == INT_MIN && right == -1);
+}
+
+static int apply(Operator op, int left, int right) {
+   switch (op) {
+   case PLUS: return wrap((unsigned) left + (unsigned) right);
+   case MINUS: return wrap((unsigned) left - (unsigned) right);
+   case TIMES: return wrap((unsigned) left * (unsigned) right);
+   case DIVIDE: return left / right;
+   }
+   return 0;
+}
+
+/*
+ * Implementation notes: cannotFail
+ * --------------------------------
+ * Returns true if evaluating exp can raise no error at all.  Reading a
+ * variable can fail, so only arithmetic over constants qualifies; such
+ * trees are almost always folded already, which keeps 0 * x rare.
+ */
+
+static bool cannotFail(Expression *exp) {
+   if (exp->getType() == CONSTANT) return true;
+   if (exp->getType() == IDENTIFIER || exp->getType() == ARRAY) return false;
+   CompoundExp *cexp = (CompoundExp *) exp;
+   if (!cannotFail(cexp->getLHS()) || !cannotFail(cexp->getRHS())) return false;
+   if (cexp->getOperator() != DIVIDE) return true;
+   return cexp->getRHS()->getType() == CONSTANT
+       && cexp->getLHS()->getType() == CONSTANT
+       && canDivide(((ConstantExp *) cexp->getLHS())->getValue(),
+                    ((ConstantExp *) cexp->getRHS())->getValue());
+}
+
+/*
+ * Implementation notes: replaceWith
+ * ---------------------------------
+ * Frees a compound node but keeps the child that survives it.
+ */
+
+static Expression *replaceWith(CompoundExp *cexp, Expression *keep) {
+   if (cexp->getLHS() == keep) cexp->setLHS(NULL);
+   if (cexp->getRHS() == keep) cexp->setRHS(NULL);
+   delete cexp;
+   return keep;
+}
+
+/*
+ * Implementation notes: addConstant
+ * ---------------------------------
+ * Builds exp + k, written as exp - |k| when k is negative so that the
+ * folded form reads naturally, or just exp when k is zero.
+ */
+
+static Expression *addConstant(Expression *exp, int k) {
+   if (k == 0) return exp;
+   if (k < 0 && k != INT_MIN) return new CompoundExp(MINUS, exp, new ConstantExp(-k));
+   return new CompoundExp(PLUS, exp, new ConstantExp(k));
+}
+
+Expression *foldExp(Expression *exp) {
+   if (exp->getType() == ARRAY) {
+      ArrayExp *aexp = (ArrayExp *) exp;
+      aexp->setIndex(foldExp(aexp->getIndex()));
+      return exp;
+   }
+   if (exp->getType() != COMPOUND) return exp;
+   CompoundExp *cexp = (CompoundExp *) exp;
+   cexp->setLHS(foldExp(cexp->getLHS()));
+   cexp->setRHS(foldExp(cexp->getRHS()));
+   Operator op = cexp->getOperator();
+   Expression *lhs = cexp->getLHS();
+   Expression *rhs = cexp->getRHS();
+
+   /* Both operands constant: compute the node now. */
+   if (lhs->getType() == CONSTANT && rhs->getType() == CONSTANT) {
+      int left = ((ConstantExp *) lhs)->getValue();
+      int right = ((ConstantExp *) rhs)->getValue();
+      if (op != DIVIDE || canDivide(left, right)) {
+         delete cexp;
+         return new ConstantExp(apply(op, left, right));
+      }
+      return cexp;
+   }
+
+   /* Move a constant to the right of + and *, so chains gather below. */
+   if ((op == PLUS || op == TIMES) && lhs->getType() == CONSTANT) {
+      cexp->setLHS(rhs);
+      cexp->setRHS(lhs);
+      swap(lhs, rhs);
+   }
+
+   if (rhs->getType() == CONSTANT) {
+      int k = ((ConstantExp *) rhs)->getValue();
+
+      /* (a + c1) + k, (a - c1) - k and the other mixes become a + c. */
+      if ((op == PLUS || op == MINUS) && lhs->getType() == COMPOUND) {
+         CompoundExp *inner = (CompoundExp *) lhs;
+         Operator iop = inner->getOperator();
+         if ((iop == PLUS || iop == MINUS) && inner->getRHS()->getType() == CONSTANT) {
+            unsigned c = ((ConstantExp *) inner->getRHS())->getValue();
+            if (iop == MINUS) c = 0u - c;
+            c = (op == PLUS) ? c + (unsigned) k : c - (unsigned) k;
+            Expression *a = inner->getLHS();
+            inner->setLHS(NULL);
+            delete cexp;
+            return addConstant(a, wrap(c));
+         }
+      }
+
+      /* (a * c1) * k becomes a * c. */
+      if (op == TIMES && lhs->getType() == COMPOUND) {
+         CompoundExp *inner = (CompoundExp *) lhs;
+         if (inner->getOperator() == TIMES && inner->getRHS()->getType() == CONSTANT) {
+            ConstantExp *c1 = (ConstantExp *) inner->getRHS();
+            int c = apply(TIMES, c1->getValue(), k);
+            inner->setRHS(new ConstantExp(c));
+            delete c1;
+            return foldExp(replaceWith(cexp, inner));
+         }
+      }
+
+      /* Identities on the right operand. */
+      if ((op == PLUS || op == MINUS) && k == 0) return replaceWith(cexp, lhs);
+      if ((op == TIMES || op == DIVIDE) && k == 1) return replaceWith(cexp, lhs);
+      if (op == TIMES && k == 0 && cannotFail(lhs)) {
+         delete cexp;
+         return new ConstantExp(0);
+      }
+      if (op == MINUS && k < 0 && k != INT_MIN) {
+         return addConstant(replaceWith(cexp, lhs), -k);
+      }
+   }
+
+   return cexp;
+}
@@ -0,0 +1,34 @@
+/*
+ * File: fold.h
+ * ------------
+ * This file exports the constant folding pass, which simplifies an
+ * expression tree once, when its line is stored, so that the work is
+ * not repeated every time the line runs.
+ */
+
+#ifndef _fold_h
+#define _fold_h
+
+#include "exp.h"
+
+/*
+ * Function: foldExp
+ * Usage: exp = foldExp(exp);
+ * --------------------------
+ * Returns a tree that evaluates to the same value as exp and raises the
+ * same errors in the same cases.  The pass
+ *
+ *  1. folds compound nodes whose operands are both constants,
+ *  2. gathers the constants of + - and * chains such as x + 1 + 2,
+ *  3. removes identities such as x * 1, x + 0 and x / 1, and
+ *  4. replaces 0 * x by 0 only when x can never raise an error.
+ *
+ * A division whose divisor folds to zero is kept, so that DIVIDE BY
+ * ZERO is still raised when the line runs.  The argument is consumed:
+ * nodes that disappear are freed, and the caller must use the result
+ * in place of exp.  Use toString() on the result to see the folded form.
+ */
+
+Expression *foldExp(Expression *exp);
+
+#endif
@@ -0,0 +1,229 @@
+/*
+ * File: image.cpp
+ * ---------------
+ * This file implements the ImageWriter and ImageReader classes.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "evalstate.h"
+#include "exp.h"
+#include "image.h"
+#include "../StanfordCPPLib/error.h"
+using namespace std;
+
+static const char MAGIC[8] = { 'B', 'A', 'S', 'I', 'C', 'I', 'M', 'G' };
+static const int VERSION = 1;
+
+/* ImageWriter */
+
+ImageWriter::ImageWriter() {
+   /* Empty */
+}
+
+void ImageWriter::writeInt(int value) {
+   body.append((const char *) &value, sizeof value);
+}
+
+void ImageWriter::writeString(const string & str) {
+   writeInt(str.size());
+   body.append(str);
+}
+
+void ImageWriter::writeSlot(int slot) {
+   if (slot < 0) {
+      writeInt(-1);
+      return;
+   }
+   map<int,int>::iterator it = indices.find(slot);
+   if (it == indices.end()) {
+      it = indices.insert(make_pair(slot, (int) names.size())).first;
+      names.push_back(EvalState::nameOf(slot));
+   }
+   writeInt(it->second);
+}
+
+/*
+ * Implementation notes: writeExp
+ * ------------------------------
+ * An expression is its node count followed by the nodes.  A node is
+ * one byte holding its type and operator, then the constant or slot if
+ * it has one.  The operand indices are not stored, because readExp can
+ * recompute them from the postorder, and that recomputation is the
+ * check that the nodes form a single tree.
+ */
+
+void ImageWriter::writeExp(FlatExp & exp) {
+   writeInt(exp.size());
+   for (int i = 0; i < exp.size(); i++) {
+      const ExpNode & node = exp.getNode(i);
+      body.push_back((char) (node.type | node.op << 2));
+      switch (node.type) {
+      case CONSTANT:
+         writeInt(node.value);
+         break;
+      case IDENTIFIER: case ARRAY:
+         writeSlot(node.value);
+         break;
+      case COMPOUND:
+         break;
+      }
+   }
+}
+
+void ImageWriter::save(const string & filename) {
+   string header(MAGIC, sizeof MAGIC);
+   header.append((const char *) &VERSION, sizeof VERSION);
+   int count = names.size();
+   header.append((const char *) &count, sizeof count);
+   for (int i = 0; i < count; i++) {
+      int size = names[i].size();
+      header.append((const char *) &size, sizeof size);
+      header.append(names[i]);
+   }
+   FILE *file = fopen(filename.c_str(), "wb");
+   if (file == NULL) error("CANNOT WRITE FILE");
+   bool ok = fwrite(header.data(), 1, header.size(), file) == header.size()
+          && fwrite(body.data(), 1, body.size(), file) == body.size();
+   if (fclose(file) != 0) ok = false;
+   if (!ok) error("CANNOT WRITE FILE");
+}
+
+/* ImageReader */
+
+/*
+ * Implementation notes: ImageReader
+ * ---------------------------------
+ * The file is mapped read-only and private, so the reads below are
+ * plain memory copies.  The descriptor can be closed at once; the
+ * mapping stays until the destructor.
+ */
+
+ImageReader::ImageReader(const string & filename) {
+   base = NULL;
+   length = cursor = 0;
+   int fd = open(filename.c_str(), O_RDONLY);
+   if (fd < 0) error("CANNOT READ FILE");
+   struct stat info;
+   if (fstat(fd, &info) != 0) {
+      close(fd);
+      error("CANNOT READ FILE");
+   }
+   length = info.st_size;
+   if (length > 0) {
+      void *mem = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mem == MAP_FAILED) {
+         close(fd);
+         error("CANNOT READ FILE");
+      }
+      base = (const char *) mem;
+   }
+   close(fd);
+   try {
+      if (memcmp(take(sizeof MAGIC), MAGIC, sizeof MAGIC) != 0) error("BAD IMAGE FILE");
+      if (readInt() != VERSION) error("BAD IMAGE FILE");
+      int count = readInt();
+      if (count < 0) error("BAD IMAGE FILE");
+      for (int i = 0; i < count; i++) {
+         string name = readString();
+         if (name.empty()) error("BAD IMAGE FILE");
+         slots.push_back(EvalState::intern(name));
+      }
+   } catch (...) {
+      if (base != NULL) munmap((void *) base, length);
+      throw;
+   }
+}
+
+ImageReader::~ImageReader() {
+   if (base != NULL) munmap((void *) base, length);
+}
+
+const char *ImageReader::take(size_t bytes) {
+   if (bytes > length - cursor) error("BAD IMAGE FILE");
+   const char *p = base + cursor;
+   cursor += bytes;
+   return p;
+}
+
+bool ImageReader::atEnd() {
+   return cursor == length;
+}
+
+int ImageReader::readInt() {
+   int value;
+   memcpy(&value, take(sizeof value), sizeof value);
+   return value;
+}
+
+string ImageReader::readString() {
+   int size = readInt();
+   if (size < 0) error("BAD IMAGE FILE");
+   return string(take(size), size);
+}
+
+int ImageReader::readSlot() {
+   int index = readInt();
+   if (index == -1) return -1;
+   if (index < 0 || index >= (int) slots.size()) error("BAD IMAGE FILE");
+   return slots[index];
+}
+
+/*
+ * Implementation notes: readExp
+ * -----------------------------
+ * The nodes are rebuilt with a stack of node indices, as an evaluator
+ * of postorder would: a leaf pushes itself, an operator pops its
+ * operands.  The expression is well formed if nothing underflows and
+ * exactly the root is left at the end.
+ */
+
+void ImageReader::readExp(FlatExp & exp) {
+   int count = readInt();
+   if (count < 0 || (size_t) count > length - cursor) error("BAD IMAGE FILE");
+   vector<ExpNode> nodes(count);
+   vector<int> stack;
+   for (int i = 0; i < count; i++) {
+      ExpNode & node = nodes[i];
+      unsigned char tag = *take(1);
+      node.type = (ExpressionType) (tag & 3);
+      node.op = PLUS;
+      node.value = 0;
+      node.lhs = node.rhs = -1;
+      switch (node.type) {
+      case CONSTANT:
+         if (tag != CONSTANT) error("BAD IMAGE FILE");
+         node.value = readInt();
+         break;
+      case IDENTIFIER:
+         node.value = readSlot();
+         if (tag != IDENTIFIER || node.value < 0) error("BAD IMAGE FILE");
+         break;
+      case ARRAY:
+         node.value = readSlot();
+         if (tag != ARRAY || node.value < 0 || stack.empty()) error("BAD IMAGE FILE");
+         node.lhs = stack.back();
+         stack.pop_back();
+         break;
+      case COMPOUND: {
+         if (tag > (DIVIDE << 2 | COMPOUND) || stack.size() < 2) error("BAD IMAGE FILE");
+         node.op = (Operator) (tag >> 2);
+         node.rhs = stack.back();
+         stack.pop_back();
+         node.lhs = stack.back();
+         stack.pop_back();
+         break;
+      }
+      }
+      stack.push_back(i);
+   }
+   if (stack.size() != ((count == 0) ? 0 : 1)) error("BAD IMAGE FILE");
+   exp = FlatExp(nodes);
+}
@@ -0,0 +1,132 @@
+/*
+ * File: image.h
+ * -------------
+ * This interface exports the ImageWriter and ImageReader classes, which
+ * store a parsed program in a compact binary file and bring it back
+ * without scanning its lines again.
+ */
+
+#ifndef _image_h
+#define _image_h
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+#include "exp.h"
+
+/*
+ * File format
+ * -----------
+ * An image starts with an eight-byte tag and a version number, then the
+ * table of variable names and then the body that the program wrote
+ * through the write methods.  Slots are stored as indices into the name
+ * table, since slot numbers depend on the order in which a process
+ * interned its names.  Numbers are 32-bit in the byte order of the
+ * machine; an image is a cache for fast startup, not an exchange
+ * format.
+ */
+
+/*
+ * Class: ImageWriter
+ * ------------------
+ * Collects an image in memory; save writes it out in one go.
+ */
+
+class ImageWriter {
+
+public:
+
+   ImageWriter();
+
+/*
+ * Methods: writeInt, writeString, writeSlot, writeExp
+ * Usage: image.writeSlot(slot);
+ * -----------------------------
+ * Append a value to the body.  writeSlot adds the name of slot to the
+ * name table the first time it is seen; -1 is written as is.
+ */
+
+   void writeInt(int value);
+   void writeString(const std::string & str);
+   void writeSlot(int slot);
+   void writeExp(FlatExp & exp);
+
+/*
+ * Method: save
+ * Usage: image.save(filename);
+ * ----------------------------
+ * Writes the image to filename, raising CANNOT WRITE FILE on failure.
+ */
+
+   void save(const std::string & filename);
+
+private:
+
+   std::string body;
+   std::map<int,int> indices;         /* slot -> index in names */
+   std::vector<std::string> names;
+
+};
+
+/*
+ * Class: ImageReader
+ * ------------------
+ * Maps an image file into memory and reads it back.  The constructor
+ * checks the header and interns every name in the table, so readSlot
+ * returns slots that are valid in this process.  Every read is checked
+ * against the end of the file and every expression against the shape
+ * FlatExp relies on, so a damaged image raises BAD IMAGE FILE instead
+ * of producing a broken program.
+ */
+
+class ImageReader {
+
+public:
+
+/*
+ * Constructor: ImageReader
+ * Usage: ImageReader image(filename);
+ * -----------------------------------
+ * Opens and maps filename, raising CANNOT READ FILE if that fails.
+ */
+
+   ImageReader(const std::string & filename);
+   ~ImageReader();
+
+/*
+ * Method: atEnd
+ * Usage: while (!image.atEnd()) . . .
+ * -----------------------------------
+ * Returns true once the whole body has been read.
+ */
+
+   bool atEnd();
+
+/*
+ * Methods: readInt, readString, readSlot, readExp
+ * Usage: int slot = image.readSlot();
+ * -----------------------------------
+ * Read back what the matching write method stored.
+ */
+
+   int readInt();
+   std::string readString();
+   int readSlot();
+   void readExp(FlatExp & exp);
+
+private:
+
+   const char *base;           /* the mapping, NULL for an empty file */
+   size_t length;
+   size_t cursor;
+   std::vector<int> slots;     /* index in the name table -> slot */
+
+   const char *take(size_t bytes);
+
+   ImageReader(const ImageReader &);
+   ImageReader & operator=(const ImageReader &);
+
+};
+
+#endif
@@ -0,0 +1,506 @@
+/*
+ * File: jit.cpp
+ * -------------
+ * This file implements the Jit class for x86-64 under the System V
+ * calling convention.  Elsewhere compile() always returns NULL and the
+ * bytecode machine keeps interpreting.
+ */
+
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+#include "jit.h"
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define JIT_X86_64
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#ifdef JIT_X86_64
+
+/*
+ * Implementation notes: registers
+ * -------------------------------
+ * The operand stack of the machine is kept in registers: depth d lives
+ * in STACK[d].  rdi and rsi hold the two slot arrays and rbp the array
+ * table, which arrives in rdx; eax and edx are left free for idiv and
+ * eax for element addresses.  rbx, rbp and r12-r15 belong to the
+ * caller, so the prologue saves them.
+ */
+
+enum { RAX = 0, RCX = 1, RDX = 2, RBX = 3, RBP = 5, RSI = 6, RDI = 7,
+       R8 = 8, R9, R10, R11, R12, R13, R14, R15 };
+
+static const int STACK[] = { R8, R9, R10, R11, RCX, RBX, R12, R13, R14, R15 };
+static const int MAX_DEPTH = sizeof STACK / sizeof STACK[0];
+static const int SAVED[] = { RBX, RBP, R12, R13, R14, R15 };
+static const int NSAVED = sizeof SAVED / sizeof SAVED[0];
+
+enum { CC_AE = 0x3, CC_E = 0x4, CC_S = 0x8, CC_L = 0xC, CC_G = 0xF };
+
+/*
+ * Class: Assembler
+ * ----------------
+ * Appends encoded instructions to a byte vector.  Only the handful of
+ * forms the translation needs are here, all on 32-bit operands.
+ */
+
+class Assembler {
+
+public:
+
+   vector<unsigned char> bytes;
+
+   int size() {
+      return bytes.size();
+   }
+
+   void byte(int b) {
+      bytes.push_back((unsigned char) b);
+   }
+
+   void int32(int value) {
+      unsigned u = value;
+      for (int i = 0; i < 4; i++) byte((u >> (8 * i)) & 0xFF);
+   }
+
+   void rex(int reg, int rm) {
+      int bits = ((reg >> 3) << 2) | (rm >> 3);
+      if (bits != 0) byte(0x40 | bits);
+   }
+
+   void modrm(int mod, int reg, int rm) {
+      byte((mod << 6) | ((reg & 7) << 3) | (rm & 7));
+   }
+
+   void movImm(int dst, int value) {           /* mov dst, imm32          */
+      rex(0, dst);
+      byte(0xB8 + (dst & 7));
+      int32(value);
+   }
+
+   void movReg(int dst, int src) {             /* mov dst, src            */
+      rex(src, dst);
+      byte(0x89);
+      modrm(3, src, dst);
+   }
+
+   void load(int dst, int slot) {              /* mov dst, [rdi + 4*slot] */
+      rex(dst, RDI);
+      byte(0x8B);
+      modrm(2, dst, RDI);
+      int32(4 * slot);
+   }
+
+   void store(int slot, int src) {             /* mov [rdi + 4*slot], src */
+      rex(src, RDI);
+      byte(0x89);
+      modrm(2, src, RDI);
+      int32(4 * slot);
+   }
+
+   void arith(int opcode, int dst, int src) {  /* add/sub/cmp dst, src    */
+      rex(src, dst);
+      byte(opcode);
+      modrm(3, src, dst);
+   }
+
+   void imul(int dst, int src) {               /* imul dst, src           */
+      rex(dst, src);
+      byte(0x0F);
+      byte(0xAF);
+      modrm(3, dst, src);
+   }
+
+   void test(int reg) {                        /* test reg, reg           */
+      rex(reg, reg);
+      byte(0x85);
+      modrm(3, reg, reg);
+   }
+
+   void idiv(int src) {                        /* cdq; idiv src           */
+      byte(0x99);
+      rex(0, src);
+      byte(0xF7);
+      modrm(3, 7, src);
+   }
+
+   void movPtr(int dst, int src) {             /* mov dst, src (64-bit)   */
+      byte(0x48 | ((src >> 3) << 2) | (dst >> 3));
+      byte(0x89);
+      modrm(3, src, dst);
+   }
+
+   void cmpField(int reg, int offset) {        /* cmp reg, [rbp + offset] */
+      rex(reg, RBP);
+      byte(0x3B);
+      modrm(2, reg, RBP);
+      int32(offset);
+   }
+
+   void loadField(int dst, int offset) {       /* mov dst, [rbp + offset] */
+      byte(0x48 | ((dst >> 3) << 2));          /* (64-bit)                */
+      byte(0x8B);
+      modrm(2, dst, RBP);
+      int32(offset);
+   }
+
+   void sib(int index) {                       /* [rax + 4*index]         */
+      byte((2 << 6) | ((index & 7) << 3) | RAX);
+   }
+
+   void loadElement(int dst, int index) {      /* mov dst, [rax + 4*index] */
+      int bits = ((dst >> 3) << 2) | ((index >> 3) << 1);
+      if (bits != 0) byte(0x40 | bits);
+      byte(0x8B);
+      modrm(0, dst, 4);
+      sib(index);
+   }
+
+   void storeElement(int index, int src) {     /* mov [rax + 4*index], src */
+      int bits = ((src >> 3) << 2) | ((index >> 3) << 1);
+      if (bits != 0) byte(0x40 | bits);
+      byte(0x89);
+      modrm(0, src, 4);
+      sib(index);
+   }
+
+   void rexw(int reg, int index, int base) {   /* REX.W with the extensions */
+      byte(0x48 | ((reg >> 3) << 2) | ((index >> 3) << 1) | (base >> 3));
+   }
+
+   void loadSaved(int dst) {                   /* mov dst, [rsp] (64-bit) */
+      rexw(dst, 0, 0);
+      byte(0x8B);
+      modrm(0, dst, 4);
+      byte(0x24);
+   }
+
+   void loadWide(int dst, int base, int offset) {   /* movsxd dst, [base + offset] */
+      rexw(dst, 0, base);
+      byte(0x63);
+      modrm(2, dst, base);
+      int32(offset);
+   }
+
+   void loadWideIndexed(int dst, int base, int index) {   /* movsxd dst, [base + 4*index] */
+      rexw(dst, index, base);
+      byte(0x63);
+      modrm(0, dst, 4);
+      byte((2 << 6) | ((index & 7) << 3) | (base & 7));
+   }
+
+   void storeIndexed(int base, int index, int src) {   /* mov [base + 4*index], src */
+      int bits = ((src >> 3) << 2) | ((index >> 3) << 1) | (base >> 3);
+      if (bits != 0) byte(0x40 | bits);
+      byte(0x89);
+      modrm(0, src, 4);
+      byte((2 << 6) | ((index & 7) << 3) | (base & 7));
+   }
+
+   void arithWide(int opcode, int dst, int src) {   /* add/cmp/test dst, src (64-bit) */
+      rexw(src, 0, dst);
+      byte(opcode);
+      modrm(3, src, dst);
+   }
+
+   void testDefined(int slot) {                /* cmp byte [rsi+slot], 0  */
+      byte(0x80);
+      modrm(2, 7, RSI);
+      int32(slot);
+      byte(0);
+   }
+
+   void setDefined(int slot) {                 /* mov byte [rsi+slot], 1  */
+      byte(0xC6);
+      modrm(2, 0, RSI);
+      int32(slot);
+      byte(1);
+   }
+
+   int jcc(int cc) {                           /* jcc rel32, patched later */
+      byte(0x0F);
+      byte(0x80 + cc);
+      int32(0);
+      return size() - 4;
+   }
+
+   int jmp() {                                 /* jmp rel32, patched later */
+      byte(0xE9);
+      int32(0);
+      return size() - 4;
+   }
+
+   void patch(int at, int target) {
+      int rel = target - (at + 4);
+      memcpy(&bytes[at], &rel, 4);
+   }
+
+   void push(int reg) {
+      rex(0, reg);
+      byte(0x50 + (reg & 7));
+   }
+
+   void pop(int reg) {
+      rex(0, reg);
+      byte(0x58 + (reg & 7));
+   }
+
+   void ret() {
+      byte(0xC3);
+   }
+
+};
+
+/*
+ * Function: stackEffect
+ * ---------------------
+ * Returns how an instruction changes the depth of the operand stack.
+ */
+
+static int stackEffect(OpCode op) {
+   switch (op) {
+   case OP_PUSH: case OP_LOAD: case OP_FETCH:
+      return 1;
+   case OP_STORE: case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV:
+   case OP_POP: case OP_PRINT: case OP_AINPUT: case OP_DIM:
+      return -1;
+   case OP_ASTORE: case OP_JEQ: case OP_JLT: case OP_JGT:
+      return -2;
+   case OP_FOR:
+      return -3;
+   default:
+      return 0;
+   }
+}
+
+/*
+ * Implementation notes: translateNext
+ * -----------------------------------
+ * The NEXT that closes the loop works on the ForLoop passed in, which
+ * stays put while native code runs because FOR and every other NEXT
+ * leave it.  The sum is formed in 64 bits like the machine does; when
+ * the loop is over, the counter is left alone and the code exits at the
+ * NEXT itself, so the machine steps the counter and pops the loop.  The
+ * operand stack is empty here, so its registers are free.
+ */
+
+static void translateNext(Assembler & as, int start, int at,
+                          vector< pair<int,int> > & internal,
+                          vector< pair<int,int> > & exits) {
+   const int SLOT = offsetof(ForLoop, slot);
+   const int LIMIT = offsetof(ForLoop, limit);
+   const int STEP = offsetof(ForLoop, step);
+   as.loadSaved(RDX);                             /* the ForLoop        */
+   as.loadWide(R11, RDX, SLOT);
+   as.loadWideIndexed(R8, RDI, R11);              /* the counter        */
+   as.loadWide(R9, RDX, STEP);
+   as.arithWide(0x01, R8, R9);                    /* add r8, r9         */
+   as.loadWide(R10, RDX, LIMIT);
+   as.arithWide(0x85, R9, R9);                    /* test r9, r9        */
+   int down = as.jcc(CC_S);
+   as.arithWide(0x39, R8, R10);                   /* cmp r8, r10        */
+   exits.push_back(make_pair(as.jcc(CC_G), at));
+   int store = as.jmp();
+   as.patch(down, as.size());
+   as.arithWide(0x39, R8, R10);
+   exits.push_back(make_pair(as.jcc(CC_L), at));
+   as.patch(store, as.size());
+   as.storeIndexed(RDI, R11, R8);
+   internal.push_back(make_pair(as.jmp(), start));
+}
+
+/*
+ * Implementation notes: translate
+ * -------------------------------
+ * The operand stack depth at each instruction is known statically, so
+ * each stack cell is a fixed register.  Every exit is a jump to a stub
+ * that loads the offset to resume at into eax and goes to the shared
+ * epilogue; stubs are shared between exits to the same offset.  Jumps
+ * are patched once all offsets are known.  A STORE marks its slot
+ * defined as the machine does, since the variable may get its first
+ * value inside the loop.  An element access compares
+ * the index with the length as unsigned numbers, so that a negative
+ * index, an index past the end and an array without storage all leave
+ * through the same exit.
+ */
+
+static bool translate(const vector<Instruction> & code, int start, int end,
+                      Assembler & as) {
+   static const int ARITH[] = { 0x01, 0x29 };     /* add, sub */
+   const int DATA = offsetof(IntArray, data);
+   const int LENGTH = offsetof(IntArray, length);
+   set<int> loaded;
+   int depth = 0;
+   for (int i = start; i <= end; i++) {
+      if (code[i].op == OP_LOAD) loaded.insert(code[i].arg);
+      depth += stackEffect(code[i].op);
+      if (depth > MAX_DEPTH) return false;
+   }
+
+   vector<int> offsets(end - start + 1);
+   vector< pair<int,int> > internal;     /* rel32 position, instruction */
+   vector< pair<int,int> > exits;        /* rel32 position, resume at   */
+
+   for (int k = 0; k < NSAVED; k++) as.push(SAVED[k]);
+   as.push(RCX);                                  /* the ForLoop, at [rsp] */
+   as.movPtr(RBP, RDX);
+   for (set<int>::iterator it = loaded.begin(); it != loaded.end(); it++) {
+      as.testDefined(*it);
+      exits.push_back(make_pair(as.jcc(CC_E), start));
+   }
+
+   depth = 0;
+   int statement = start;
+   for (int i = start; i <= end; i++) {
+      const Instruction & ins = code[i];
+      offsets[i - start] = as.size();
+      if (depth == 0) statement = i;
+      int top = (depth > 0) ? STACK[depth - 1] : -1;
+      int next = (depth > 1) ? STACK[depth - 2] : -1;
+      int array = ins.arg * sizeof(IntArray);
+      switch (ins.op) {
+      case OP_PUSH:
+         as.movImm(STACK[depth], ins.arg);
+         break;
+      case OP_LOAD: case OP_FETCH:
+         as.load(STACK[depth], ins.arg);
+         break;
+      case OP_STORE:
+         as.store(ins.arg, top);
+         as.setDefined(ins.arg);
+         break;
+      case OP_ADD: case OP_SUB:
+         as.arith(ARITH[ins.op - OP_ADD], next, top);
+         break;
+      case OP_MUL:
+         as.imul(next, top);
+         break;
+      case OP_DIV:
+         as.test(top);
+         exits.push_back(make_pair(as.jcc(CC_E), statement));
+         as.movReg(RAX, next);
+         as.idiv(top);
+         as.movReg(next, RAX);
+         break;
+      case OP_POP:
+         break;
+      case OP_ALOAD:
+         as.cmpField(top, array + LENGTH);
+         exits.push_back(make_pair(as.jcc(CC_AE), statement));
+         as.loadField(RAX, array + DATA);
+         as.loadElement(top, top);
+         break;
+      case OP_ASTORE:
+         as.cmpField(next, array + LENGTH);
+         exits.push_back(make_pair(as.jcc(CC_AE), statement));
+         as.loadField(RAX, array + DATA);
+         as.storeElement(next, top);
+         break;
+      case OP_JUMP: case OP_JEQ: case OP_JLT: case OP_JGT: {
+         int at;
+         if (ins.op == OP_JUMP) {
+            at = as.jmp();
+         } else {
+            as.arith(0x39, next, top);                  /* cmp */
+            at = as.jcc((ins.op == OP_JEQ) ? CC_E : (ins.op == OP_JLT) ? CC_L : CC_G);
+         }
+         if (ins.arg >= start && ins.arg <= end) {
+            internal.push_back(make_pair(at, ins.arg));
+         } else {
+            exits.push_back(make_pair(at, ins.arg));
+         }
+         break;
+      }
+      case OP_NEXT:
+         if (i == end) {
+            translateNext(as, start, i, internal, exits);
+            break;
+         }
+         exits.push_back(make_pair(as.jmp(), statement));
+         break;
+      default:           /* PRINT, INPUT, AINPUT, DIM, FOR, GOSUB, RETURN, ... */
+         exits.push_back(make_pair(as.jmp(), statement));
+         break;
+      }
+      depth += stackEffect(ins.op);
+   }
+   exits.push_back(make_pair(as.jmp(), end + 1));
+
+   int epilogue = as.size();
+   as.pop(RCX);
+   for (int k = NSAVED - 1; k >= 0; k--) as.pop(SAVED[k]);
+   as.ret();
+
+   map<int,int> stubs;
+   for (size_t k = 0; k < exits.size(); k++) {
+      int resume = exits[k].second;
+      if (stubs.count(resume) == 0) {
+         stubs[resume] = as.size();
+         as.movImm(RAX, resume);
+         as.patch(as.jmp(), epilogue);
+      }
+      as.patch(exits[k].first, stubs[resume]);
+   }
+   for (size_t k = 0; k < internal.size(); k++) {
+      as.patch(internal[k].first, offsets[internal[k].second - start]);
+   }
+   return true;
+}
+
+#endif
+
+Jit::Jit() {
+   /* Empty */
+}
+
+Jit::~Jit() {
+   clear();
+}
+
+bool Jit::isSupported() {
+#ifdef JIT_X86_64
+   return true;
+#else
+   return false;
+#endif
+}
+
+NativeLoop Jit::compile(const vector<Instruction> & code, int start, int end) {
+#ifdef JIT_X86_64
+   Assembler as;
+   if (!translate(code, start, end, as)) return NULL;
+   size_t page = sysconf(_SC_PAGESIZE);
+   size_t length = (as.bytes.size() + page - 1) / page * page;
+   void *mem = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANON, -1, 0);
+   if (mem == MAP_FAILED) return NULL;
+   memcpy(mem, &as.bytes[0], as.bytes.size());
+   if (mprotect(mem, length, PROT_READ | PROT_EXEC) != 0) {
+      munmap(mem, length);
+      return NULL;
+   }
+   blocks.push_back(make_pair(mem, length));
+   return (NativeLoop) mem;
+#else
+   (void) code;
+   (void) start;
+   (void) end;
+   return NULL;
+#endif
+}
+
+void Jit::clear() {
+#ifdef JIT_X86_64
+   for (size_t i = 0; i < blocks.size(); i++) {
+      munmap(blocks[i].first, blocks[i].second);
+   }
+#endif
+   blocks.clear();
+}
@@ -0,0 +1,87 @@
+/*
+ * File: jit.h
+ * -----------
+ * This interface exports the Jit class, which translates hot loops of
+ * the bytecode machine into x86-64 machine code.
+ */
+
+#ifndef _jit_h
+#define _jit_h
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "bytecode.h"
+
+/*
+ * Class: Jit
+ * ----------
+ * Compiles a range of instructions that starts at a line and ends with
+ * the backward jump closing the loop.  Arithmetic, LOAD, FETCH, STORE
+ * and the jumps become machine code.  Everything the native code cannot
+ * do itself leaves it at the start of the statement concerned:
+ *
+ *  - PRINT, INPUT, DIM, FOR, NEXT, GOSUB, RETURN, END and a jump to a
+ *    missing line;
+ *  - a division by zero;
+ *  - a jump out of the range, or falling off its end;
+ *  - on entry, a variable read in the range that is not defined yet
+ *    (FETCH reads need no check, see Analysis).
+ *
+ * A statement changes nothing until its final STORE, PRINT or jump,
+ * so the machine then simply executes that statement again and raises
+ * any error itself.  That STORE must have every effect the machine's
+ * has, so it marks the variable defined as well as setting it: code
+ * after the loop checks the mark before reading the variable.
+ *
+ * The code lives in its own pages, which are never writable and
+ * executable at once, and goes away with clear().
+ */
+
+class Jit {
+
+public:
+
+   Jit();
+   ~Jit();
+
+/*
+ * Static method: isSupported
+ * Usage: if (Jit::isSupported()) . . .
+ * ------------------------------------
+ * Returns true if this build can generate code for the machine it
+ * runs on.
+ */
+
+   static bool isSupported();
+
+/*
+ * Method: compile
+ * Usage: NativeLoop loop = jit.compile(code, start, end);
+ * -------------------------------------------------------
+ * Translates code[start..end], which must begin a line and end with a
+ * jump back to start.  Returns NULL if the range cannot be compiled,
+ * for instance because an expression is too deep for the registers.
+ */
+
+   NativeLoop compile(const std::vector<Instruction> & code, int start, int end);
+
+/*
+ * Method: clear
+ * Usage: jit.clear();
+ * -------------------
+ * Frees every loop compiled so far.
+ */
+
+   void clear();
+
+private:
+
+   std::vector< std::pair<void *,size_t> > blocks;
+
+   Jit(const Jit &);
+   Jit & operator=(const Jit &);
+
+};
+
+#endif
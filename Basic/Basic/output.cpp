@@ -0,0 +1,85 @@
+/*
+ * File: output.cpp
+ * ----------------
+ * This file implements the OutputSink class.
+ */
+
+#include <iostream>
+#include <string>
+#include "output.h"
+using namespace std;
+
+OutputSink::OutputSink(ostream & out, size_t threshold) {
+   this->out = &out;
+   this->threshold = threshold;
+   interactive = false;
+   buffer.reserve(threshold);
+}
+
+OutputSink::~OutputSink() {
+   flush();
+}
+
+void OutputSink::setInteractive(bool flag) {
+   interactive = flag;
+   if (interactive) flush();
+}
+
+bool OutputSink::isInteractive() {
+   return interactive;
+}
+
+void OutputSink::setThreshold(size_t bytes) {
+   threshold = bytes;
+   if (buffer.size() >= threshold) flush();
+}
+
+void OutputSink::write(const string & text) {
+   buffer.insert(buffer.end(), text.begin(), text.end());
+   if (interactive || buffer.size() >= threshold) flush();
+}
+
+/*
+ * Implementation notes: writeInteger
+ * ----------------------------------
+ * Digits are produced right to left into a small array, working on the
+ * unsigned magnitude so that INT_MIN needs no special case.
+ */
+
+void OutputSink::writeInteger(int value) {
+   char digits[12];
+   char *p = digits + sizeof digits;
+   unsigned magnitude = (value < 0) ? 0u - (unsigned) value : (unsigned) value;
+   do {
+      *--p = '0' + magnitude % 10;
+      magnitude /= 10;
+   } while (magnitude != 0);
+   if (value < 0) *--p = '-';
+   buffer.insert(buffer.end(), p, digits + sizeof digits);
+   if (buffer.size() >= threshold) flush();
+}
+
+void OutputSink::writeLine(const string & text) {
+   buffer.insert(buffer.end(), text.begin(), text.end());
+   endLine();
+}
+
+void OutputSink::endLine() {
+   buffer.push_back('\n');
+   if (interactive || buffer.size() >= threshold) flush();
+}
+
+void OutputSink::flush() {
+   if (!buffer.empty()) out->write(&buffer[0], buffer.size());
+   buffer.clear();
+   out->flush();
+}
+
+void OutputSink::beforeInput() {
+   flush();
+}
+
+OutputSink & standardOutput() {
+   static OutputSink sink(cout);
+   return sink;
+}
@@ -0,0 +1,132 @@
+/*
+ * File: output.h
+ * --------------
+ * This interface exports the OutputSink class, which collects what the
+ * interpreter prints in a large buffer and decides when to hand it to
+ * the underlying stream.
+ */
+
+#ifndef _output_h
+#define _output_h
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+ * Class: OutputSink
+ * -----------------
+ * Everything PRINT, LIST and the error reports write goes through a
+ * sink.  In batch use the text is kept in user space and written out
+ * in large blocks, so a program printing a million lines costs a few
+ * hundred writes instead of a million.  The buffer is flushed
+ *
+ *  - when it holds more than the threshold,
+ *  - before INPUT reads a value, so the prompt is always visible,
+ *  - after every write, if the sink is interactive,
+ *  - whenever flush is called: after RUN (END or falling off the end),
+ *    before an error message is shown, on QUIT and at exit, and
+ *    before a session waits for its next command.
+ *
+ * An interactive sink therefore behaves like writing to cout with endl,
+ * which is what the interpreter uses when stdin is a TTY.
+ */
+
+class OutputSink {
+
+public:
+
+/*
+ * Constructor: OutputSink
+ * Usage: OutputSink sink(out);
+ *        OutputSink sink(out, threshold);
+ * ---------------------------------------
+ * Creates a non-interactive sink in front of out that flushes once it
+ * holds threshold bytes (64K by default).
+ */
+
+   OutputSink(std::ostream & out, size_t threshold = 65536);
+
+/*
+ * Destructor: ~OutputSink
+ * -----------------------
+ * Flushes whatever is still buffered.
+ */
+
+   ~OutputSink();
+
+/*
+ * Methods: setInteractive, isInteractive
+ * Usage: sink.setInteractive(isatty(0));
+ * --------------------------------------
+ * Selects line-at-a-time flushing for a user at a terminal.
+ */
+
+   void setInteractive(bool flag);
+   bool isInteractive();
+
+/*
+ * Method: setThreshold
+ * Usage: sink.setThreshold(bytes);
+ * --------------------------------
+ * Changes the number of buffered bytes that triggers a flush.
+ */
+
+   void setThreshold(size_t bytes);
+
+/*
+ * Methods: write, writeInteger, writeLine, endLine
+ * Usage: sink.writeInteger(value); sink.endLine();
+ *        sink.writeLine(text);
+ * ------------------------------------------------
+ * Append text, a decimal integer, or a newline.  writeLine is write
+ * followed by endLine.
+ */
+
+   void write(const std::string & text);
+   void writeInteger(int value);
+   void writeLine(const std::string & text);
+   void endLine();
+
+/*
+ * Method: flush
+ * Usage: sink.flush();
+ * --------------------
+ * Writes the buffered text to the stream and flushes the stream.
+ */
+
+   void flush();
+
+/*
+ * Method: beforeInput
+ * Usage: sink.beforeInput();
+ * --------------------------
+ * Called by INPUT after its prompt: flushes, so whatever drives the
+ * interpreter has seen the prompt before the program waits for it.
+ */
+
+   void beforeInput();
+
+private:
+
+   std::ostream *out;
+   std::vector<char> buffer;
+   size_t threshold;
+   bool interactive;
+
+   OutputSink(const OutputSink &);
+   OutputSink & operator=(const OutputSink &);
+
+};
+
+/*
+ * Function: standardOutput
+ * Usage: OutputSink & out = standardOutput();
+ * -------------------------------------------
+ * Returns the sink in front of cout that every EvalState starts with.
+ * It is flushed when the program exits normally.
+ */
+
+OutputSink & standardOutput();
+
+#endif
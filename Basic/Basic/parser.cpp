@@ -59,13 +59,25 @@ Expression *readE(TokenScanner & scanner, int prec) {
  * Implementation notes: readT
  * ---------------------------
  * This function scans a term, which is either an integer, an identifier,
- * or a parenthesized subexpression.
+ * an array element, or a parenthesized subexpression.
  */
 
 Expression *readT(TokenScanner & scanner) {
    string token = scanner.nextToken();
    TokenType type = scanner.getTokenType(token);
-   if (type == WORD) return new IdentifierExp(token);
+   if (type == WORD) {
+      string next = scanner.nextToken();
+      if (next != "(") {
+         scanner.saveToken(next);
+         return new IdentifierExp(token);
+      }
+      Expression *index = readE(scanner);
+      if (scanner.nextToken() != ")") {
+         delete index;
+         error("Unbalanced parentheses in expression");
+      }
+      return new ArrayExp(token, index);
+   }
    if (type == NUMBER) return new ConstantExp(stringToInteger(token));
    if (token != "(") error("Illegal term in expression");
    Expression *exp = readE(scanner);
@@ -0,0 +1,167 @@
+/*
+ * File: profile.cpp
+ * -----------------
+ * This file implements the Profile class.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "profile.h"
+#include "program.h"
+using namespace std;
+
+static long long now() {
+   return chrono::duration_cast<chrono::nanoseconds>(
+      chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Profile::Profile() {
+   current = -1;
+   lineStart = waitStart = waited = elapsed = 0;
+}
+
+void Profile::start(const vector<int> & numbers) {
+   lines.assign(numbers.size(), LineProfile());
+   for (size_t i = 0; i < numbers.size(); i++) lines[i].number = numbers[i];
+   calls.clear();
+   open.assign(numbers.size(), 0);
+   current = -1;
+   lineStart = now();
+   waited = elapsed = 0;
+}
+
+/*
+ * Implementation notes: charge
+ * ----------------------------
+ * Adds the time since the running line was entered to that line and
+ * starts the clock for whatever comes next.  The run as a whole is
+ * charged even between lines, so its time covers every GOSUB.
+ */
+
+void Profile::charge(long long time) {
+   if (current >= 0) {
+      LineProfile & line = lines[current];
+      if (open[current] == 0) line.total += time - lineStart;
+      line.self += time - lineStart - waited;
+   }
+   elapsed += time - lineStart;
+   lineStart = time;
+   waited = 0;
+}
+
+void Profile::enterLine(int index) {
+   charge(now());
+   current = index;
+   lines[index].count++;
+}
+
+void Profile::branch(bool taken) {
+   if (current < 0) return;
+   if (taken) {
+      lines[current].taken++;
+   } else {
+      lines[current].notTaken++;
+   }
+}
+
+/*
+ * Implementation notes: call, ret
+ * -------------------------------
+ * The GOSUB line is charged up to the jump and then stops running, so
+ * nothing of the subroutine lands in its self time; RETURN adds the
+ * whole time since the jump to its total.  A line that calls itself
+ * again before returning is timed only from its outermost GOSUB, and
+ * charge leaves the total of a line alone while it is open, so
+ * recursion is not counted twice.  The instruction after a GOSUB or
+ * RETURN always starts a line, and enterLine picks it up from there.
+ */
+
+void Profile::call() {
+   long long time = now();
+   charge(time);
+   if (current < 0) return;
+   ProfileCall entry = { current, time };
+   calls.push_back(entry);
+   open[current]++;
+   current = -1;
+}
+
+void Profile::ret() {
+   long long time = now();
+   charge(time);
+   current = -1;
+   if (!calls.empty()) close(time);
+}
+
+void Profile::close(long long time) {
+   ProfileCall entry = calls.back();
+   calls.pop_back();
+   if (--open[entry.line] == 0) lines[entry.line].total += time - entry.start;
+}
+
+void Profile::pause() {
+   waitStart = now();
+}
+
+void Profile::resume() {
+   waited += now() - waitStart;
+}
+
+void Profile::finish() {
+   long long time = now();
+   charge(time);
+   current = -1;
+   while (!calls.empty()) close(time);
+}
+
+static bool hotter(const LineProfile & a, const LineProfile & b) {
+   if (a.self != b.self) return a.self > b.self;
+   if (a.count != b.count) return a.count > b.count;
+   return a.number < b.number;
+}
+
+static string millis(long long nanos) {
+   char buffer[32];
+   snprintf(buffer, sizeof buffer, "%.3f", nanos / 1e6);
+   return buffer;
+}
+
+/*
+ * Implementation notes: toString
+ * ------------------------------
+ * The columns are LINE, COUNT, TOTAL and SELF (in milliseconds), then
+ * the jumps TAKEN and NOT taken, then the line itself.  A last row sums
+ * the counts and self times over every line; its TOTAL is the time the
+ * whole run took, since the totals of GOSUB lines overlap the lines of
+ * their subroutines.
+ */
+
+string Profile::toString(Program & program) {
+   vector<LineProfile> ran;
+   LineProfile sum = LineProfile();
+   for (size_t i = 0; i < lines.size(); i++) {
+      if (lines[i].count == 0) continue;
+      ran.push_back(lines[i]);
+      sum.count += lines[i].count;
+      sum.self += lines[i].self;
+   }
+   sum.total = elapsed;
+   sort(ran.begin(), ran.end(), hotter);
+   char row[128];
+   snprintf(row, sizeof row, "%8s %12s %12s %12s %10s %10s  %s\n",
+            "LINE", "COUNT", "TOTAL", "SELF", "TAKEN", "NOT", "SOURCE");
+   string report = row;
+   for (size_t i = 0; i < ran.size(); i++) {
+      const LineProfile & line = ran[i];
+      snprintf(row, sizeof row, "%8d %12lld %12s %12s %10lld %10lld  ",
+               line.number, line.count, millis(line.total).c_str(),
+               millis(line.self).c_str(), line.taken, line.notTaken);
+      report += row + program.getSourceLine(line.number) + "\n";
+   }
+   snprintf(row, sizeof row, "%8s %12lld %12s %12s\n", "ALL", sum.count,
+            millis(sum.total).c_str(), millis(sum.self).c_str());
+   return report + row;
+}
@@ -0,0 +1,124 @@
+/*
+ * File: profile.h
+ * ---------------
+ * This interface exports the Profile class, which collects per-line
+ * counts and times while the bytecode machine runs a program under
+ * the PROFILE command.
+ */
+
+#ifndef _profile_h
+#define _profile_h
+
+#include <string>
+#include <vector>
+
+class Program;
+
+/*
+ * Type: LineProfile
+ * -----------------
+ * What was measured for one program line.  Times are in nanoseconds.
+ * Self time is spent on the line itself, leaving out the time spent
+ * waiting for INPUT.  Total time includes that wait and, for a GOSUB
+ * line, everything from the jump to the matching RETURN.  taken and
+ * notTaken count the GOTO, IF and GOSUB jumps of the line.
+ */
+
+struct LineProfile {
+   int number;
+   long long count;
+   long long total;
+   long long self;
+   long long taken;
+   long long notTaken;
+};
+
+/*
+ * Type: ProfileCall
+ * -----------------
+ * A GOSUB the profile is still timing: the index of its line and when
+ * it jumped.
+ */
+
+struct ProfileCall {
+   int line;
+   long long start;
+};
+
+/*
+ * Class: Profile
+ * --------------
+ * The machine calls enterLine whenever execution reaches the first
+ * instruction of a line; the time since the previous call is charged
+ * to the line that was running.  Nothing here is touched by an
+ * ordinary RUN.
+ */
+
+class Profile {
+
+public:
+
+/*
+ * Constructor: Profile
+ * Usage: Profile profile;
+ * -----------------------
+ * Creates a profile with no lines.
+ */
+
+   Profile();
+
+/*
+ * Method: start
+ * Usage: profile.start(numbers);
+ * ------------------------------
+ * Clears the counters and sets up one entry per line number; the
+ * machine refers to lines by their index in numbers.
+ */
+
+   void start(const std::vector<int> & numbers);
+
+/*
+ * Methods: enterLine, branch, call, ret, pause, resume, finish
+ * ------------------------------------------------------------
+ * The hooks the machine calls.  call and ret bracket a subroutine and
+ * are called after the GOSUB and RETURN have jumped; pause and resume
+ * bracket a wait for input.  finish charges the last line, and any
+ * GOSUB still open, when the program stops, also when it stops with
+ * an error.
+ */
+
+   void enterLine(int index);
+   void branch(bool taken);
+   void call();
+   void ret();
+   void pause();
+   void resume();
+   void finish();
+
+/*
+ * Method: toString
+ * Usage: string report = profile.toString(program);
+ * -------------------------------------------------
+ * Returns the report: every line that ran, hottest (by self time)
+ * first, with its counters and source text.
+ */
+
+   std::string toString(Program & program);
+
+private:
+
+   std::vector<LineProfile> lines;
+   std::vector<ProfileCall> calls;  /* GOSUBs not yet returned from   */
+   std::vector<int> open;    /* per line, how many of calls are its   */
+   int current;              /* index of the running line, -1 if none */
+   long long lineStart;      /* when the running line was entered     */
+   long long waitStart;      /* when the current wait began           */
+   long long waited;         /* wait charged to the running line      */
+   long long elapsed;        /* time since start                      */
+
+   void charge(long long now);
+   void close(long long now);
+
+};
+
+#endif
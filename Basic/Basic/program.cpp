@@ -11,55 +11,203 @@
 #include <string>
 #include "program.h"
 #include "statement.h"
+#include "../StanfordCPPLib/error.h"
 using namespace std;
 
-Program::Program() {
+/*
+ * Implementation notes: jump targets
+ * ----------------------------------
+ * jumpTarget says which line a statement may jump to.  Every entry that
+ * jumps is also listed in jumpsTo under its target number, whether or
+ * not that line exists yet, so adding or removing the target only has
+ * to visit the entries that mention it.
+ */
+
+static int jumpTarget(Statement *stmt) {
+    if (stmt==NULL) return -1;
+    if (stmt->getType()==GOTO) return ((GotoStmt *) stmt)->getTarget();
+    if (stmt->getType()==IF) return ((IfStmt *) stmt)->getTarget();
+    if (stmt->getType()==GOSUB) return ((GosubStmt *) stmt)->getTarget();
+    return -1;
+}
+
+Program::Program():first(NULL),compiled(false),bytes(0) {
 
 }
 
 Program::~Program() {
-    lines.clear();
-    stms.clear();
+    for (ProgramLine *p=first;p!=NULL;p=p->next) release(p);
 }
 
 void Program::clear(EvalState & state) {    //just clear
+    for (ProgramLine *p=first;p!=NULL;p=p->next) release(p);
     lines.clear();
-    stms.clear();
+    jumpsTo.clear();
+    first=NULL;
+    compiled=false;
+    bytes=0;
     state.clean();
+    state.setProgramBytes(0);
 }
 
-void Program::addSourceLine(int lineNumber, string line) {  //nothing to say
-    if (!lines.count(lineNumber)) lines.insert(pair<int,string>(lineNumber,line));
-        else lines[lineNumber]=line;
+void Program::addSourceLine(int lineNumber, string line) {  //a new entry is linked between its neighbours
+    compiled=false;
+    map<int,ProgramLine>::iterator it=lines.find(lineNumber);
+    if (it!=lines.end()) {
+        ProgramLine *entry=&it->second;
+        bytes-=lineBytes(entry);
+        clearJump(entry);
+        release(entry);
+        entry->source=line;
+        bytes+=lineBytes(entry);
+        return;
+    }
+    it=lines.insert(pair<int,ProgramLine>(lineNumber,ProgramLine())).first;
+    ProgramLine *entry=&it->second;
+    entry->number=lineNumber;
+    entry->source=line;
+    entry->stmt=NULL;
+    entry->arena=NULL;
+    entry->target=NULL;
+    bytes+=lineBytes(entry);
+    map<int,ProgramLine>::iterator after=it;
+    ++after;
+    entry->next=(after==lines.end())?NULL:&after->second;
+    if (it==lines.begin()) first=entry;
+    else {
+        map<int,ProgramLine>::iterator before=it;
+        (--before)->second.next=entry;
+    }
+    map<int,vector<ProgramLine*> >::iterator refs=jumpsTo.find(lineNumber);
+    if (refs!=jumpsTo.end()) {  //jumps that used to miss now land here
+        for (size_t i=0;i<refs->second.size();i++) refs->second[i]->target=entry;
+    }
 }
 
-void Program::removeSourceLine(int lineNumber) {    //nothing to say
-   if (lines.count(lineNumber)) lines.erase(lineNumber);
+void Program::removeSourceLine(int lineNumber) {    //unlink the entry and the jumps landing on it
+   map<int,ProgramLine>::iterator it=lines.find(lineNumber);
+   if (it==lines.end()) return;
+   compiled=false;
+   ProgramLine *entry=&it->second;
+   if (it==lines.begin()) first=entry->next;
+   else {
+       map<int,ProgramLine>::iterator before=it;
+       (--before)->second.next=entry->next;
+   }
+   map<int,vector<ProgramLine*> >::iterator refs=jumpsTo.find(lineNumber);
+   if (refs!=jumpsTo.end()) {
+       for (size_t i=0;i<refs->second.size();i++) refs->second[i]->target=NULL;
+   }
+   clearJump(entry);
+   bytes-=lineBytes(entry);
+   release(entry);
+   lines.erase(it);
 }
 
 string Program::getSourceLine(int lineNumber) { //nothing to say
-    if (lines.count(lineNumber))    return lines[lineNumber];
-   return "";    
+    ProgramLine *entry=getLine(lineNumber);
+    return (entry==NULL)?"":entry->source;
 }
 
-void Program::setParsedStatement(int lineNumber, Statement *stmt) { //nothing to say
-    if (!stms.count(lineNumber)) stms.insert(pair<int,Statement*>(lineNumber,stmt));
-    else stms[lineNumber]=stmt;
+void Program::setParsedStatement(int lineNumber, Statement *stmt, Arena *arena) { //the old statement is freed
+    ProgramLine *entry=getLine(lineNumber);
+    if (entry==NULL) error("LINE NUMBER ERROR");
+    compiled=false;
+    clearJump(entry);
+    bytes-=lineBytes(entry);
+    if (entry->stmt!=stmt) release(entry);
+    entry->stmt=stmt;
+    entry->arena=arena;
+    bytes+=lineBytes(entry);
+    setJump(entry);
 }
 
 Statement *Program::getParsedStatement(int lineNumber) {    //nothing to say
-    if (stms.count(lineNumber)) return stms[lineNumber];
-   return NULL;  
+    ProgramLine *entry=getLine(lineNumber);
+    return (entry==NULL)?NULL:entry->stmt;
 }
 
-int Program::getFirstLineNumber() { //map has automatic ascending order of the key value,which is cool
-
-    if (lines.size()>0) return lines.begin()->first;
-   else return -1;     
+int Program::getFirstLineNumber() { //the head of the links
+    return (first==NULL)?-1:first->number;
 }
 
 int Program::getNextLineNumber(int lineNumber) {    //has or hasnt the next linenumber
-  if ((++lines.find(lineNumber)!=lines.end())&&(lines.find(lineNumber)!=lines.end()))
-            return (++lines.find(lineNumber))->first;
-   else return -1;    
+    ProgramLine *entry=getLine(lineNumber);
+    if ((entry==NULL)||(entry->next==NULL)) return -1;
+    return entry->next->number;
+}
+
+ProgramLine *Program::getFirstLine() {
+    return first;
+}
+
+ProgramLine *Program::getLine(int lineNumber) {
+    map<int,ProgramLine>::iterator it=lines.find(lineNumber);
+    return (it==lines.end())?NULL:&it->second;
+}
+
+void Program::release(ProgramLine *entry) {   //the statement first,for the heap it owns,then its arena
+    delete entry->stmt;
+    delete entry->arena;
+    entry->stmt=NULL;
+    entry->arena=NULL;
+}
+
+void Program::setJump(ProgramLine *entry) { //register the jump and resolve it once
+    int target=jumpTarget(entry->stmt);
+    if (target==-1) return;
+    jumpsTo[target].push_back(entry);
+    entry->target=getLine(target);
+}
+
+void Program::clearJump(ProgramLine *entry) {
+    int target=jumpTarget(entry->stmt);
+    entry->target=NULL;
+    if (target==-1) return;
+    vector<ProgramLine*> & refs=jumpsTo[target];
+    for (size_t i=0;i<refs.size();i++) {
+        if (refs[i]==entry) {
+            refs[i]=refs.back();
+            refs.pop_back();
+            break;
+        }
+    }
+    if (refs.empty()) jumpsTo.erase(target);
+}
+
+/*
+ * Implementation notes: memory
+ * ----------------------------
+ * A line is counted as its entry, a map node for it, its source and its
+ * arena, plus room for one expression node per character.  The count
+ * is kept up to date as lines change, so the cap can be checked on
+ * every line without walking the program.
+ */
+
+size_t Program::lineBytes(const string & source, Arena *arena) {
+    size_t node=sizeof(ProgramLine)+4*sizeof(void *);
+    size_t exp=source.size()*(sizeof(ExpNode)+sizeof(int));
+    return node+source.size()+exp+((arena==NULL)?0:arena->getBytes());
+}
+
+size_t Program::lineBytes(ProgramLine *entry) {
+    return lineBytes(entry->source,entry->arena);
+}
+
+size_t Program::getBytes() {
+    return bytes+(compiled?code.getBytes():0);
+}
+
+size_t Program::getBytesWith(int lineNumber, string line, Arena *arena) {
+    ProgramLine *entry=getLine(lineNumber);
+    size_t old=(entry==NULL)?0:lineBytes(entry);
+    return bytes-old+lineBytes(line,arena);
+}
+
+Bytecode & Program::getBytecode() {  //compile lazily,the next change throws it away
+    if (!compiled) {
+        code.compile(*this);
+        compiled=true;
+    }
+    return code;
 }
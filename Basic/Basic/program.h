@@ -8,8 +8,11 @@
 #ifndef _program_h
 #define _program_h
 
+#include <map>
 #include <string>
+#include <vector>
 #include "statement.h"
+#include "bytecode.h"
 using namespace std;
 
 /*
@@ -23,8 +26,23 @@ using namespace std;
  *
  * 2. The parsed representation of that statement, which is a
  *    pointer to a Statement.
+ *
+ * Both live in a single ProgramLine entry, and the entries are linked
+ * in line-number order.  Each entry also caches the entry its GOTO or
+ * IF jumps to, so walking a program needs no searches at all: adding
+ * or removing a line only patches the links that point at it.
  */
 
+struct ProgramLine {
+   int number;
+   std::string source;
+   Statement *stmt;      /* NULL until a parsed statement is set      */
+   Arena *arena;         /* holds stmt and its nodes, NULL if on heap */
+   ProgramLine *next;    /* the following line, NULL at the end       */
+   ProgramLine *target;  /* where GOTO/IF/GOSUB jumps, NULL if no jump or
+                            if that line does not exist              */
+};
+
 class Program {
 
 public:
@@ -98,10 +116,12 @@ public:
  * Adds the parsed representation of the statement to the statement
  * at the specified line number.  If no such line exists, this
  * method raises an error.  If a previous parsed representation
- * exists, the memory for that statement is reclaimed.
+ * exists, the memory for that statement is reclaimed.  When arena
+ * is given, the program takes it over: it must hold stmt, and it is
+ * released in one step when the line is replaced, removed or cleared.
  */
 
-   void setParsedStatement(int lineNumber, Statement *stmt);
+   void setParsedStatement(int lineNumber, Statement *stmt, Arena *arena = NULL);
 
 /*
  * Method: getParsedStatement
@@ -135,10 +155,80 @@ public:
 
    int getNextLineNumber(int lineNumber);
 
+/*
+ * Method: getFirstLine
+ * Usage: for (ProgramLine *p = program.getFirstLine(); p; p = p->next)
+ * --------------------------------------------------------------------
+ * Returns the entry of the first line, or NULL if the program is empty.
+ * The entries stay valid until their line is replaced or removed.
+ */
+
+   ProgramLine *getFirstLine();
+
+/*
+ * Method: getLine
+ * Usage: ProgramLine *entry = program.getLine(lineNumber);
+ * --------------------------------------------------------
+ * Returns the entry for the specified line number, or NULL if there
+ * is no such line.
+ */
+
+   ProgramLine *getLine(int lineNumber);
+
+/*
+ * Method: getBytecode
+ * Usage: program.getBytecode().run(state);
+ * ----------------------------------------
+ * Returns the compiled form of the program.  The program is compiled
+ * again only if a line has changed since the last call.
+ */
+
+   Bytecode & getBytecode();
+
+/*
+ * Method: getBytes
+ * Usage: size_t bytes = program.getBytes();
+ * -----------------------------------------
+ * Returns the memory the program holds: its lines with their arenas,
+ * and the bytecode if it has been compiled.  This is what a session's
+ * memory cap counts for the program (see EvalState::setProgramBytes).
+ */
+
+   size_t getBytes();
+
+/*
+ * Method: getBytesWith
+ * Usage: size_t bytes = program.getBytesWith(lineNumber, line, arena);
+ * --------------------------------------------------------------------
+ * Returns what getBytes would return once line, parsed into arena,
+ * replaced the line with that number, without changing anything.
+ */
+
+   size_t getBytesWith(int lineNumber, std::string line, Arena *arena);
+
+/*
+ * Static method: lineBytes
+ * Usage: size_t bytes = Program::lineBytes(source, arena);
+ * --------------------------------------------------------
+ * Returns the memory a line with that source and arena takes up.  The
+ * expression arrays a statement keeps on the heap are not measured but
+ * bounded: they have at most one node per character of the source.
+ */
+
+   static size_t lineBytes(const std::string & source, Arena *arena);
+
 private:
-//I'd love to combine the two maps,since they're significantly related.But it seems a complicated structure.
-  map<int,string> lines;  
-  map<int,Statement*> stms; 
+  map<int,ProgramLine> lines;
+  ProgramLine *first;
+  map<int,vector<ProgramLine*> > jumpsTo;   //target line number -> entries jumping there
+  Bytecode code;    //compiled lines,valid while compiled is true
+  bool compiled;
+  size_t bytes;     //lineBytes of every line,the bytecode not included
+
+  void setJump(ProgramLine *entry);
+  size_t lineBytes(ProgramLine *entry);
+  void release(ProgramLine *entry);
+  void clearJump(ProgramLine *entry);
 };
 
 #endif
@@ -0,0 +1,341 @@
+/*
+ * File: server.cpp
+ * ----------------
+ * This file implements the Server class.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "server.h"
+using namespace std;
+
+/*
+ * Class: SocketBuffer
+ * -------------------
+ * A stream buffer over a connected socket, for both directions.  Reads
+ * end at the input limit, at the end of the connection and when the
+ * receive timeout expires.  Once a write fails the client is gone, and
+ * the rest of the output is dropped.
+ */
+
+class SocketBuffer : public streambuf {
+
+public:
+
+   SocketBuffer(int fd, size_t limit);
+
+protected:
+
+   int underflow();
+   int overflow(int ch);
+   int sync();
+
+private:
+
+   int fd;
+   size_t limit;
+   size_t received;
+   bool broken;
+   char input[4096];
+   char output[4096];
+
+   bool drain();
+
+};
+
+SocketBuffer::SocketBuffer(int fd, size_t limit) {
+   this->fd = fd;
+   this->limit = limit;
+   received = 0;
+   broken = false;
+   setg(input, input, input);
+   setp(output, output + sizeof output);
+}
+
+int SocketBuffer::underflow() {
+   size_t wanted = sizeof input;
+   if (limit != 0) {
+      if (received >= limit) return traits_type::eof();
+      wanted = min(wanted, limit - received);
+   }
+   ssize_t n;
+   do {
+      n = read(fd, input, wanted);
+   } while (n < 0 && errno == EINTR);
+   if (n <= 0) return traits_type::eof();
+   received += n;
+   setg(input, input, input + n);
+   return traits_type::to_int_type(input[0]);
+}
+
+int SocketBuffer::overflow(int ch) {
+   if (!drain()) return traits_type::eof();
+   if (ch != traits_type::eof()) {
+      *pptr() = traits_type::to_char_type(ch);
+      pbump(1);
+   }
+   return traits_type::not_eof(ch);
+}
+
+int SocketBuffer::sync() {
+   return drain() ? 0 : -1;
+}
+
+bool SocketBuffer::drain() {
+   const char *p = pbase();
+   while (!broken && p < pptr()) {
+      ssize_t n = send(fd, p, pptr() - p, MSG_NOSIGNAL);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) broken = true;
+      else p += n;
+   }
+   setp(output, output + sizeof output);
+   return !broken;
+}
+
+/*
+ * Class: LimitBuffer
+ * ------------------
+ * A read-only stream buffer that passes on the input of another one
+ * and ends it at the input limit, which gives job files the same cap
+ * as sockets.
+ */
+
+class LimitBuffer : public streambuf {
+
+public:
+
+   LimitBuffer(streambuf *source, size_t limit);
+
+protected:
+
+   int underflow();
+
+private:
+
+   streambuf *source;
+   size_t limit;
+   size_t received;
+   char input[4096];
+
+};
+
+LimitBuffer::LimitBuffer(streambuf *source, size_t limit) {
+   this->source = source;
+   this->limit = limit;
+   received = 0;
+   setg(input, input, input);
+}
+
+int LimitBuffer::underflow() {
+   size_t wanted = sizeof input;
+   if (limit != 0) {
+      if (received >= limit) return traits_type::eof();
+      wanted = min(wanted, limit - received);
+   }
+   streamsize n = source->sgetn(input, wanted);
+   if (n <= 0) return traits_type::eof();
+   received += n;
+   setg(input, input, input + n);
+   return traits_type::to_int_type(input[0]);
+}
+
+/* Server */
+
+Server::Server(int workers, Session session) {
+   this->session = session;
+   inputLimit = 0;
+   busy = 0;
+   closing = false;
+   if (workers < 1) workers = 1;
+   for (int i = 0; i < workers; i++) {
+      this->workers.push_back(thread(&Server::work, this));
+   }
+}
+
+Server::~Server() {
+   {
+      lock_guard<mutex> guard(lock);
+      closing = true;
+   }
+   ready.notify_all();
+   for (size_t i = 0; i < workers.size(); i++) {
+      workers[i].join();
+   }
+}
+
+void Server::setInputLimit(size_t bytes) {
+   inputLimit = bytes;
+}
+
+/*
+ * Implementation notes: work
+ * --------------------------
+ * Each worker takes the oldest task, runs it outside the lock and comes
+ * back for the next, until the server closes and the queue is empty.
+ * A task never lets an exception escape, since that would end the
+ * process; a session that fails only loses its client.
+ */
+
+void Server::work() {
+   while (true) {
+      function<void()> task;
+      {
+         unique_lock<mutex> guard(lock);
+         while (tasks.empty() && !closing) ready.wait(guard);
+         if (tasks.empty()) return;
+         task = tasks.front();
+         tasks.pop_front();
+         busy++;
+      }
+      try {
+         task();
+      } catch (exception & ex) {
+         cerr << "session failed: " << ex.what() << endl;
+      } catch (...) {
+         cerr << "session failed" << endl;
+      }
+      {
+         lock_guard<mutex> guard(lock);
+         busy--;
+         if (busy == 0 && tasks.empty()) idle.notify_all();
+      }
+      finished.notify_all();
+   }
+}
+
+void Server::submit(function<void()> task) {
+   {
+      lock_guard<mutex> guard(lock);
+      tasks.push_back(task);
+   }
+   ready.notify_one();
+}
+
+void Server::waitAll() {
+   unique_lock<mutex> guard(lock);
+   while (busy > 0 || !tasks.empty()) idle.wait(guard);
+}
+
+void Server::waitForSession() {
+   unique_lock<mutex> guard(lock);
+   finished.wait_for(guard, chrono::milliseconds(int(BACKOFF_MS)));
+}
+
+void Server::serveConnection(int fd) {
+   struct timeval timeout = { IDLE_SECONDS, 0 };
+   setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+   SocketBuffer buffer(fd, inputLimit);
+   istream in(&buffer);      /* two streams, so the end of the input */
+   ostream out(&buffer);     /* leaves the output usable             */
+   session(in, out);
+   out.flush();
+   shutdown(fd, SHUT_WR);
+   close(fd);
+}
+
+/*
+ * Implementation notes: serveSocket
+ * ---------------------------------
+ * The accepting thread does nothing but accept: every connection is
+ * queued at once, so a slow session holds a worker, never the others.
+ * A path that is already taken is only removed if it is a socket,
+ * which is what a server killed earlier leaves behind.  When the
+ * process or the system runs out of descriptors, the connection stays
+ * in the backlog and accept would fail again at once, so the thread
+ * waits for a session to end and close its socket, or for BACKOFF_MS
+ * at most, before it tries again.  The condition is logged once each
+ * time it starts.
+ */
+
+int Server::serveSocket(const string & path) {
+   struct sockaddr_un address;
+   if (path.size() >= sizeof address.sun_path) {
+      cerr << path << ": socket path too long" << endl;
+      return 2;
+   }
+   memset(&address, 0, sizeof address);
+   address.sun_family = AF_UNIX;
+   strcpy(address.sun_path, path.c_str());
+   int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+   if (listener < 0) {
+      cerr << path << ": " << strerror(errno) << endl;
+      return 2;
+   }
+   struct stat info;
+   if (lstat(path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) unlink(path.c_str());
+   if (bind(listener, (struct sockaddr *) &address, sizeof address) != 0
+       || listen(listener, SOMAXCONN) != 0) {
+      cerr << path << ": " << strerror(errno) << endl;
+      close(listener);
+      return 2;
+   }
+   bool exhausted = false;
+   while (true) {
+      int fd = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+      if (fd < 0) {
+         if (errno == EINTR || errno == ECONNABORTED) continue;
+         if (errno == EMFILE || errno == ENFILE) {
+            if (!exhausted) cerr << path << ": " << strerror(errno) << ", waiting" << endl;
+            exhausted = true;
+            waitForSession();
+            continue;
+         }
+         cerr << path << ": " << strerror(errno) << endl;
+         close(listener);
+         return 2;
+      }
+      exhausted = false;
+      submit([this, fd]() { serveConnection(fd); });
+   }
+}
+
+int Server::serveDirectory(const string & dir) {
+   DIR *listing = opendir(dir.c_str());
+   if (listing == NULL) {
+      cerr << dir << ": " << strerror(errno) << endl;
+      return 2;
+   }
+   vector<string> jobs;
+   while (struct dirent *entry = readdir(listing)) {
+      string name = entry->d_name;
+      string path = dir + "/" + name;
+      struct stat info;
+      if (name.size() >= 4 && name.compare(name.size() - 4, 4, ".out") == 0) continue;
+      if (stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode)) jobs.push_back(path);
+   }
+   closedir(listing);
+   sort(jobs.begin(), jobs.end());
+   mutex failedLock;
+   bool failed = false;
+   for (size_t i = 0; i < jobs.size(); i++) {
+      string job = jobs[i];
+      submit([this, job, &failedLock, &failed]() {
+         ifstream file(job.c_str());
+         ofstream out((job + ".out").c_str());
+         if (!file || !out) {
+            lock_guard<mutex> guard(failedLock);
+            cerr << job << ": cannot open job" << endl;
+            failed = true;
+            return;
+         }
+         LimitBuffer buffer(file.rdbuf(), inputLimit);
+         istream in(&buffer);
+         session(in, out);
+      });
+   }
+   waitAll();
+   return failed ? 2 : 0;
+}
@@ -0,0 +1,138 @@
+/*
+ * File: server.h
+ * --------------
+ * This interface exports the Server class, which runs many independent
+ * BASIC sessions at once on a pool of worker threads, taking them from
+ * a local socket or from a directory of job files.
+ */
+
+#ifndef _server_h
+#define _server_h
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Class: Server
+ * -------------
+ * A server owns a fixed number of worker threads and a queue of
+ * sessions waiting for one.  A session is a call of the function given
+ * to the constructor with the input and output streams of one client;
+ * the function is expected to keep all its state in local objects,
+ * which is what makes it safe to run several at once.  Limits on what
+ * a session may use are the business of that function, except for the
+ * size of the input, which the server caps itself.
+ */
+
+class Server {
+
+public:
+
+   typedef std::function<void(std::istream &, std::ostream &)> Session;
+
+/*
+ * Constructor: Server
+ * Usage: Server server(workers, session);
+ * ---------------------------------------
+ * Starts workers threads (at least one) that run session for every
+ * client the serve methods hand to them.
+ */
+
+   Server(int workers, Session session);
+
+/*
+ * Destructor: ~Server
+ * -------------------
+ * Lets the workers finish the sessions already queued, then joins them.
+ */
+
+   ~Server();
+
+/*
+ * Method: setInputLimit
+ * Usage: server.setInputLimit(bytes);
+ * -----------------------------------
+ * Ends the input of a session after bytes bytes, as if the client had
+ * closed the socket or the job file had ended there.  A limit of 0
+ * means none, the default.
+ */
+
+   void setInputLimit(size_t bytes);
+
+/*
+ * Method: serveSocket
+ * Usage: int status = server.serveSocket(path);
+ * ---------------------------------------------
+ * Listens on a Unix domain socket at path (replacing a stale socket
+ * left there) and runs a session for each connection: the commands
+ * are read from the connection and the output written back to it,
+ * which is closed when the session ends.  A client that sends nothing
+ * for IDLE_SECONDS is treated as gone.  Runs until the process is
+ * killed; returns 2 if the socket cannot be set up, with the reason on
+ * cerr.
+ */
+
+   int serveSocket(const std::string & path);
+
+/*
+ * Method: serveDirectory
+ * Usage: int status = server.serveDirectory(dir);
+ * -----------------------------------------------
+ * Runs every regular file in dir as a session, except those whose name
+ * ends in .out, writing the output of job to job.out in the same
+ * directory.  Returns once all jobs are done: 0, or 2 if the directory
+ * cannot be read or a job cannot be opened (reported on cerr; the
+ * other jobs still run).
+ */
+
+   int serveDirectory(const std::string & dir);
+
+/*
+ * Constant: IDLE_SECONDS
+ * ----------------------
+ * How long a socket session waits for its client before giving up.
+ */
+
+   static const int IDLE_SECONDS = 30;
+
+/*
+ * Constant: BACKOFF_MS
+ * --------------------
+ * The longest serveSocket waits before it accepts again after running
+ * out of file descriptors.
+ */
+
+   static const int BACKOFF_MS = 100;
+
+private:
+
+   Session session;
+   size_t inputLimit;
+   std::vector<std::thread> workers;
+   std::deque<std::function<void()> > tasks;
+   std::mutex lock;
+   std::condition_variable ready;     /* a task was queued          */
+   std::condition_variable idle;      /* the last busy worker ended */
+   std::condition_variable finished;  /* some task ended            */
+   int busy;
+   bool closing;
+
+   void submit(std::function<void()> task);
+   void waitAll();
+   void waitForSession();
+   void work();
+   void serveConnection(int fd);
+
+   Server(const Server &);
+   Server & operator=(const Server &);
+
+};
+
+#endif
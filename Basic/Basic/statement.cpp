@@ -7,9 +7,12 @@
  * BASIC statements.
  */
 
+#include <cctype>
 #include <string>
 #include "statement.h"
 #include <sstream>
+#include "../StanfordCPPLib/error.h"
+#include "fold.h"
 using namespace std;
 
 /* Implementation of the Statement class */
@@ -22,45 +25,132 @@ Statement::~Statement() {
    /* Empty */
 }
 
-LetStmt::LetStmt(string line):exp(line){
+/*
+ * the index of A(i) is read the same way by LET,INPUT and DIM
+ * the "(" has been taken already,the ")" must follow
+ */
+static FlatExp parseIndex(TokenScanner & scanner){
+    if (!scanner.hasMoreTokens()) error("SYNTAX ERROR");
+    Expression *e=foldExp(parseExp(scanner));
+    FlatExp index(e);
+    delete e;
+    if (scanner.nextToken()!=")") error("SYNTAX ERROR");
+    return index;
+}
+
+/*
+ * the words of statements and commands cannot name a variable,
+ * or a line like NEXT = 2 would be read as the wrong statement
+ * every statement that takes a name checks it with checkName
+ */
+static const char *KEYWORDS[]={
+    "LET","PRINT","INPUT","REM","GOTO","IF","THEN","END","DIM","FOR","TO",
+    "STEP","NEXT","GOSUB","RETURN","RUN","LIST","CLEAR","QUIT","HELP",
+    "PROFILE","COMPILE","CHECK","JIT","SAVE","LOAD"
+};
+
+bool isKeyword(string word){
+    for (size_t i=0;i<sizeof KEYWORDS/sizeof KEYWORDS[0];i++) {
+        if (word==KEYWORDS[i]) return true;
+    }
+    return false;
+}
 
+static void checkName(TokenScanner & scanner,string name){
+    if ((scanner.getTokenType(name)!=WORD)||isKeyword(name)) error("SYNTAX ERROR");
 }
+
+/*
+ * loadSlot and loadExp read the operands a statement cannot do without
+ * so a damaged image is refused instead of leaving them empty
+ */
+static int loadSlot(ImageReader & image){
+    int slot=image.readSlot();
+    if (slot<0) error("BAD IMAGE FILE");
+    return slot;
+}
+
+static void loadExp(ImageReader & image,FlatExp & exp){
+    image.readExp(exp);
+    if (exp.size()==0) error("BAD IMAGE FILE");
+}
+
+LetStmt::LetStmt(string line):exp(line),slot(-1){
+
+}
+
 StatementType LetStmt::getType(){
     return LET;
 }
 
 void LetStmt::execute(EvalState & state){
-    TokenScanner scanner;
-    scanner.ignoreWhitespace();
-    scanner.scanNumbers();
-    scanner.setInput(exp);
-    string name=scanner.nextToken();    //get the var name
-    scanner.nextToken();
-    Expression *e=parseExp(scanner);
-    int value=e->eval(state);   //get the value
-    state.setValue(name,value); //set it
+    if (isElement()){   //the index goes first
+        int i=index.eval(state);
+        state.setElement(slot,i,rhs.eval(state));
+        return;
+    }
+    int value=rhs.eval(state);   //get the value
+    state.setValue(slot,value); //set it
 }
 
 void LetStmt::execute(EvalState & state,int & lineNumber){
 
 }
 
+string LetStmt::getName(){
+    return name;
+}
+
+int LetStmt::getSlot(){
+    return slot;
+}
+
+FlatExp & LetStmt::getExp(){
+    return rhs;
+}
+
+bool LetStmt::isElement(){
+    return index.size()>0;
+}
+
+FlatExp & LetStmt::getIndex(){
+    return index;
+}
+
 bool LetStmt::valid(){
     TokenScanner scanner;
     scanner.ignoreWhitespace();
     scanner.scanNumbers();
     scanner.setInput(exp);
     if (!scanner.hasMoreTokens()) error("SYNTAX ERROR");    //basic operation
-    string name=scanner.nextToken();    
-    if ((scanner.getTokenType(name)!=WORD)||(name=="LET")||(name=="RUN")||(name=="INPUT")||(name=="QUIT")||(name=="HELP")||(name=="LIST")||(name=="IF")||(name=="THEN")||(name=="GOTO")||(name=="REM")) error("SYNTAX ERROR"); 
+    name=scanner.nextToken();    //get the var name
+    checkName(scanner,name);
     if (!scanner.hasMoreTokens()) error("SYNTAX ERROR");
-    if (scanner.nextToken()!="=") error("SYNTAX ERROR");
+    string token=scanner.nextToken();
+    if (token=="(") {index=parseIndex(scanner);token=scanner.nextToken();}    //LET A(i) = ...
+    if (token!="=") error("SYNTAX ERROR");
     if (!scanner.hasMoreTokens()) error("SYNTAX ERROR");
-    Expression *e=parseExp(scanner);    //get the expression
+    slot=EvalState::intern(name);
+    Expression *e=foldExp(parseExp(scanner));    //get the expression and keep it for execute
+    rhs=FlatExp(e);
+    delete e;
     if (scanner.hasMoreTokens()) error("SYNTAX ERROR");
     return true;
 }
 
+void LetStmt::save(ImageWriter & image){
+    image.writeSlot(slot);
+    image.writeExp(rhs);
+    image.writeExp(index);
+}
+
+void LetStmt::load(ImageReader & image){
+    slot=loadSlot(image);
+    name=EvalState::nameOf(slot);
+    loadExp(image,rhs);
+    image.readExp(index);   //empty unless A(i)
+}
+
 PrintStmt::PrintStmt(string line):exp(line){
     
 }
@@ -70,34 +160,41 @@ StatementType PrintStmt::getType(){
 }
 
 void PrintStmt::execute(EvalState & state){
-    TokenScanner scanner;
-    scanner.ignoreWhitespace();
-    scanner.scanNumbers();
-    scanner.setInput(exp);
-    Expression *ex = parseExp(scanner);
-    cout<<ex->eval(state)<<endl;    //just cout
+    OutputSink & out=state.getOutput();    //buffered,see output.h
+    out.writeInteger(ex.eval(state));
+    out.endLine();
 }
 
 void PrintStmt::execute(EvalState & state,int & lineNumber){
     
 }
 
+FlatExp & PrintStmt::getExp(){
+    return ex;
+}
+
 bool PrintStmt::valid(){    //basic operation
     TokenScanner scanner;
     scanner.ignoreWhitespace();
     scanner.scanNumbers();
     scanner.setInput(exp);
-    Expression *ex = parseExp(scanner);
+    Expression *e = foldExp(parseExp(scanner));
+    ex = FlatExp(e);
+    delete e;
     if (scanner.hasMoreTokens()) error("SYNTAX ERROR");
     return true;
 }
 
-InputStmt::InputStmt(string line):exp(line){
-    TokenScanner scanner;
-    scanner.ignoreWhitespace();
-    scanner.scanNumbers();
-    scanner.setInput(line);
-    name=scanner.nextToken();   //basic operation
+void PrintStmt::save(ImageWriter & image){
+    image.writeExp(ex);
+}
+
+void PrintStmt::load(ImageReader & image){
+    loadExp(image,ex);
+}
+
+InputStmt::InputStmt(string line):exp(line),slot(-1){
+
 }
 
 StatementType InputStmt::getType(){
@@ -105,30 +202,82 @@ StatementType InputStmt::getType(){
 }
 
 void InputStmt::execute(EvalState & state){
+    if (isElement()){   //check the index before asking
+        int i=index.eval(state);
+        state.getElement(slot,i);
+        state.setElement(slot,i,readInputValue(state));
+        return;
+    }
+    state.setValue(slot,readInputValue(state));
+}
+
+/*
+ * the common line is just an integer,so it is read by hand first
+ * anything else goes to the scanner,which decides what is invalid
+ */
+static bool readPlainInteger(const string & s,int & value){
+    size_t i=0,n=s.size();
+    while (i<n&&isspace((unsigned char)s[i])) i++;
+    bool negative=(i<n&&s[i]=='-');
+    if (negative) i++;
+    size_t start=i;
+    int magnitude=0;
+    while (i<n&&isdigit((unsigned char)s[i])){
+        if (i-start==9) return false;   //leave overflow to stringToInteger
+        magnitude=magnitude*10+(s[i]-'0');
+        i++;
+    }
+    if (i==start) return false;
+    while (i<n&&isspace((unsigned char)s[i])) i++;
+    if (i!=n) return false;
+    value=negative?-magnitude:magnitude;
+    return true;
+}
+
+int readInputValue(EvalState & state){
+    istream & in=state.getInput();
+    OutputSink & out=state.getOutput();
     string s,vstr;
-    int sign;
+    int sign,value;
     while (true){   //seems to circulate if wrong inputs are given
-    cout<<" ? ";
+    out.write(" ? ");
+    out.beforeInput();
     sign=1;
-    getline(cin,s);
+    if (!getline(in,s)) error("INPUT FAIL");  //no more values will come
+    if (readPlainInteger(s,value)) return value;
     TokenScanner scanner;
     scanner.ignoreWhitespace();
     scanner.scanNumbers();
     scanner.setInput(s);
     vstr=scanner.nextToken();
     if (vstr=="-") {sign=-1;vstr=scanner.nextToken();}  //negative values should be handled first
-    if ((vstr.find(".")!=string::npos)||(scanner.getTokenType(vstr)!=NUMBER)||(scanner.hasMoreTokens())){cout<<("INVALID NUMBER")<<endl;continue;}
+    if ((vstr.find(".")!=string::npos)||(scanner.getTokenType(vstr)!=NUMBER)||(scanner.hasMoreTokens())){out.writeLine("INVALID NUMBER");continue;}
     //I found the token will accept real numbers.It's not cool.
     break;
     }
-    int value=stringToInteger(vstr)*sign;
-    state.setValue(name,value);
+    return stringToInteger(vstr)*sign;
 }
 
 void InputStmt::execute(EvalState & state,int & lineNumber){
     
 }
 
+string InputStmt::getName(){
+    return name;
+}
+
+int InputStmt::getSlot(){
+    return slot;
+}
+
+bool InputStmt::isElement(){
+    return index.size()>0;
+}
+
+FlatExp & InputStmt::getIndex(){
+    return index;
+}
+
 bool InputStmt::valid(){
     TokenScanner scanner;
     scanner.ignoreWhitespace();
@@ -136,10 +285,27 @@ bool InputStmt::valid(){
     scanner.setInput(exp);
     if (!scanner.hasMoreTokens()) error("SYNTAX ERROR");
     name=scanner.nextToken();
+    checkName(scanner,name);
+    if (scanner.hasMoreTokens()){   //INPUT A(i)
+        if (scanner.nextToken()!="(") error("SYNTAX ERROR");
+        index=parseIndex(scanner);
+    }
     if (scanner.hasMoreTokens()) error("SYNTAX ERROR"); //basic operation
+    slot=EvalState::intern(name);
     return true;
 }
 
+void InputStmt::save(ImageWriter & image){
+    image.writeSlot(slot);
+    image.writeExp(index);
+}
+
+void InputStmt::load(ImageReader & image){
+    slot=loadSlot(image);
+    name=EvalState::nameOf(slot);
+    image.readExp(index);
+}
+
 RemStmt::RemStmt(string line):exp(line){
 
 }
@@ -165,6 +331,14 @@ bool RemStmt::valid(){ //nothing to say
     return true;
 }
 
+void RemStmt::save(ImageWriter & image){  //no operands
+
+}
+
+void RemStmt::load(ImageReader & image){
+
+}
+
 GotoStmt::GotoStmt(string line):exp(line){
 
 }
@@ -181,6 +355,10 @@ void GotoStmt::execute(EvalState & state,int & lineNumber){ //just change
     lineNumber=number;
 }
 
+int GotoStmt::getTarget(){
+    return number;
+}
+
 bool GotoStmt::valid(){ //nothing to say
     TokenScanner scanner;
     scanner.ignoreWhitespace();
@@ -190,7 +368,15 @@ bool GotoStmt::valid(){ //nothing to say
     if (scanner.hasMoreTokens()) error("SYNTAX ERROR");
     return true;    
 }
-IfStmt::IfStmt(string line):exp(line){
+
+void GotoStmt::save(ImageWriter & image){
+    image.writeInt(number);
+}
+
+void GotoStmt::load(ImageReader & image){
+    number=image.readInt();
+}
+IfStmt::IfStmt(string line):exp(line),number(-1){
 
 }
 
@@ -203,20 +389,25 @@ void IfStmt::execute(EvalState & state){
 }
 
 void IfStmt::execute(EvalState & state,int & lineNumber){   //easy to understand,change the lineNumber
-    TokenScanner scanner;
-    scanner.ignoreWhitespace();
-    scanner.scanNumbers();
-    scanner.setInput(exp);
-    Expression *lhs = parseExp(scanner);
-    int lvalue = lhs->eval(state);
-    string op=scanner.nextToken();
-    Expression *rhs = parseExp(scanner);
-    int rvalue = rhs->eval(state);
-    scanner.nextToken();
-    int number=stringToInteger(scanner.nextToken());
+    int lvalue = lhs.eval(state);
+    int rvalue = rhs.eval(state);
     if (((op=="=")&&(lvalue==rvalue))||((op==">")&&(lvalue>rvalue))||((op=="<")&&(lvalue<rvalue))) lineNumber=number;
-    delete lhs;
-    delete rhs;
+}
+
+string IfStmt::getOp(){
+    return op;
+}
+
+FlatExp & IfStmt::getLHS(){
+    return lhs;
+}
+
+FlatExp & IfStmt::getRHS(){
+    return rhs;
+}
+
+int IfStmt::getTarget(){
+    return number;
 }
 
 bool IfStmt::valid(){   //get the every token and judege whether they match the standard form
@@ -225,22 +416,40 @@ bool IfStmt::valid(){   //get the every token and judege whether they match the
     scanner.scanNumbers();
     scanner.setInput(exp);
     if (!scanner.hasMoreTokens()) error("SYNTAX ERROR");
-    Expression *lhs = parseExp(scanner);
+    Expression *e = foldExp(parseExp(scanner));
+    lhs = FlatExp(e);
+    delete e;
     if (!scanner.hasMoreTokens()) error("SYNTAX ERROR");
-    if (scanner.getTokenType(scanner.nextToken())!=OPERATOR) error("SYNTAX ERROR");
+    op=scanner.nextToken();
+    if (scanner.getTokenType(op)!=OPERATOR) error("SYNTAX ERROR");
     if (!scanner.hasMoreTokens()) error("SYNTAX ERROR");
-    Expression *rhs = parseExp(scanner);
+    e = foldExp(parseExp(scanner));
+    rhs = FlatExp(e);
+    delete e;
     if (!scanner.hasMoreTokens()) error("SYNTAX ERROR");
     if (scanner.nextToken()!="THEN") error("SYNTAX ERROR");
     if (!scanner.hasMoreTokens()) error("SYNTAX ERROR");
     string s=scanner.nextToken();
     if (scanner.getTokenType(s)!=NUMBER) error("SYNTAX ERROR");
     if (scanner.hasMoreTokens()) error("SYNTAX ERROR");
-    delete lhs;
-    delete rhs;
+    number=stringToInteger(s);
     return true;
 }
 
+void IfStmt::save(ImageWriter & image){
+    image.writeString(op);
+    image.writeExp(lhs);
+    image.writeExp(rhs);
+    image.writeInt(number);
+}
+
+void IfStmt::load(ImageReader & image){
+    op=image.readString();
+    loadExp(image,lhs);
+    loadExp(image,rhs);
+    number=image.readInt();
+}
+
 EndStmt::EndStmt(string line):exp(line){
 
 }
@@ -265,6 +474,275 @@ bool EndStmt::valid(){  //end the program
     if (scanner.hasMoreTokens()) error("SYNTAX ERROR");
     return true;
 }
+
+void EndStmt::save(ImageWriter & image){  //no operands
+
+}
+
+void EndStmt::load(ImageReader & image){
+
+}
+DimStmt::DimStmt(string line):exp(line),slot(-1){
+
+}
+
+StatementType DimStmt::getType(){
+    return DIM;
+}
+
+void DimStmt::execute(EvalState & state){
+    state.dimension(slot,bound.eval(state));
+}
+
+void DimStmt::execute(EvalState & state,int & lineNumber){
+
+}
+
+string DimStmt::getName(){
+    return name;
+}
+
+int DimStmt::getSlot(){
+    return slot;
+}
+
+FlatExp & DimStmt::getBound(){
+    return bound;
+}
+
+bool DimStmt::valid(){  //DIM name ( bound )
+    TokenScanner scanner;
+    scanner.ignoreWhitespace();
+    scanner.scanNumbers();
+    scanner.setInput(exp);
+    if (!scanner.hasMoreTokens()) error("SYNTAX ERROR");
+    name=scanner.nextToken();
+    checkName(scanner,name);
+    if (scanner.nextToken()!="(") error("SYNTAX ERROR");
+    bound=parseIndex(scanner);
+    if (scanner.hasMoreTokens()) error("SYNTAX ERROR");
+    slot=EvalState::intern(name);
+    return true;
+}
+
+void DimStmt::save(ImageWriter & image){
+    image.writeSlot(slot);
+    image.writeExp(bound);
+}
+
+void DimStmt::load(ImageReader & image){
+    slot=loadSlot(image);
+    name=EvalState::nameOf(slot);
+    loadExp(image,bound);
+}
+ForStmt::ForStmt(string line):exp(line),slot(-1){
+
+}
+
+StatementType ForStmt::getType(){
+    return FOR;
+}
+
+void ForStmt::execute(EvalState & state){   //the loop stack lives in the bytecode machine
+
+}
+
+void ForStmt::execute(EvalState & state,int & lineNumber){
+
+}
+
+string ForStmt::getName(){
+    return name;
+}
+
+int ForStmt::getSlot(){
+    return slot;
+}
+
+FlatExp & ForStmt::getStart(){
+    return start;
+}
+
+FlatExp & ForStmt::getLimit(){
+    return limit;
+}
+
+FlatExp & ForStmt::getStep(){
+    return step;
+}
+
+/*
+ * reads one expression of the FOR line,which must be followed by
+ * the word given (or by nothing if it is empty)
+ */
+static FlatExp parseForPart(TokenScanner & scanner,string until){
+    if (!scanner.hasMoreTokens()) error("SYNTAX ERROR");
+    Expression *e=foldExp(parseExp(scanner));
+    FlatExp part(e);
+    delete e;
+    if (scanner.nextToken()!=until) error("SYNTAX ERROR");
+    return part;
+}
+
+bool ForStmt::valid(){  //FOR name = start TO limit [STEP step]
+    TokenScanner scanner;
+    scanner.ignoreWhitespace();
+    scanner.scanNumbers();
+    scanner.setInput(exp);
+    if (!scanner.hasMoreTokens()) error("SYNTAX ERROR");
+    name=scanner.nextToken();
+    checkName(scanner,name);
+    if (scanner.nextToken()!="=") error("SYNTAX ERROR");
+    start=parseForPart(scanner,"TO");
+    if (!scanner.hasMoreTokens()) error("SYNTAX ERROR");
+    Expression *e=foldExp(parseExp(scanner));
+    limit=FlatExp(e);
+    delete e;
+    if (scanner.hasMoreTokens()){
+        if (scanner.nextToken()!="STEP") error("SYNTAX ERROR");
+        step=parseForPart(scanner,"");
+    } else {
+        ConstantExp one(1);
+        step=FlatExp(&one);
+    }
+    slot=EvalState::intern(name);
+    return true;
+}
+
+void ForStmt::save(ImageWriter & image){
+    image.writeSlot(slot);
+    image.writeExp(start);
+    image.writeExp(limit);
+    image.writeExp(step);
+}
+
+void ForStmt::load(ImageReader & image){
+    slot=loadSlot(image);
+    name=EvalState::nameOf(slot);
+    loadExp(image,start);
+    loadExp(image,limit);
+    loadExp(image,step);
+}
+
+NextStmt::NextStmt(string line):exp(line),slot(-1){
+
+}
+
+StatementType NextStmt::getType(){
+    return NEXT;
+}
+
+void NextStmt::execute(EvalState & state){
+
+}
+
+void NextStmt::execute(EvalState & state,int & lineNumber){
+
+}
+
+string NextStmt::getName(){
+    return name;
+}
+
+int NextStmt::getSlot(){
+    return slot;
+}
+
+bool NextStmt::valid(){ //NEXT [name]
+    TokenScanner scanner;
+    scanner.ignoreWhitespace();
+    scanner.scanNumbers();
+    scanner.setInput(exp);
+    if (!scanner.hasMoreTokens()) return true;
+    name=scanner.nextToken();
+    checkName(scanner,name);
+    if (scanner.hasMoreTokens()) error("SYNTAX ERROR");
+    slot=EvalState::intern(name);
+    return true;
+}
+
+void NextStmt::save(ImageWriter & image){
+    image.writeSlot(slot);
+}
+
+void NextStmt::load(ImageReader & image){
+    slot=image.readSlot();  //-1 for a bare NEXT
+    name=(slot==-1)?"":EvalState::nameOf(slot);
+}
+
+GosubStmt::GosubStmt(string line):number(-1),exp(line){
+
+}
+
+StatementType GosubStmt::getType(){
+    return GOSUB;
+}
+
+void GosubStmt::execute(EvalState & state){ //the return stack lives in the bytecode machine
+
+}
+
+void GosubStmt::execute(EvalState & state,int & lineNumber){
+    lineNumber=number;
+}
+
+int GosubStmt::getTarget(){
+    return number;
+}
+
+bool GosubStmt::valid(){    //same form as GOTO
+    TokenScanner scanner;
+    scanner.ignoreWhitespace();
+    scanner.scanNumbers();
+    scanner.setInput(exp);
+    string s=scanner.nextToken();
+    if (scanner.getTokenType(s)!=NUMBER) error("SYNTAX ERROR");
+    if (scanner.hasMoreTokens()) error("SYNTAX ERROR");
+    number=stringToInteger(s);
+    return true;
+}
+
+void GosubStmt::save(ImageWriter & image){
+    image.writeInt(number);
+}
+
+void GosubStmt::load(ImageReader & image){
+    number=image.readInt();
+}
+
+ReturnStmt::ReturnStmt(string line):exp(line){
+
+}
+
+StatementType ReturnStmt::getType(){
+    return RETURN;
+}
+
+void ReturnStmt::execute(EvalState & state){
+
+}
+
+void ReturnStmt::execute(EvalState & state,int & lineNumber){
+
+}
+
+bool ReturnStmt::valid(){
+    TokenScanner scanner;
+    scanner.ignoreWhitespace();
+    scanner.scanNumbers();
+    scanner.setInput(exp);
+    if (scanner.hasMoreTokens()) error("SYNTAX ERROR");
+    return true;
+}
+
+void ReturnStmt::save(ImageWriter & image){  //no operands
+
+}
+
+void ReturnStmt::load(ImageReader & image){
+
+}
+
 /*
  *  At first I consider that Null statement is also supposed
  *  to be stored even though it's of no value.
@@ -12,12 +12,17 @@
 #ifndef _statement_h
 #define _statement_h
 
+#include <string>
 #include "evalstate.h"
 #include "exp.h"
+#include "arena.h"
 #include "../StanfordCPPLib/tokenscanner.h"
 #include "../StanfordCPPLib/strlib.h"
 #include "parser.h"
-enum StatementType {LET, PRINT, INPUT, REM , GOTO , IF , END };
+#include "image.h"
+using namespace std;
+
+enum StatementType {LET, PRINT, INPUT, REM , GOTO , IF , END , DIM , FOR , NEXT , GOSUB , RETURN };
 
 /*
  * Class: Statement
@@ -26,10 +31,11 @@ enum StatementType {LET, PRINT, INPUT, REM , GOTO , IF , END };
  * The model for this class is Expression in the exp.h interface.
  * Like Expression, Statement is an abstract class with subclasses
  * for each of the statement and command types required for the
- * BASIC interpreter.
+ * BASIC interpreter.  Like Expression, Statement is an ArenaObject,
+ * so a statement built inside an ArenaScope lives in that arena.
  */
 
-class Statement {
+class Statement : public ArenaObject {
 
 public:
 
@@ -67,6 +73,19 @@ public:
    virtual void execute(EvalState & state) = 0;
    virtual StatementType getType() = 0;
    virtual bool valid()=0;
+
+/*
+ * Methods: save, load
+ * Usage: stmt->save(image);
+ *        stmt->load(image);
+ * -------------------------
+ * save writes the operands that valid() built into a program image.
+ * load sets them from an image instead of calling valid(), so a line
+ * brought back by LOAD is never scanned again.
+ */
+
+   virtual void save(ImageWriter & image) = 0;
+   virtual void load(ImageReader & image) = 0;
 };
 
 /*
@@ -82,11 +101,12 @@ public:
 
 
 /*
- * Seven types of statement are defined below.
+ * Twelve types of statement are defined below.
  * Each has a member of string to store the original line.
- * Although I hope to parse the line before construst the class, 
- * it confused me when it comes to the two times check for errors.
- * So maybe the string is kind of necessary to simplify the whole program.
+ * valid() is the only place that scans the line: besides checking the
+ * form, it keeps the parsed operands (folded and flattened expressions,
+ * variable slots, target line numbers) in the statement, so execute()
+ * never touches the TokenScanner again and just evaluates what was built.
  * Besides, I'm not so good at leveraging the abstract class and 
  * the pure virtual function is not as friendly as I expected. I have to  
  * declare another reload of execute function , which is pure virtual, 
@@ -101,8 +121,19 @@ public:
   virtual void execute(EvalState & state);
   virtual void execute(EvalState & state,int & lineNumber);
   virtual bool valid();
+  virtual void save(ImageWriter & image);
+  virtual void load(ImageReader & image);
+  string getName();
+  int getSlot();
+  FlatExp & getExp();
+  bool isElement();
+  FlatExp & getIndex();
 private:
   string exp;
+  string name;      //the var on the left
+  int slot;         //and its EvalState slot
+  FlatExp rhs;      //parsed by valid()
+  FlatExp index;    //empty unless the var is an array element A(i)
 };
 
 class PrintStmt: public Statement{  //nothing to say
@@ -112,8 +143,12 @@ public:
   virtual void execute(EvalState & state);
   virtual void execute(EvalState & state,int & lineNumber);
   virtual bool valid();
+  virtual void save(ImageWriter & image);
+  virtual void load(ImageReader & image);
+  FlatExp & getExp();
 private:
   string exp;
+  FlatExp ex;       //parsed by valid()
 };
 
 class InputStmt: public Statement{  //nothing to say
@@ -123,8 +158,16 @@ public:
   virtual void execute(EvalState & state);
   virtual void execute(EvalState & state,int & lineNumber);
   virtual bool valid();
+  virtual void save(ImageWriter & image);
+  virtual void load(ImageReader & image);
+  string getName();
+  int getSlot();
+  bool isElement();
+  FlatExp & getIndex();
 private:
   string name,exp;
+  int slot;
+  FlatExp index;    //as in LetStmt
 };
 
 class RemStmt: public Statement{  //nothing to say
@@ -134,6 +177,8 @@ public:
   virtual void execute(EvalState & state);
   virtual void execute(EvalState & state,int & lineNumber);
   virtual bool valid();
+  virtual void save(ImageWriter & image);
+  virtual void load(ImageReader & image);
 private:
   string exp;
 };
@@ -145,6 +190,9 @@ public:
   virtual void execute(EvalState & state);
   virtual void execute(EvalState & state,int & lineNumber);
   virtual bool valid();
+  virtual void save(ImageWriter & image);
+  virtual void load(ImageReader & image);
+  int getTarget();
 private:
   int number;
   string exp;
@@ -157,8 +205,17 @@ public:
   virtual void execute(EvalState & state);
   virtual void execute(EvalState & state,int & lineNumber);
   virtual bool valid();
+  virtual void save(ImageWriter & image);
+  virtual void load(ImageReader & image);
+  string getOp();
+  FlatExp & getLHS();
+  FlatExp & getRHS();
+  int getTarget();
 private:
   string exp;
+  string op;              //one of "=" "<" ">"
+  FlatExp lhs,rhs;        //parsed by valid()
+  int number;             //the line after THEN
 };
 
 class EndStmt: public Statement{  //nothing to say
@@ -168,9 +225,114 @@ public:
   virtual void execute(EvalState & state);
   virtual void execute(EvalState & state,int & lineNumber);
   virtual bool valid();
+  virtual void save(ImageWriter & image);
+  virtual void load(ImageReader & image);
 private:
   string exp;
 };
+class DimStmt: public Statement{  //DIM A(n) makes A(0)..A(n),all zero
+public:
+  DimStmt (string line);
+  virtual StatementType getType();
+  virtual void execute(EvalState & state);
+  virtual void execute(EvalState & state,int & lineNumber);
+  virtual bool valid();
+  virtual void save(ImageWriter & image);
+  virtual void load(ImageReader & image);
+  string getName();
+  int getSlot();
+  FlatExp & getBound();
+private:
+  string name,exp;
+  int slot;
+  FlatExp bound;
+};
+class ForStmt: public Statement{  //FOR v = a TO b [STEP s],closed by NEXT v
+public:
+  ForStmt (string line);
+  virtual StatementType getType();
+  virtual void execute(EvalState & state);
+  virtual void execute(EvalState & state,int & lineNumber);
+  virtual bool valid();
+  virtual void save(ImageWriter & image);
+  virtual void load(ImageReader & image);
+  string getName();
+  int getSlot();
+  FlatExp & getStart();
+  FlatExp & getLimit();
+  FlatExp & getStep();
+private:
+  string name,exp;
+  int slot;
+  FlatExp start,limit,step;   //step is the constant 1 if not given
+};
+
+class NextStmt: public Statement{ //NEXT v,or just NEXT for the innermost loop
+public:
+  NextStmt (string line);
+  virtual StatementType getType();
+  virtual void execute(EvalState & state);
+  virtual void execute(EvalState & state,int & lineNumber);
+  virtual bool valid();
+  virtual void save(ImageWriter & image);
+  virtual void load(ImageReader & image);
+  string getName();
+  int getSlot();
+private:
+  string name,exp;
+  int slot;                   //-1 if no var is given
+};
+
+class GosubStmt: public Statement{  //like GOTO,but RETURN comes back
+public:
+  GosubStmt (string line);
+  virtual StatementType getType();
+  virtual void execute(EvalState & state);
+  virtual void execute(EvalState & state,int & lineNumber);
+  virtual bool valid();
+  virtual void save(ImageWriter & image);
+  virtual void load(ImageReader & image);
+  int getTarget();
+private:
+  int number;
+  string exp;
+};
+
+class ReturnStmt: public Statement{ //back to the line after the last GOSUB
+public:
+  ReturnStmt (string line);
+  virtual StatementType getType();
+  virtual void execute(EvalState & state);
+  virtual void execute(EvalState & state,int & lineNumber);
+  virtual bool valid();
+  virtual void save(ImageWriter & image);
+  virtual void load(ImageReader & image);
+private:
+  string exp;
+};
+/*
+ * Function: readInputValue
+ * Usage: int value = readInputValue(state);
+ * -----------------------------------------
+ * Prompts with " ? " and reads lines from the input of state until one
+ * holds a valid integer, printing INVALID NUMBER for each rejected line.
+ * Raises INPUT FAIL if the stream ends first.  Shared by InputStmt and
+ * the bytecode machine so both behave identically.
+ */
+
+int readInputValue(EvalState & state);
+
+/*
+ * Function: isKeyword
+ * Usage: if (isKeyword(word)) . . .
+ * ---------------------------------
+ * Returns true if word is the name of a statement, a command or a part
+ * of a statement such as THEN or STEP.  No variable may have such a
+ * name.
+ */
+
+bool isKeyword(std::string word);
+
 /*
 class EmptyStmt: public Statement{
 public:
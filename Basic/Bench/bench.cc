@@ -0,0 +1,225 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+const string benchFolder = "../Bench/programs/";
+const string defaultStudentBasic = "../Basic/Basic";
+
+const int benchCount = 5;
+const string benches[benchCount] = {
+  "bench00.txt",    // nested IF/GOTO loops
+  "bench01.txt",    // arithmetic-heavy recurrences
+  "bench02.txt",    // variable-rich program
+  "bench03.txt",    // long LIST workload
+  "bench04.txt",    // FOR, DIM and GOSUB
+};
+
+string studentBasic = "";
+string benchFile = "";
+int repeats = 3;
+bool noJit = false;
+
+void useage(const char* progname) {
+  cout
+    << progname << " [-h] [-e <your_exec>] [-b <bench_file>] [-r <repeats>] [-n]" << endl
+    << "    -h  Show this message and quit" << endl
+    << "    -e  Specify your executable file, default value: " << defaultStudentBasic << endl
+    << "    -b  Run specified benchmark file" << endl
+    << "    -r  Keep the best of this many runs, default value: " << repeats << endl
+    << "    -n  Run with JIT OFF to measure the interpreter alone" << endl
+  ;
+  exit(1);
+}
+
+void parseArguments(int argc, char** argv) {
+  int c;
+  opterr = 0;
+  while ((c = getopt (argc, argv, "e:b:r:nh")) != -1) {
+    switch (c)
+    {
+      case 'e': if (studentBasic.size()) useage(argv[0]); studentBasic = optarg; break;
+      case 'b': if (benchFile.size()) useage(argv[0]); benchFile = optarg; break;
+      case 'r': repeats = atoi(optarg); if (repeats < 1) useage(argv[0]); break;
+      case 'n': if (noJit) useage(argv[0]); noJit = true; break;
+      case 'h': useage(argv[0]); break;
+      default: useage(argv[0]); break;
+    }
+  }
+  if (studentBasic.size() == 0) studentBasic = defaultStudentBasic;
+}
+
+/*
+ * A benchmark is a trace: the program is entered line by line, then the
+ * workload starts at the first RUN or LIST command.  Three inputs are
+ * derived from it:
+ *
+ *   entry    the lines before the workload, then QUIT (parse time)
+ *   full     the whole trace (run time is full minus entry)
+ *   profile  RUN replaced by PROFILE, whose ALL row counts the
+ *            statements executed
+ *
+ * The programs get their input through a pipe, and each measurement
+ * keeps the fastest of its runs.
+ */
+
+struct Measure {
+  double millis;      // wall time of the fastest run
+  long rss;           // peak resident set size in KB
+  string output;
+  bool ok;
+};
+
+Measure runProgram(const string &input) {
+  Measure m = { 0, 0, "", false };
+  int in[2], out[2];
+  if (pipe(in) != 0) return m;
+  if (pipe(out) != 0) { close(in[0]); close(in[1]); return m; }
+  auto start = chrono::steady_clock::now();
+  pid_t pid = fork();
+  if (pid == 0) {
+    int null = open("/dev/null", O_WRONLY);
+    dup2(in[0], 0); dup2(out[1], 1); dup2(null, 2);
+    close(in[0]); close(in[1]); close(out[0]); close(out[1]);
+    execl(studentBasic.c_str(), studentBasic.c_str(), (char *) NULL);
+    _exit(127);
+  }
+  close(in[0]); close(out[1]);
+  if (pid < 0) { close(in[1]); close(out[0]); return m; }
+  size_t written = 0;
+  struct pollfd fds[2] = { { out[0], POLLIN, 0 }, { in[1], POLLOUT, 0 } };
+  char buffer[65536];
+  while (fds[0].fd >= 0) {
+    if (poll(fds, 2, -1) < 0) continue;
+    if (fds[1].fd >= 0 && fds[1].revents) {
+      ssize_t n = write(in[1], input.data() + written, input.size() - written);
+      if (n > 0) written += n;
+      if (n < 0 || written == input.size()) { close(in[1]); fds[1].fd = -1; }
+    }
+    if (fds[0].revents) {
+      ssize_t n = read(out[0], buffer, sizeof buffer);
+      if (n > 0) m.output.append(buffer, n);
+      else { close(out[0]); fds[0].fd = -1; }
+    }
+  }
+  if (fds[1].fd >= 0) close(in[1]);
+  int status;
+  struct rusage usage;
+  while (wait4(pid, &status, 0, &usage) < 0) {}
+  m.millis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+  m.rss = usage.ru_maxrss;
+  m.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+  return m;
+}
+
+Measure bestOf(const string &input) {
+  Measure best = runProgram(input);
+  for (int i = 1; i < repeats && best.ok; i++) {
+    Measure m = runProgram(input);
+    if (m.millis < best.millis) best.millis = m.millis;
+    if (m.rss > best.rss) best.rss = m.rss;
+  }
+  return best;
+}
+
+long long countStatements(const string &report) {
+  istringstream lines(report);
+  string line;
+  long long count = 0;
+  while (getline(lines, line)) {
+    istringstream fields(line);
+    string first;
+    long long n;
+    if (fields >> first && first == "ALL" && fields >> n) count += n;
+  }
+  return count;
+}
+
+struct BenchResult {
+  double parse, run;
+  long rss;
+  long long statements;
+  bool ok;
+};
+
+BenchResult runBench(const string &file) {
+  BenchResult result = { 0, 0, 0, 0, false };
+  ifstream trace(file.c_str());
+  if (!trace) return result;
+  string prefix = noJit ? "JIT OFF\n" : "";
+  string entry = prefix, full = prefix, profile = prefix, line;
+  bool workload = false;
+  while (getline(trace, line)) {
+    if (line == "RUN" || line == "LIST") workload = true;
+    if (!workload) entry += line + "\n";
+    full += line + "\n";
+    profile += ((line == "RUN") ? "PROFILE" : line) + "\n";
+  }
+  entry += "QUIT\n";
+  Measure e = bestOf(entry), f = bestOf(full);
+  if (!e.ok || !f.ok) return result;
+  result.parse = e.millis;
+  result.run = (f.millis > e.millis) ? f.millis - e.millis : 0;
+  result.rss = f.rss;
+  Measure p = runProgram(profile);
+  result.statements = p.ok ? countStatements(p.output) : 0;
+  result.ok = true;
+  return result;
+}
+
+string rate(long long statements, double millis) {
+  char text[32];
+  if (statements == 0 || millis <= 0) return "-";
+  snprintf(text, sizeof text, "%.2fM", statements / millis / 1000);
+  return text;
+}
+
+int main(int argc, char** argv) {
+  parseArguments(argc, argv);
+  signal(SIGPIPE, SIG_IGN);
+  vector<string> files;
+  if (benchFile.size()) files.push_back(benchFile);
+  else {
+    for (int i = 0; i < benchCount; i++) files.push_back(benchFolder + benches[i]);
+  }
+  char row[256];
+  snprintf(row, sizeof row, "%-14s %10s %10s %14s %10s %12s",
+           "BENCHMARK", "PARSE ms", "RUN ms", "STATEMENTS", "STMT/s", "PEAK RSS KB");
+  cout << row << endl;
+  double run = 0;
+  long long statements = 0;
+  int failed = 0;
+  for (size_t i = 0; i < files.size(); i++) {
+    string name = files[i].substr(files[i].rfind('/') + 1);
+    BenchResult r = runBench(files[i]);
+    if (!r.ok) {
+      cout << name << " ... failed to run" << endl;
+      failed++;
+      continue;
+    }
+    snprintf(row, sizeof row, "%-14s %10.2f %10.2f %14lld %10s %12ld", name.c_str(),
+             r.parse, r.run, r.statements, rate(r.statements, r.run).c_str(), r.rss);
+    cout << row << endl;
+    if (r.statements) {
+      run += r.run;
+      statements += r.statements;
+    }
+  }
+  snprintf(row, sizeof row, "%-14s %10s %10.2f %14lld %10s", "ALL", "", run, statements,
+           rate(statements, run).c_str());
+  cout << row << endl;
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,958 @@
+/*
+ * File: btreemap.h
+ * ----------------
+ * This file exports the template class <code>BTreeMap</code>, which
+ * maintains a collection of <i>key</i>-<i>value</i> pairs in key order,
+ * like <code>Map</code>, but stores them in the wide nodes of a B-tree.
+ */
+
+#ifndef _btreemap_h
+#define _btreemap_h
+
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "error.h"
+#include "foreach.h"
+#include "strlib.h"
+
+/*
+ * Class: BTreeMap<KeyType,ValueType,CompareType>
+ * ----------------------------------------------
+ * This class offers the interface of <code>Map</code> and iterates in
+ * the same order, but is built for speed on large maps.  The entries
+ * sit in arrays of up to <code>SLOTS</code> keys and values, so a
+ * lookup touches a few nodes instead of one node per level of a binary
+ * tree, and the comparison is a template argument that the compiler
+ * can inline rather than a call through a <code>Comparator</code>.  A
+ * map can also be built in one pass from keys that are already sorted.
+ *
+ * Pointers and references to values stay valid only until the next
+ * call that adds or removes an entry, which may move entries between
+ * nodes.
+ */
+
+template <typename KeyType, typename ValueType,
+          typename CompareType = std::less<KeyType> >
+class BTreeMap {
+
+public:
+
+/*
+ * Constructor: BTreeMap
+ * Usage: BTreeMap<KeyType,ValueType> map;
+ *        BTreeMap<KeyType,ValueType,CompareType> map(cmp);
+ * ----------------------------------------------------
+ * Initializes a new empty map that orders its keys with
+ * <code>cmp</code>, by default the <code>&lt;</code> operator.
+ */
+
+   BTreeMap();
+   explicit BTreeMap(CompareType cmp);
+
+/*
+ * Destructor: ~BTreeMap
+ * ---------------------
+ * Frees any heap storage associated with this map.
+ */
+
+   virtual ~BTreeMap();
+
+/*
+ * Method: size
+ * Usage: int nEntries = map.size();
+ * ---------------------------------
+ * Returns the number of entries in this map.
+ */
+
+   int size() const;
+
+/*
+ * Method: isEmpty
+ * Usage: if (map.isEmpty()) ...
+ * -----------------------------
+ * Returns <code>true</code> if this map contains no entries.
+ */
+
+   bool isEmpty() const;
+
+/*
+ * Method: put
+ * Usage: map.put(key, value);
+ * ---------------------------
+ * Associates <code>key</code> with <code>value</code> in this map.
+ * Any previous value associated with <code>key</code> is replaced
+ * by the new value.
+ */
+
+   void put(const KeyType & key, const ValueType & value);
+
+/*
+ * Method: get
+ * Usage: ValueType value = map.get(key);
+ * --------------------------------------
+ * Returns the value associated with <code>key</code> in this map.
+ * If <code>key</code> is not found, <code>get</code> returns the
+ * default value for <code>ValueType</code>.
+ */
+
+   ValueType get(const KeyType & key) const;
+
+/*
+ * Method: containsKey
+ * Usage: if (map.containsKey(key)) ...
+ * ------------------------------------
+ * Returns <code>true</code> if there is an entry for <code>key</code>
+ * in this map.
+ */
+
+   bool containsKey(const KeyType & key) const;
+
+/*
+ * Method: remove
+ * Usage: map.remove(key);
+ * -----------------------
+ * Removes any entry for <code>key</code> from this map.
+ */
+
+   void remove(const KeyType & key);
+
+/*
+ * Method: clear
+ * Usage: map.clear();
+ * -------------------
+ * Removes all entries from this map.
+ */
+
+   void clear();
+
+/*
+ * Method: loadSorted
+ * Usage: map.loadSorted(pairs.begin(), pairs.end());
+ * --------------------------------------------------
+ * Replaces the contents of this map with the key-value pairs between
+ * two iterators, whose elements must have <code>first</code> and
+ * <code>second</code> members like <code>std::pair</code>.  The keys
+ * must be in strictly ascending order; the nodes are then filled from
+ * left to right in linear time, without a single search.  If the keys
+ * are out of order, <code>loadSorted</code> signals an error and
+ * leaves the map empty.
+ */
+
+   template <typename IteratorType>
+   void loadSorted(IteratorType begin, IteratorType end);
+
+/*
+ * Operator: []
+ * Usage: map[key]
+ * ---------------
+ * Selects the value associated with <code>key</code>.  If
+ * <code>key</code> is not present in the map, a new entry is created
+ * whose value is set to the default for the value type.
+ */
+
+   ValueType & operator[](const KeyType & key);
+   ValueType operator[](const KeyType & key) const;
+
+/*
+ * Method: toString
+ * Usage: string str = map.toString();
+ * -----------------------------------
+ * Converts the map to a printable string representation.
+ */
+
+   std::string toString();
+
+/*
+ * Method: mapAll
+ * Usage: map.mapAll(fn);
+ * ----------------------
+ * Iterates through the map entries and calls <code>fn(key, value)</code>
+ * for each one.  The keys are processed in ascending order, as defined
+ * by the comparison function.
+ */
+
+   void mapAll(void (*fn)(KeyType, ValueType)) const;
+   void mapAll(void (*fn)(const KeyType &, const ValueType &)) const;
+   template <typename FunctorType>
+   void mapAll(FunctorType fn) const;
+
+/*
+ * Additional BTreeMap operations
+ * ------------------------------
+ * In addition to the methods listed in this interface, the BTreeMap
+ * class supports the following operations:
+ *
+ *   - Stream I/O using the << and >> operators
+ *   - Deep copying for the copy constructor and assignment operator
+ *   - Moving for the move constructor and move assignment
+ *   - Iteration using the range-based for statement and STL iterators
+ *
+ * All iteration is guaranteed to proceed in the order established by
+ * the comparison function, as for Map.
+ */
+
+/* Private section */
+
+/**********************************************************************/
+/* Note: Everything below this point in the file is logically part    */
+/* of the implementation and should not be of interest to clients.    */
+/**********************************************************************/
+
+/*
+ * Implementation notes:
+ * ---------------------
+ * The map is a B+ tree.  Every entry lives in a leaf, and the leaves
+ * are linked in key order, which is all that iteration needs.  An
+ * inner node with n keys has n + 1 children; keys[i] is no larger than
+ * any key under children[i + 1] and larger than every key under
+ * children[i].  Every node except the root holds at least MIN_SLOTS
+ * keys.  An insertion into a full node splits it in two and passes the
+ * new node up to the parent, and a node that drops below the minimum
+ * after a removal borrows from a sibling or, if neither has a key to
+ * spare, is merged with one.  Keys are found in a node by binary
+ * search.
+ */
+
+private:
+
+/* Constant definitions */
+
+   static const int SLOTS = 32;            /* Keys per node at most    */
+   static const int MIN_SLOTS = SLOTS / 2; /* and at least, but root   */
+
+/* Type definitions for the nodes of the tree */
+
+   struct Node {
+      int count;               /* Number of keys in this node         */
+      bool leaf;               /* Whether this node is a Leaf         */
+   };
+
+   struct Leaf : Node {
+      KeyType keys[SLOTS];     /* The keys, in ascending order        */
+      ValueType values[SLOTS]; /* The value for each key              */
+      Leaf *next;              /* The leaf with the next larger keys  */
+      Leaf() { this->count = 0; this->leaf = true; next = NULL; }
+   };
+
+   struct Inner : Node {
+      KeyType keys[SLOTS];     /* The separators between children     */
+      Node *children[SLOTS + 1];
+      Inner() { this->count = 0; this->leaf = false; }
+   };
+
+/* Instance variables */
+
+   Node *root;                 /* The root, NULL if the map is empty  */
+   Leaf *first;                /* The leftmost leaf, for iteration    */
+   int nodeCount;              /* Number of entries in the map        */
+   mutable CompareType cmp;    /* The ordering of the keys            */
+
+/* Private methods */
+
+/*
+ * Implementation notes: lowerBound, upperBound
+ * --------------------------------------------
+ * Return the index of the first key in keys[0..n) that is not less
+ * than key, or that is greater than key, respectively.
+ */
+
+   int lowerBound(const KeyType *keys, int n, const KeyType & key) const {
+      int lo = 0, hi = n;
+      while (lo < hi) {
+         int mid = (lo + hi) / 2;
+         if (cmp(keys[mid], key)) {
+            lo = mid + 1;
+         } else {
+            hi = mid;
+         }
+      }
+      return lo;
+   }
+
+   int upperBound(const KeyType *keys, int n, const KeyType & key) const {
+      int lo = 0, hi = n;
+      while (lo < hi) {
+         int mid = (lo + hi) / 2;
+         if (cmp(key, keys[mid])) {
+            hi = mid;
+         } else {
+            lo = mid + 1;
+         }
+      }
+      return lo;
+   }
+
+/*
+ * Implementation notes: findValue(key)
+ * ------------------------------------
+ * Walks down to the leaf that would hold key and returns a pointer to
+ * its value, or NULL if the key is not there.
+ */
+
+   ValueType *findValue(const KeyType & key) const {
+      Node *np = root;
+      if (np == NULL) return NULL;
+      while (!np->leaf) {
+         Inner *ip = (Inner *) np;
+         np = ip->children[upperBound(ip->keys, ip->count, key)];
+      }
+      Leaf *lp = (Leaf *) np;
+      int i = lowerBound(lp->keys, lp->count, key);
+      if (i == lp->count || cmp(key, lp->keys[i])) return NULL;
+      return &lp->values[i];
+   }
+
+/*
+ * Implementation notes: addEntry(key)
+ * -----------------------------------
+ * Returns a pointer to the value for key, creating the entry with a
+ * default value if it is missing.  If the root splits, a new root is
+ * put on top of the two halves, which is the only way the tree grows.
+ */
+
+   ValueType *addEntry(const KeyType & key) {
+      if (root == NULL) root = first = new Leaf();
+      KeyType split;
+      Node *right = NULL;
+      ValueType *vp = insert(root, key, split, right);
+      if (right != NULL) {
+         Inner *ip = new Inner();
+         ip->count = 1;
+         ip->keys[0] = split;
+         ip->children[0] = root;
+         ip->children[1] = right;
+         root = ip;
+      }
+      return vp;
+   }
+
+/*
+ * Implementation notes: insert(np, key, split, right)
+ * ---------------------------------------------------
+ * Adds key below np like addEntry.  If np was full and had to be split,
+ * right is set to the new node holding its upper half and split to the
+ * key that separates the two, for the parent to insert.
+ */
+
+   ValueType *insert(Node *np, const KeyType & key, KeyType & split, Node * & right) {
+      if (np->leaf) {
+         Leaf *lp = (Leaf *) np;
+         int i = lowerBound(lp->keys, lp->count, key);
+         if (i < lp->count && !cmp(key, lp->keys[i])) return &lp->values[i];
+         if (lp->count == SLOTS) {
+            Leaf *rp = new Leaf();
+            int half = SLOTS / 2;
+            for (int k = half; k < SLOTS; k++) {
+               rp->keys[k - half] = std::move(lp->keys[k]);
+               rp->values[k - half] = std::move(lp->values[k]);
+               clearSlot(lp, k);
+            }
+            rp->count = SLOTS - half;
+            lp->count = half;
+            rp->next = lp->next;
+            lp->next = rp;
+            split = rp->keys[0];
+            right = rp;
+            if (i > half) {
+               lp = rp;
+               i -= half;
+            }
+         }
+         for (int k = lp->count; k > i; k--) {
+            lp->keys[k] = std::move(lp->keys[k - 1]);
+            lp->values[k] = std::move(lp->values[k - 1]);
+         }
+         lp->keys[i] = key;
+         lp->values[i] = ValueType();
+         lp->count++;
+         nodeCount++;
+         return &lp->values[i];
+      }
+      Inner *ip = (Inner *) np;
+      int i = upperBound(ip->keys, ip->count, key);
+      KeyType childSplit;
+      Node *childRight = NULL;
+      ValueType *vp = insert(ip->children[i], key, childSplit, childRight);
+      if (childRight == NULL) return vp;
+      if (ip->count == SLOTS) {
+         Inner *rp = new Inner();
+         int half = SLOTS / 2;
+         split = ip->keys[half];
+         for (int k = half + 1; k < SLOTS; k++) {
+            rp->keys[k - half - 1] = std::move(ip->keys[k]);
+            ip->keys[k] = KeyType();
+         }
+         for (int k = half + 1; k <= SLOTS; k++) {
+            rp->children[k - half - 1] = ip->children[k];
+         }
+         rp->count = SLOTS - half - 1;
+         ip->count = half;
+         right = rp;
+         if (i > half) {
+            ip = rp;
+            i -= half + 1;
+         }
+      }
+      for (int k = ip->count; k > i; k--) {
+         ip->keys[k] = std::move(ip->keys[k - 1]);
+         ip->children[k + 1] = ip->children[k];
+      }
+      ip->keys[i] = std::move(childSplit);
+      ip->children[i + 1] = childRight;
+      ip->count++;
+      return vp;
+   }
+
+/*
+ * Implementation notes: removeEntry(np, key)
+ * ------------------------------------------
+ * Removes key from the subtree np and returns true if it was there.
+ * A child left with too few keys is repaired by its parent on the way
+ * back up, so only the root can end up below the minimum.
+ */
+
+   bool removeEntry(Node *np, const KeyType & key) {
+      if (np->leaf) {
+         Leaf *lp = (Leaf *) np;
+         int i = lowerBound(lp->keys, lp->count, key);
+         if (i == lp->count || cmp(key, lp->keys[i])) return false;
+         for (int k = i + 1; k < lp->count; k++) {
+            lp->keys[k - 1] = std::move(lp->keys[k]);
+            lp->values[k - 1] = std::move(lp->values[k]);
+         }
+         lp->count--;
+         clearSlot(lp, lp->count);
+         nodeCount--;
+         return true;
+      }
+      Inner *ip = (Inner *) np;
+      int i = upperBound(ip->keys, ip->count, key);
+      if (!removeEntry(ip->children[i], key)) return false;
+      if (ip->children[i]->count < MIN_SLOTS) rebalance(ip, i);
+      return true;
+   }
+
+/*
+ * Implementation notes: rebalance(ip, i)
+ * --------------------------------------
+ * Brings children[i] of ip back to MIN_SLOTS keys.  A sibling with
+ * more than the minimum gives up the key next to it, which passes
+ * through the separator in ip when the children are inner nodes.
+ * Otherwise the child and a sibling fit together in one node, since
+ * they hold at most MIN_SLOTS - 1 + MIN_SLOTS keys, plus the separator.
+ */
+
+   void rebalance(Inner *ip, int i) {
+      if (i > 0 && ip->children[i - 1]->count > MIN_SLOTS) {
+         Node *left = ip->children[i - 1];
+         Node *np = ip->children[i];
+         if (np->leaf) {
+            Leaf *lp = (Leaf *) left;
+            Leaf *cp = (Leaf *) np;
+            for (int k = cp->count; k > 0; k--) {
+               cp->keys[k] = std::move(cp->keys[k - 1]);
+               cp->values[k] = std::move(cp->values[k - 1]);
+            }
+            cp->keys[0] = std::move(lp->keys[lp->count - 1]);
+            cp->values[0] = std::move(lp->values[lp->count - 1]);
+            clearSlot(lp, lp->count - 1);
+            ip->keys[i - 1] = cp->keys[0];
+         } else {
+            Inner *lp = (Inner *) left;
+            Inner *cp = (Inner *) np;
+            for (int k = cp->count; k > 0; k--) cp->keys[k] = std::move(cp->keys[k - 1]);
+            for (int k = cp->count + 1; k > 0; k--) cp->children[k] = cp->children[k - 1];
+            cp->keys[0] = std::move(ip->keys[i - 1]);
+            cp->children[0] = lp->children[lp->count];
+            ip->keys[i - 1] = std::move(lp->keys[lp->count - 1]);
+            lp->keys[lp->count - 1] = KeyType();
+         }
+         left->count--;
+         np->count++;
+      } else if (i < ip->count && ip->children[i + 1]->count > MIN_SLOTS) {
+         Node *np = ip->children[i];
+         Node *right = ip->children[i + 1];
+         if (np->leaf) {
+            Leaf *cp = (Leaf *) np;
+            Leaf *rp = (Leaf *) right;
+            cp->keys[cp->count] = std::move(rp->keys[0]);
+            cp->values[cp->count] = std::move(rp->values[0]);
+            for (int k = 1; k < rp->count; k++) {
+               rp->keys[k - 1] = std::move(rp->keys[k]);
+               rp->values[k - 1] = std::move(rp->values[k]);
+            }
+            clearSlot(rp, rp->count - 1);
+            ip->keys[i] = rp->keys[0];
+         } else {
+            Inner *cp = (Inner *) np;
+            Inner *rp = (Inner *) right;
+            cp->keys[cp->count] = std::move(ip->keys[i]);
+            cp->children[cp->count + 1] = rp->children[0];
+            ip->keys[i] = std::move(rp->keys[0]);
+            for (int k = 1; k < rp->count; k++) rp->keys[k - 1] = std::move(rp->keys[k]);
+            for (int k = 1; k <= rp->count; k++) rp->children[k - 1] = rp->children[k];
+            rp->keys[rp->count - 1] = KeyType();
+         }
+         np->count++;
+         right->count--;
+      } else {
+         merge(ip, (i > 0) ? i - 1 : i);
+      }
+   }
+
+/*
+ * Implementation notes: merge(ip, i)
+ * ----------------------------------
+ * Moves everything in children[i + 1] of ip into children[i], frees
+ * it and removes it and its separator from ip.
+ */
+
+   void merge(Inner *ip, int i) {
+      Node *left = ip->children[i];
+      Node *right = ip->children[i + 1];
+      if (left->leaf) {
+         Leaf *lp = (Leaf *) left;
+         Leaf *rp = (Leaf *) right;
+         for (int k = 0; k < rp->count; k++) {
+            lp->keys[lp->count + k] = std::move(rp->keys[k]);
+            lp->values[lp->count + k] = std::move(rp->values[k]);
+         }
+         lp->count += rp->count;
+         lp->next = rp->next;
+         delete rp;
+      } else {
+         Inner *lp = (Inner *) left;
+         Inner *rp = (Inner *) right;
+         lp->keys[lp->count] = std::move(ip->keys[i]);
+         for (int k = 0; k < rp->count; k++) lp->keys[lp->count + 1 + k] = std::move(rp->keys[k]);
+         for (int k = 0; k <= rp->count; k++) {
+            lp->children[lp->count + 1 + k] = rp->children[k];
+         }
+         lp->count += rp->count + 1;
+         delete rp;
+      }
+      for (int k = i + 1; k < ip->count; k++) {
+         ip->keys[k - 1] = std::move(ip->keys[k]);
+         ip->children[k] = ip->children[k + 1];
+      }
+      ip->count--;
+      ip->keys[ip->count] = KeyType();
+   }
+
+/*
+ * Implementation notes: clearSlot(lp, k)
+ * --------------------------------------
+ * Resets a slot that no longer holds an entry, so that the key and
+ * value it held release their storage at once.
+ */
+
+   static void clearSlot(Leaf *lp, int k) {
+      lp->keys[k] = KeyType();
+      lp->values[k] = ValueType();
+   }
+
+/*
+ * Implementation notes: appendEntry, finishLoad
+ * ---------------------------------------------
+ * Bulk loading fills leaves from left to right with ascending entries,
+ * then builds each level above from the one below.  Only the last
+ * leaf can be short; it takes entries from the one before it if it
+ * holds fewer than MIN_SLOTS.  The nodes of an inner level share out
+ * the children evenly, which gives each of them at least MIN_SLOTS + 1
+ * as soon as there is more than one.  lows holds the smallest key
+ * under each node of the level being built, the separators it needs.
+ */
+
+   void appendEntry(std::vector<Leaf *> & leaves, const KeyType & key,
+                    const ValueType & value) {
+      if (leaves.empty() || leaves.back()->count == SLOTS) {
+         Leaf *lp = new Leaf();
+         if (!leaves.empty()) leaves.back()->next = lp;
+         leaves.push_back(lp);
+      }
+      Leaf *lp = leaves.back();
+      lp->keys[lp->count] = key;
+      lp->values[lp->count] = value;
+      lp->count++;
+      nodeCount++;
+   }
+
+   void finishLoad(std::vector<Leaf *> & leaves) {
+      if (leaves.empty()) return;
+      int n = leaves.size();
+      if (n > 1 && leaves[n - 1]->count < MIN_SLOTS) {
+         Leaf *prev = leaves[n - 2];
+         Leaf *last = leaves[n - 1];
+         int moved = (prev->count + last->count) / 2 - last->count;
+         for (int k = last->count - 1; k >= 0; k--) {
+            last->keys[k + moved] = last->keys[k];
+            last->values[k + moved] = last->values[k];
+         }
+         for (int k = 0; k < moved; k++) {
+            last->keys[k] = prev->keys[prev->count - moved + k];
+            last->values[k] = prev->values[prev->count - moved + k];
+            clearSlot(prev, prev->count - moved + k);
+         }
+         prev->count -= moved;
+         last->count += moved;
+      }
+      std::vector<Node *> level(leaves.begin(), leaves.end());
+      std::vector<KeyType> lows;
+      for (int i = 0; i < n; i++) lows.push_back(leaves[i]->keys[0]);
+      while (level.size() > 1) {
+         int count = level.size();
+         int groups = (count + SLOTS) / (SLOTS + 1);
+         std::vector<Node *> up;
+         std::vector<KeyType> upLows;
+         int start = 0;
+         for (int g = 0; g < groups; g++) {
+            int width = count / groups + ((g < count % groups) ? 1 : 0);
+            Inner *ip = new Inner();
+            ip->count = width - 1;
+            for (int k = 0; k < width; k++) ip->children[k] = level[start + k];
+            for (int k = 1; k < width; k++) ip->keys[k - 1] = lows[start + k];
+            up.push_back(ip);
+            upLows.push_back(lows[start]);
+            start += width;
+         }
+         level.swap(up);
+         lows.swap(upLows);
+      }
+      root = level[0];
+      first = leaves[0];
+   }
+
+   void deleteTree(Node *np) {
+      if (np == NULL) return;
+      if (np->leaf) {
+         delete (Leaf *) np;
+      } else {
+         Inner *ip = (Inner *) np;
+         for (int k = 0; k <= ip->count; k++) deleteTree(ip->children[k]);
+         delete ip;
+      }
+   }
+
+   void deepCopy(const BTreeMap & other) {
+      root = NULL;
+      first = NULL;
+      nodeCount = 0;
+      cmp = other.cmp;
+      std::vector<Leaf *> leaves;
+      for (Leaf *lp = other.first; lp != NULL; lp = lp->next) {
+         for (int k = 0; k < lp->count; k++) appendEntry(leaves, lp->keys[k], lp->values[k]);
+      }
+      finishLoad(leaves);
+   }
+
+public:
+
+/*
+ * Deep copying support
+ * --------------------
+ * This copy constructor and operator= are defined to make a
+ * deep copy, making it possible to pass/return maps by value
+ * and assign from one map to another.  The copy is bulk loaded,
+ * so its nodes are as full as they can be.
+ */
+
+   BTreeMap & operator=(const BTreeMap & src) {
+      if (this != &src) {
+         clear();
+         deepCopy(src);
+      }
+      return *this;
+   }
+
+   BTreeMap(const BTreeMap & src) {
+      deepCopy(src);
+   }
+
+/*
+ * Move support
+ * ------------
+ * The move constructor and move assignment take over the nodes of a
+ * map that is about to disappear instead of copying them.  The map
+ * moved from is left empty.
+ */
+
+   BTreeMap(BTreeMap && src) : cmp(src.cmp) {
+      root = src.root;
+      first = src.first;
+      nodeCount = src.nodeCount;
+      src.root = NULL;
+      src.first = NULL;
+      src.nodeCount = 0;
+   }
+
+   BTreeMap & operator=(BTreeMap && src) {
+      if (this != &src) {
+         clear();
+         std::swap(root, src.root);
+         std::swap(first, src.first);
+         std::swap(nodeCount, src.nodeCount);
+         std::swap(cmp, src.cmp);
+      }
+      return *this;
+   }
+
+/*
+ * Iterator support
+ * ----------------
+ * The iterator walks the chain of leaves, which costs nothing per step
+ * beyond moving to the next slot or leaf.
+ */
+
+   class iterator : public std::iterator<std::input_iterator_tag,KeyType> {
+
+   private:
+
+      const BTreeMap *mp;          /* Pointer to the map                */
+      Leaf *lp;                    /* Current leaf, NULL at the end     */
+      int index;                   /* Index of the current key in lp    */
+
+   public:
+
+      iterator() {
+        /* Empty */
+      }
+
+      iterator(const BTreeMap *mp, bool end) {
+         this->mp = mp;
+         lp = end ? NULL : mp->first;
+         index = 0;
+      }
+
+      iterator & operator++() {
+         if (++index == lp->count) {
+            lp = lp->next;
+            index = 0;
+         }
+         return *this;
+      }
+
+      iterator operator++(int) {
+         iterator copy(*this);
+         operator++();
+         return copy;
+      }
+
+      bool operator==(const iterator & rhs) {
+         return mp == rhs.mp && lp == rhs.lp && index == rhs.index;
+      }
+
+      bool operator!=(const iterator & rhs) {
+         return !(*this == rhs);
+      }
+
+      KeyType operator*() {
+         return lp->keys[index];
+      }
+
+      KeyType *operator->() {
+         return &lp->keys[index];
+      }
+
+      friend class BTreeMap;
+
+   };
+
+   iterator begin() const {
+      return iterator(this, false);
+   }
+
+   iterator end() const {
+      return iterator(this, true);
+   }
+
+};
+
+template <typename KeyType, typename ValueType, typename CompareType>
+BTreeMap<KeyType,ValueType,CompareType>::BTreeMap() {
+   root = NULL;
+   first = NULL;
+   nodeCount = 0;
+}
+
+template <typename KeyType, typename ValueType, typename CompareType>
+BTreeMap<KeyType,ValueType,CompareType>::BTreeMap(CompareType cmp) : cmp(cmp) {
+   root = NULL;
+   first = NULL;
+   nodeCount = 0;
+}
+
+template <typename KeyType, typename ValueType, typename CompareType>
+BTreeMap<KeyType,ValueType,CompareType>::~BTreeMap() {
+   deleteTree(root);
+}
+
+template <typename KeyType, typename ValueType, typename CompareType>
+int BTreeMap<KeyType,ValueType,CompareType>::size() const {
+   return nodeCount;
+}
+
+template <typename KeyType, typename ValueType, typename CompareType>
+bool BTreeMap<KeyType,ValueType,CompareType>::isEmpty() const {
+   return nodeCount == 0;
+}
+
+template <typename KeyType, typename ValueType, typename CompareType>
+void BTreeMap<KeyType,ValueType,CompareType>::put(const KeyType & key,
+                                                  const ValueType & value) {
+   *addEntry(key) = value;
+}
+
+template <typename KeyType, typename ValueType, typename CompareType>
+ValueType BTreeMap<KeyType,ValueType,CompareType>::get(const KeyType & key) const {
+   ValueType *vp = findValue(key);
+   if (vp == NULL) return ValueType();
+   return *vp;
+}
+
+template <typename KeyType, typename ValueType, typename CompareType>
+bool BTreeMap<KeyType,ValueType,CompareType>::containsKey(const KeyType & key) const {
+   return findValue(key) != NULL;
+}
+
+template <typename KeyType, typename ValueType, typename CompareType>
+void BTreeMap<KeyType,ValueType,CompareType>::remove(const KeyType & key) {
+   if (root == NULL || !removeEntry(root, key)) return;
+   if (root->count > 0) return;
+   if (root->leaf) {
+      delete (Leaf *) root;
+      root = first = NULL;
+   } else {
+      Inner *ip = (Inner *) root;
+      root = ip->children[0];
+      delete ip;
+   }
+}
+
+template <typename KeyType, typename ValueType, typename CompareType>
+void BTreeMap<KeyType,ValueType,CompareType>::clear() {
+   deleteTree(root);
+   root = NULL;
+   first = NULL;
+   nodeCount = 0;
+}
+
+template <typename KeyType, typename ValueType, typename CompareType>
+template <typename IteratorType>
+void BTreeMap<KeyType,ValueType,CompareType>::loadSorted(IteratorType begin,
+                                                         IteratorType end) {
+   clear();
+   std::vector<Leaf *> leaves;
+   for (IteratorType it = begin; it != end; ++it) {
+      if (!leaves.empty()) {
+         Leaf *lp = leaves.back();
+         if (!cmp(lp->keys[lp->count - 1], it->first)) {
+            for (size_t i = 0; i < leaves.size(); i++) delete leaves[i];
+            nodeCount = 0;
+            error("BTreeMap::loadSorted: Keys are not in ascending order");
+         }
+      }
+      appendEntry(leaves, it->first, it->second);
+   }
+   finishLoad(leaves);
+}
+
+template <typename KeyType, typename ValueType, typename CompareType>
+ValueType & BTreeMap<KeyType,ValueType,CompareType>::operator[](const KeyType & key) {
+   return *addEntry(key);
+}
+
+template <typename KeyType, typename ValueType, typename CompareType>
+ValueType BTreeMap<KeyType,ValueType,CompareType>::operator[](const KeyType & key) const {
+   return get(key);
+}
+
+template <typename KeyType, typename ValueType, typename CompareType>
+void BTreeMap<KeyType,ValueType,CompareType>::mapAll(void (*fn)(KeyType, ValueType)) const {
+   for (Leaf *lp = first; lp != NULL; lp = lp->next) {
+      for (int k = 0; k < lp->count; k++) fn(lp->keys[k], lp->values[k]);
+   }
+}
+
+template <typename KeyType, typename ValueType, typename CompareType>
+void BTreeMap<KeyType,ValueType,CompareType>::mapAll(void (*fn)(const KeyType &,
+                                                                const ValueType &)) const {
+   for (Leaf *lp = first; lp != NULL; lp = lp->next) {
+      for (int k = 0; k < lp->count; k++) fn(lp->keys[k], lp->values[k]);
+   }
+}
+
+template <typename KeyType, typename ValueType, typename CompareType>
+template <typename FunctorType>
+void BTreeMap<KeyType,ValueType,CompareType>::mapAll(FunctorType fn) const {
+   for (Leaf *lp = first; lp != NULL; lp = lp->next) {
+      for (int k = 0; k < lp->count; k++) fn(lp->keys[k], lp->values[k]);
+   }
+}
+
+template <typename KeyType, typename ValueType, typename CompareType>
+std::string BTreeMap<KeyType,ValueType,CompareType>::toString() {
+   std::ostringstream os;
+   os << *this;
+   return os.str();
+}
+
+/*
+ * Implementation notes: << and >>
+ * -------------------------------
+ * The insertion and extraction operators use the template facilities in
+ * strlib.h to read and write generic values in a way that treats strings
+ * specially.
+ */
+
+template <typename KeyType, typename ValueType, typename CompareType>
+std::ostream & operator<<(std::ostream & os,
+                          const BTreeMap<KeyType,ValueType,CompareType> & map) {
+   os << "{";
+   typename BTreeMap<KeyType,ValueType,CompareType>::iterator begin = map.begin();
+   typename BTreeMap<KeyType,ValueType,CompareType>::iterator end = map.end();
+   typename BTreeMap<KeyType,ValueType,CompareType>::iterator it = begin;
+   while (it != end) {
+      if (it != begin) os << ", ";
+      writeGenericValue(os, *it, false);
+      os << ":";
+      writeGenericValue(os, map[*it], false);
+      ++it;
+   }
+   return os << "}";
+}
+
+template <typename KeyType, typename ValueType, typename CompareType>
+std::istream & operator>>(std::istream & is,
+                          BTreeMap<KeyType,ValueType,CompareType> & map) {
+   char ch;
+   is >> ch;
+   if (ch != '{') error("operator >>: Missing {");
+   map.clear();
+   is >> ch;
+   if (ch != '}') {
+      is.unget();
+      while (true) {
+         KeyType key;
+         readGenericValue(is, key);
+         is >> ch;
+         if (ch != ':') error("operator >>: Missing colon after key");
+         ValueType value;
+         readGenericValue(is, value);
+         map[key] = value;
+         is >> ch;
+         if (ch == '}') break;
+         if (ch != ',') {
+            error(std::string("operator >>: Unexpected character ") + ch);
+         }
+      }
+   }
+   return is;
+}
+
+#endif
@@ -120,10 +120,12 @@ public:
  * Replaces the element at the specified <code>row</code>/<code>col</code>
  * location in this grid with a new value.  This method signals an error
  * if the <code>row</code> and <code>col</code> arguments are outside
- * the grid boundaries.
+ * the grid boundaries.  A value that is about to disappear, such as a
+ * temporary, is moved into the grid instead of copied.
  */
 
-   void set(int row, int col, ValueType value);
+   void set(int row, int col, const ValueType & value);
+   void set(int row, int col, ValueType && value);
 
 /*
  * Operator: []
@@ -172,6 +174,7 @@ public:
  *
  *   - Stream I/O using the << and >> operators
  *   - Deep copying for the copy constructor and assignment operator
+ *   - Moving for the move constructor and move assignment
  *   - Iteration using the range-based for statement and STL iterators
  *
  * The iteration forms process the grid in row-major order.
@@ -252,6 +255,34 @@ public:
       deepCopy(src);
    }
 
+/*
+ * Move support
+ * ------------
+ * The move constructor and move assignment take over the array of a
+ * grid that is about to disappear instead of copying its elements.
+ * The grid moved from is left with no rows and no columns.
+ */
+
+   Grid(Grid && src) {
+      elements = src.elements;
+      nRows = src.nRows;
+      nCols = src.nCols;
+      src.elements = NULL;
+      src.nRows = src.nCols = 0;
+   }
+
+   Grid & operator=(Grid && src) {
+      if (this != &src) {
+         if (elements != NULL) delete[] elements;
+         elements = src.elements;
+         nRows = src.nRows;
+         nCols = src.nCols;
+         src.elements = NULL;
+         src.nRows = src.nCols = 0;
+      }
+      return *this;
+   }
+
 /*
  * Iterator support
  * ----------------
@@ -422,11 +453,17 @@ const ValueType & Grid<ValueType>::get(int row, int col) const {
 }
 
 template <typename ValueType>
-void Grid<ValueType>::set(int row, int col, ValueType value) {
+void Grid<ValueType>::set(int row, int col, const ValueType & value) {
    if (!inBounds(row, col)) error("set: Grid indices out of bounds");
    elements[(row * nCols) + col] = value;
 }
 
+template <typename ValueType>
+void Grid<ValueType>::set(int row, int col, ValueType && value) {
+   if (!inBounds(row, col)) error("set: Grid indices out of bounds");
+   elements[(row * nCols) + col] = std::move(value);
+}
+
 template <typename ValueType>
 typename Grid<ValueType>::GridRow Grid<ValueType>::operator[](int row) {
    return GridRow(this, row);
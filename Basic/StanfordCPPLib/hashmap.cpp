@@ -5,34 +5,64 @@
  * with the HashMap class.
  */
 
+#include <cstring>
 #include <iostream>
 #include <string>
 #include "hashmap.h"
 using namespace std;
 
 /*
- * Implementation notes: hashCode
- * ------------------------------
- * This function takes a string key and uses it to derive a hash code,
- * which is a nonnegative integer related to the key by a deterministic
- * function that distributes keys well across the space of integers.
- * The general method is called linear congruence, which is also used
- * in random-number generators.  The specific algorithm used here is
- * called djb2 after the initials of its inventor, Daniel J. Bernstein,
- * Professor of Mathematics at the University of Illinois at Chicago.
+ * Implementation notes: hashCode64
+ * --------------------------------
+ * Strings are hashed eight characters at a time with the 64-bit version
+ * of MurmurHash by Austin Appleby: each word is scrambled and folded into
+ * the hash, the last few characters are folded in as one short word, and
+ * a final scramble makes every bit of the result depend on every bit of
+ * the string.  The word is copied out with memcpy, which reads it in one
+ * instruction whatever its alignment.
  */
 
-const int HASH_SEED = 5381;               /* Starting point for first cycle */
-const int HASH_MULTIPLIER = 33;           /* Multiplier for each cycle      */
+const unsigned long long HASH_MULTIPLIER = 0xC6A4A7935BD1E995ULL;
+const int HASH_SHIFT = 47;
+const unsigned long long HASH_SEED = 0x9E3779B97F4A7C15ULL;
 const int HASH_MASK = unsigned(-1) >> 1;  /* All 1 bits except the sign     */
 
-int hashCode(const string & str) {
-   unsigned hash = HASH_SEED;
-   int n = str.length();
-   for (int i = 0; i < n; i++) {
-      hash = HASH_MULTIPLIER * hash + str[i];
+unsigned long long hashCode64(const char *data, size_t length) {
+   unsigned long long hash = HASH_SEED ^ (length * HASH_MULTIPLIER);
+   const char *end = data + (length & ~size_t(7));
+   for (const char *cp = data; cp < end; cp += 8) {
+      unsigned long long word;
+      memcpy(&word, cp, 8);
+      word *= HASH_MULTIPLIER;
+      word ^= word >> HASH_SHIFT;
+      word *= HASH_MULTIPLIER;
+      hash ^= word;
+      hash *= HASH_MULTIPLIER;
+   }
+   if ((length & 7) != 0) {
+      unsigned long long word = 0;
+      for (size_t i = length & 7; i > 0; i--) {
+         word = (word << 8) | (unsigned char) end[i - 1];
+      }
+      hash ^= word;
+      hash *= HASH_MULTIPLIER;
    }
-   return int(hash & HASH_MASK);
+   hash ^= hash >> HASH_SHIFT;
+   hash *= HASH_MULTIPLIER;
+   hash ^= hash >> HASH_SHIFT;
+   return hash;
+}
+
+unsigned long long hashCode64(const string & key) {
+   return hashCode64(key.data(), key.length());
+}
+
+unsigned long long hashCode64(const char *key) {
+   return hashCode64(key, strlen(key));
+}
+
+int hashCode(const string & str) {
+   return int(hashCode64(str) & HASH_MASK);
 }
 
 int hashCode(int key) {
@@ -46,3 +76,10 @@ int hashCode(char key) {
 int hashCode(long key) {
    return int(key) & HASH_MASK;
 }
+
+int hashCode(double key) {
+   if (key == 0) key = 0;                 /* -0.0 == 0.0 must hash alike */
+   unsigned long long bits;
+   memcpy(&bits, &key, sizeof bits);
+   return int((bits ^ (bits >> 32)) & HASH_MASK);
+}
@@ -8,11 +8,19 @@
 #ifndef _hashmap_h
 #define _hashmap_h
 
+#include <cstddef>
 #include <cstdlib>
+#include <cstring>
+#include <new>
 #include <string>
+#include <utility>
 #include "foreach.h"
 #include "vector.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 /*
  * Function: hashCode
  * Usage: int hash = hashCode(key);
@@ -28,6 +36,53 @@ int hashCode(char key);
 int hashCode(long key);
 int hashCode(double key);
 
+/*
+ * Function: hashCode64
+ * Usage: unsigned long long hash = hashCode64(key);
+ * -------------------------------------------------
+ * Returns a 64-bit hash code for the specified key, whose bits are all
+ * well mixed.  This is the hash the <code>HashMap</code> class uses.
+ * Strings are hashed directly from their characters, and a C string
+ * hashes the same as the <code>string</code> with the same characters.
+ * Any other type is hashed by mixing the bits of its <code>hashCode</code>.
+ */
+
+unsigned long long hashCode64(const char *data, size_t length);
+unsigned long long hashCode64(const std::string & key);
+unsigned long long hashCode64(const char *key);
+
+inline unsigned long long hashCode64(char *key) {
+   return hashCode64((const char *) key);
+}
+
+template <typename KeyType>
+unsigned long long hashCode64(const KeyType & key) {
+   unsigned long long hash = (unsigned) hashCode(key);
+   hash ^= hash >> 33;
+   hash *= 0xFF51AFD7ED558CCDULL;
+   hash ^= hash >> 33;
+   hash *= 0xC4CEB9FE1A85EC53ULL;
+   hash ^= hash >> 33;
+   return hash;
+}
+
+/*
+ * Class: CStringLookup<KeyType,CharType,ResultType>
+ * -------------------------------------------------
+ * Names ResultType as its <code>type</code> only for string keys looked
+ * up by a C string, which limits the lookup methods that take a C string
+ * to the maps where such a lookup makes sense.
+ */
+
+template <typename KeyType, typename CharType, typename ResultType>
+struct CStringLookup {
+};
+
+template <typename ResultType>
+struct CStringLookup<std::string,char,ResultType> {
+   typedef ResultType type;
+};
+
 /*
  * Class: HashMap<KeyType,ValueType>
  * ---------------------------------
@@ -60,7 +115,8 @@ public:
  *
  * that returns a positive integer determined by the key.  This interface
  * exports <code>hashCode</code> functions for <code>string</code> and
- * the C++ primitive types.
+ * the C++ primitive types.  The map mixes the bits of the hash code
+ * itself, so keys that differ only in a few bits still spread well.
  */
 
    HashMap();
@@ -97,10 +153,13 @@ public:
  * ---------------------------
  * Associates <code>key</code> with <code>value</code> in this map.
  * Any previous value associated with <code>key</code> is replaced
- * by the new value.
+ * by the new value.  A key or value that is about to disappear, such
+ * as a temporary, is moved into the map instead of copied.
  */
 
-   void put(KeyType key, ValueType value);
+   void put(const KeyType & key, const ValueType & value);
+   void put(const KeyType & key, ValueType && value);
+   void put(KeyType && key, ValueType && value);
 
 /*
  * Method: get
@@ -108,20 +167,29 @@ public:
  * --------------------------------------
  * Returns the value associated with <code>key</code> in this map.
  * If <code>key</code> is not found, <code>get</code> returns the
- * default value for <code>ValueType</code>.
+ * default value for <code>ValueType</code>.  In a map with
+ * <code>string</code> keys, <code>key</code> may also be a C string,
+ * which is looked up without being copied into a <code>string</code>.
  */
 
-   ValueType get(KeyType key) const;
+   ValueType get(const KeyType & key) const;
+   template <typename CharType>
+   typename CStringLookup<KeyType,CharType,ValueType>::type
+   get(const CharType *key) const;
 
 /*
  * Method: containsKey
  * Usage: if (map.containsKey(key)) ...
  * ------------------------------------
  * Returns <code>true</code> if there is an entry for <code>key</code>
- * in this map.
+ * in this map.  As with <code>get</code>, <code>key</code> may be a
+ * C string if the keys are strings.
  */
 
-   bool containsKey(KeyType key) const;
+   bool containsKey(const KeyType & key) const;
+   template <typename CharType>
+   typename CStringLookup<KeyType,CharType,bool>::type
+   containsKey(const CharType *key) const;
 
 /*
  * Method: remove
@@ -130,7 +198,7 @@ public:
  * Removes any entry for <code>key</code> from this map.
  */
 
-   void remove(KeyType key);
+   void remove(const KeyType & key);
 
 /*
  * Method: clear
@@ -141,6 +209,28 @@ public:
 
    void clear();
 
+/*
+ * Method: setLoadFactor
+ * Usage: map.setLoadFactor(factor);
+ * ---------------------------------
+ * Sets the fraction of the table that may be in use before it grows,
+ * which must be greater than 0 and less than 1.  A higher factor saves
+ * memory and makes lookups of missing keys slower.  The default is
+ * <code>DEFAULT_LOAD_FACTOR</code>.
+ */
+
+   void setLoadFactor(double factor);
+
+/*
+ * Method: reserve
+ * Usage: map.reserve(n);
+ * ----------------------
+ * Makes the table large enough for <code>n</code> entries, so that it
+ * does not have to grow again until the map holds more than that.
+ */
+
+   void reserve(int n);
+
 /*
  * Operator: []
  * Usage: map[key]
@@ -153,8 +243,9 @@ public:
  * whose value is set to the default for the value type.
  */
 
-   ValueType & operator[](KeyType key);
-   ValueType operator[](KeyType key) const;
+   ValueType & operator[](const KeyType & key);
+   ValueType & operator[](KeyType && key);
+   ValueType operator[](const KeyType & key) const;
 
 /*
  * Method: toString
@@ -178,6 +269,14 @@ public:
    template <typename FunctorType>
    void mapAll(FunctorType fn) const;
 
+/*
+ * Constant: DEFAULT_LOAD_FACTOR
+ * -----------------------------
+ * The load factor of a new map.
+ */
+
+   static const double DEFAULT_LOAD_FACTOR;
+
 /*
  * Additional HashMap operations
  * -----------------------------
@@ -186,6 +285,7 @@ public:
  *
  *   - Stream I/O using the << and >> operators
  *   - Deep copying for the copy constructor and assignment operator
+ *   - Moving for the move constructor and move assignment
  *   - Iteration using the range-based for statement and STL iterators
  *
  * The HashMap class makes no guarantees about the order of iteration.
@@ -201,125 +301,273 @@ public:
 /*
  * Implementation notes:
  * ---------------------
- * The HashMap class is represented using a hash table that uses
- * bucket chaining to resolve collisions.
+ * The HashMap class is represented using open addressing: the entries
+ * live in one array of slots, and a parallel array holds a control byte
+ * per slot.  A control byte is EMPTY, DELETED, or for a slot in use the
+ * low 7 bits of the hash of its key.  The slots are divided into groups
+ * of GROUP_SIZE, and a key is looked for a group at a time, starting at
+ * the group picked by the rest of its hash.  With SSE2 the control bytes
+ * of a whole group are compared with the 7 bits in one instruction, so
+ * the keys themselves are only compared where the bits match, which for
+ * a key that is missing is almost never.  A group with an EMPTY byte
+ * ends the search, since an insertion would have stopped there.  The
+ * groups are visited at steps of 1, 2, 3 and so on, which reaches every
+ * group when their number is a power of two.
  */
 
 private:
 
 /* Constant definitions */
 
-   static const int INITIAL_BUCKET_COUNT = 101;
-   static const int MAX_LOAD_PERCENTAGE = 70;
+   static const int GROUP_SIZE = 16;
+   static const signed char EMPTY = -128;
+   static const signed char DELETED = -2;
 
-/* Type definition for cells in the bucket chain */
+/* Type definition for the slots in the table */
 
-   struct Cell {
+   struct Slot {
       KeyType key;
       ValueType value;
-      Cell *next;
+      Slot(const KeyType & key) : key(key), value() {
+         /* Empty */
+      }
+      Slot(KeyType && key) : key(std::move(key)), value() {
+         /* Empty */
+      }
    };
 
 /* Instance variables */
 
-   Vector<Cell *> buckets;
-   int nBuckets;
-   int numEntries;
+   signed char *control;        /* Control byte per slot, NULL if none  */
+   Slot *slots;                 /* Raw storage, built where in use      */
+   int nGroups;                 /* Number of groups, a power of two     */
+   int numEntries;              /* Number of slots in use               */
+   int numDeleted;              /* Number of DELETED slots              */
+   double loadFactor;
 
 /* Private methods */
 
 /*
- * Private method: createBuckets
- * Usage: createBuckets(nBuckets);
- * -------------------------------
- * Sets up the vector of buckets to have nBuckets entries, each NULL.
- * If asked to make empty vector, makes one bucket just to simplify
- * handling elsewhere.
+ * Private method: match
+ * Usage: unsigned bits = match(group, tag);
+ * -----------------------------------------
+ * Returns a mask with bit i set where the control byte i of the group
+ * starting at group equals tag.
  */
 
-   void createBuckets(int nBuckets) {
-      if (nBuckets == 0) nBuckets = 1;
-      buckets = Vector<Cell *>(nBuckets, NULL);
-      this->nBuckets = nBuckets;
-      numEntries = 0;
+   static unsigned match(const signed char *group, signed char tag) {
+#ifdef __SSE2__
+      __m128i bytes = _mm_loadu_si128((const __m128i *) group);
+      return _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(tag)));
+#else
+      unsigned bits = 0;
+      for (int i = 0; i < GROUP_SIZE; i++) {
+         if (group[i] == tag) bits |= 1U << i;
+      }
+      return bits;
+#endif
    }
 
 /*
- * Private method: deleteBuckets
- * Usage: deleteBuckets(buckets);
- * ------------------------------
- * Deletes all the cells in the linked lists contained in vector.
+ * Private method: matchFree
+ * Usage: unsigned bits = matchFree(group);
+ * ----------------------------------------
+ * Returns a mask of the slots in the group that are EMPTY or DELETED,
+ * which are the control bytes with the sign bit set.
  */
 
-   void deleteBuckets(Vector <Cell *> & buckets) {
-      for (int i = 0; i < buckets.size(); i++) {
-         Cell *cp = buckets[i];
-         while (cp != NULL) {
-            Cell *np = cp->next;
-            delete cp;
-            cp = np;
-         }
-         buckets[i] = NULL;
+   static unsigned matchFree(const signed char *group) {
+#ifdef __SSE2__
+      return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) group));
+#else
+      unsigned bits = 0;
+      for (int i = 0; i < GROUP_SIZE; i++) {
+         if (group[i] < 0) bits |= 1U << i;
       }
+      return bits;
+#endif
+   }
+
+   static int lowestBit(unsigned bits) {
+#ifdef __GNUC__
+      return __builtin_ctz(bits);
+#else
+      int i = 0;
+      while ((bits & 1) == 0) {
+         bits >>= 1;
+         i++;
+      }
+      return i;
+#endif
    }
 
 /*
- * Private method: expandAndRehash
- * Usage: expandAndRehash();
- * -------------------------
- * This method is used to increase the number of buckets in the map
- * and then rehashes all existing entries and adds them into new buckets.
- * This operation is used when the load factor (i.e. the number of cells
- * per bucket) has increased enough to warrant this O(N) operation to
- * enlarge and redistribute the entries.
- */
-
-   void expandAndRehash() {
-      Vector<Cell *>oldBuckets = buckets;
-      createBuckets(oldBuckets.size() * 2 + 1);
-      for (int i = 0; i < oldBuckets.size(); i++) {
-         for (Cell *cp = oldBuckets[i]; cp != NULL; cp = cp->next) {
-            put(cp->key, cp->value);
+ * Private method: findSlot
+ * Usage: int i = findSlot(key, hash);
+ * -----------------------------------
+ * Returns the index of the slot holding key, whose hash is given, or -1
+ * if there is none.  The key may be of any type that can be compared
+ * with KeyType and hashes the same as the equal KeyType.
+ */
+
+   template <typename LookupType>
+   int findSlot(const LookupType & key, unsigned long long hash) const {
+      if (control == NULL) return -1;
+      signed char tag = hash & 0x7F;
+      int mask = nGroups - 1;
+      int group = int(hash >> 7) & mask;
+      for (int step = 1; ; step++) {
+         const signed char *bytes = control + group * GROUP_SIZE;
+         for (unsigned bits = match(bytes, tag); bits != 0; bits &= bits - 1) {
+            int i = group * GROUP_SIZE + lowestBit(bits);
+            if (slots[i].key == key) return i;
          }
+         if (match(bytes, EMPTY) != 0) return -1;
+         group = (group + step) & mask;
+      }
+   }
+
+/*
+ * Private method: findFree
+ * Usage: int i = findFree(hash);
+ * ------------------------------
+ * Returns the first EMPTY or DELETED slot on the probe sequence for hash.
+ * The load factor keeps an EMPTY slot in the table, so there is one.
+ */
+
+   int findFree(unsigned long long hash) const {
+      int mask = nGroups - 1;
+      int group = int(hash >> 7) & mask;
+      for (int step = 1; ; step++) {
+         unsigned bits = matchFree(control + group * GROUP_SIZE);
+         if (bits != 0) return group * GROUP_SIZE + lowestBit(bits);
+         group = (group + step) & mask;
+      }
+   }
+
+/*
+ * Private method: maxFilled
+ * Usage: int limit = maxFilled(nGroups);
+ * --------------------------------------
+ * Returns how many slots of a table with nGroups groups may be in use
+ * or DELETED before it is rebuilt, which always leaves one EMPTY.
+ */
+
+   int maxFilled(int nGroups) const {
+      int capacity = nGroups * GROUP_SIZE;
+      int limit = int(capacity * loadFactor);
+      return (limit < capacity) ? limit : capacity - 1;
+   }
+
+/*
+ * Private method: insertSlot
+ * Usage: int i = insertSlot(key, hash);
+ * -------------------------------------
+ * Adds an entry for key, which is not in the map, with the default
+ * value, and returns its slot.  Reusing a DELETED slot never needs a
+ * rebuild; taking an EMPTY one does once too few would be left.  A key
+ * that is about to disappear is moved into the slot.
+ */
+
+   template <typename KeyArg>
+   int insertSlot(KeyArg && key, unsigned long long hash) {
+      if (control == NULL) rehash();
+      int i = findFree(hash);
+      if (control[i] == EMPTY && numEntries + numDeleted >= maxFilled(nGroups)) {
+         rehash();
+         i = findFree(hash);
       }
-      deleteBuckets(oldBuckets);
+      new (&slots[i]) Slot(std::forward<KeyArg>(key));
+      if (control[i] == DELETED) numDeleted--;
+      control[i] = hash & 0x7F;
+      numEntries++;
+      return i;
    }
 
 /*
- * Private method: findCell
- * Usage: Cell *cp = findCell(bucket, key);
- *        Cell *cp = findCell(bucket, key, parent);
- * ------------------------------------------------
- * Finds a cell in the chain for the specified bucket that matches key.
- * If a match is found, the return value is a pointer to the cell containing
- * the matching key.  If no match is found, the function returns NULL.
- * If the optional third argument is supplied, it is filled in with the
- * cell preceding the matching cell to allow the client to splice out
- * the target cell in the delete call.  If parent is NULL, it indicates
- * that the cell is the first cell in the bucket chain.
+ * Private method: rehash
+ * Usage: rehash();
+ *        rehash(count);
+ * ----------------------
+ * Moves the entries into a new table, dropping the DELETED slots.  The
+ * table doubles unless the entries fill at most half of what it allows,
+ * in which case clearing out the DELETED slots is enough.  The second
+ * form makes the new table count groups.
  */
 
-   Cell *findCell(int bucket, KeyType key) const {
-      Cell *dummy;
-      return findCell(bucket, key, dummy);
+   void rehash() {
+      int count = (nGroups == 0) ? 1 : nGroups;
+      while (numEntries > maxFilled(count) / 2) {
+         count *= 2;
+      }
+      rehash(count);
    }
 
-   Cell *findCell(int bucket, KeyType key, Cell * & parent) const {
-      parent = NULL;
-      Cell *cp = buckets.get(bucket);
-      while (cp != NULL && key != cp->key) {
-         parent = cp;
-         cp = cp->next;
+   void rehash(int count) {
+      signed char *oldControl = control;
+      Slot *oldSlots = slots;
+      int oldCapacity = nGroups * GROUP_SIZE;
+      allocate(count);
+      for (int i = 0; i < oldCapacity; i++) {
+         if (oldControl[i] < 0) continue;
+         Slot & slot = oldSlots[i];
+         int j = findFree(hashCode64(slot.key));
+         new (&slots[j]) Slot(std::move(slot));
+         control[j] = oldControl[i];
+         slot.~Slot();
+      }
+      delete[] oldControl;
+      ::operator delete(oldSlots);
+      numDeleted = 0;
+   }
+
+/*
+ * Private method: allocate
+ * Usage: allocate(nGroups);
+ * -------------------------
+ * Replaces the arrays with new ones of nGroups groups, all EMPTY,
+ * without freeing the old ones.
+ */
+
+   void allocate(int nGroups) {
+      int capacity = nGroups * GROUP_SIZE;
+      control = new signed char[capacity];
+      memset(control, EMPTY, capacity);
+      slots = static_cast<Slot *>(::operator new(capacity * sizeof(Slot)));
+      this->nGroups = nGroups;
+   }
+
+/*
+ * Private method: destroySlots
+ * Usage: destroySlots();
+ * ----------------------
+ * Destroys the entries in use and frees both arrays.
+ */
+
+   void destroySlots() {
+      if (control == NULL) return;
+      for (int i = 0; i < nGroups * GROUP_SIZE; i++) {
+         if (control[i] >= 0) slots[i].~Slot();
       }
-      return cp;
+      delete[] control;
+      ::operator delete(slots);
+      control = NULL;
+      slots = NULL;
+      nGroups = 0;
    }
 
    void deepCopy(const HashMap & src) {
-      createBuckets(src.nBuckets);
-      for (int i = 0; i < src.nBuckets; i++) {
-         for (Cell *cp = src.buckets.get(i); cp != NULL; cp = cp->next) {
-            put(cp->key, cp->value);
-         }
+      control = NULL;
+      slots = NULL;
+      nGroups = 0;
+      numEntries = src.numEntries;
+      numDeleted = src.numDeleted;
+      loadFactor = src.loadFactor;
+      if (src.control == NULL) return;
+      allocate(src.nGroups);
+      memcpy(control, src.control, nGroups * GROUP_SIZE);
+      for (int i = 0; i < nGroups * GROUP_SIZE; i++) {
+         if (control[i] >= 0) new (&slots[i]) Slot(src.slots[i]);
       }
    }
 
@@ -344,7 +592,7 @@ public:
 
    HashMap & operator=(const HashMap & src) {
       if (this != &src) {
-         clear();
+         destroySlots();
          deepCopy(src);
       }
       return *this;
@@ -354,6 +602,42 @@ public:
       deepCopy(src);
    }
 
+/*
+ * Move support
+ * ------------
+ * The move constructor and move assignment take over the table of a
+ * map that is about to disappear instead of copying its entries.  The
+ * map moved from is left empty, with no table.
+ */
+
+   HashMap(HashMap && src) {
+      control = src.control;
+      slots = src.slots;
+      nGroups = src.nGroups;
+      numEntries = src.numEntries;
+      numDeleted = src.numDeleted;
+      loadFactor = src.loadFactor;
+      src.control = NULL;
+      src.slots = NULL;
+      src.nGroups = src.numEntries = src.numDeleted = 0;
+   }
+
+   HashMap & operator=(HashMap && src) {
+      if (this != &src) {
+         destroySlots();
+         control = src.control;
+         slots = src.slots;
+         nGroups = src.nGroups;
+         numEntries = src.numEntries;
+         numDeleted = src.numDeleted;
+         loadFactor = src.loadFactor;
+         src.control = NULL;
+         src.slots = NULL;
+         src.nGroups = src.numEntries = src.numDeleted = 0;
+      }
+      return *this;
+   }
+
 /*
  * Iterator support
  * ----------------
@@ -367,8 +651,7 @@ public:
    private:
 
       const HashMap *mp;           /* Pointer to the map           */
-      int bucket;                  /* Index of current bucket      */
-      Cell *cp;                    /* Current cell in bucket chain */
+      int index;                   /* Index of the current slot    */
 
    public:
 
@@ -378,29 +661,16 @@ public:
 
       iterator(const HashMap *mp, bool end) {
          this->mp = mp;
-         if (end) {
-            bucket = mp->nBuckets;
-            cp = NULL;
-         } else {
-            bucket = 0;
-            cp = mp->buckets.get(bucket);
-            while (cp == NULL && ++bucket < mp->nBuckets) {
-               cp = mp->buckets.get(bucket);
-            }
-         }
+         index = end ? mp->nGroups * GROUP_SIZE : nextInUse(0);
       }
 
       iterator(const iterator & it) {
          mp = it.mp;
-         bucket = it.bucket;
-         cp = it.cp;
+         index = it.index;
       }
 
       iterator & operator++() {
-         cp = cp->next;
-         while (cp == NULL && ++bucket < mp->nBuckets) {
-            cp = mp->buckets.get(bucket);
-         }
+         index = nextInUse(index + 1);
          return *this;
       }
 
@@ -411,7 +681,7 @@ public:
       }
 
       bool operator==(const iterator & rhs) {
-         return mp == rhs.mp && bucket == rhs.bucket && cp == rhs.cp;
+         return mp == rhs.mp && index == rhs.index;
       }
 
       bool operator!=(const iterator & rhs) {
@@ -419,15 +689,25 @@ public:
       }
 
       KeyType operator*() {
-         return cp->key;
+         return mp->slots[index].key;
       }
 
       KeyType *operator->() {
-         return &cp->key;
+         return &mp->slots[index].key;
       }
 
       friend class HashMap;
 
+   private:
+
+      int nextInUse(int i) {
+         int capacity = mp->nGroups * GROUP_SIZE;
+         while (i < capacity && mp->control[i] < 0) {
+            i++;
+         }
+         return i;
+      }
+
    };
 
    iterator begin() const {
@@ -443,23 +723,29 @@ public:
 /*
  * Implementation notes: HashMap class
  * -----------------------------------
- * In this map implementation, the entries are stored in a hashtable.
- * The hashtable keeps a vector of "buckets", where each bucket is a
- * linked list of elements that share the same hash code (i.e. hash
- * collisions are resolved by chaining). The buckets are dynamically
- * allocated so that we can change the the number of buckets (rehash)
- * when the load factor becomes too high. The map should provide O(1)
- * performance on the put/remove/get operations.
+ * No table is allocated until the first entry is added.  Removing an
+ * entry leaves its slot DELETED, so that searches for the keys beyond
+ * it go on, unless its group has an EMPTY slot and no search can have
+ * gone past it.  DELETED slots count against the load factor until the
+ * next rehash clears them, and clear keeps the table for reuse.
  */
 
+template <typename KeyType,typename ValueType>
+const double HashMap<KeyType,ValueType>::DEFAULT_LOAD_FACTOR = 0.875;
+
 template <typename KeyType,typename ValueType>
 HashMap<KeyType,ValueType>::HashMap() {
-   createBuckets(INITIAL_BUCKET_COUNT);
+   control = NULL;
+   slots = NULL;
+   nGroups = 0;
+   numEntries = 0;
+   numDeleted = 0;
+   loadFactor = DEFAULT_LOAD_FACTOR;
 }
 
 template <typename KeyType,typename ValueType>
 HashMap<KeyType,ValueType>::~HashMap() {
-   deleteBuckets(buckets);
+   destroySlots();
 }
 
 template <typename KeyType,typename ValueType>
@@ -473,94 +759,133 @@ bool HashMap<KeyType,ValueType>::isEmpty() const {
 }
 
 template <typename KeyType,typename ValueType>
-void HashMap<KeyType,ValueType>::put(KeyType key, ValueType value) {
+void HashMap<KeyType,ValueType>::put(const KeyType & key,
+                                     const ValueType & value) {
    (*this)[key] = value;
 }
 
 template <typename KeyType,typename ValueType>
-ValueType HashMap<KeyType,ValueType>::get(KeyType key) const {
-   Cell *cp = findCell(hashCode(key) % nBuckets, key);
-   if (cp == NULL) return ValueType();
-   return cp->value;
+void HashMap<KeyType,ValueType>::put(const KeyType & key,
+                                     ValueType && value) {
+   (*this)[key] = std::move(value);
+}
+
+template <typename KeyType,typename ValueType>
+void HashMap<KeyType,ValueType>::put(KeyType && key, ValueType && value) {
+   (*this)[std::move(key)] = std::move(value);
+}
+
+template <typename KeyType,typename ValueType>
+ValueType HashMap<KeyType,ValueType>::get(const KeyType & key) const {
+   int i = findSlot(key, hashCode64(key));
+   if (i == -1) return ValueType();
+   return slots[i].value;
+}
+
+template <typename KeyType,typename ValueType>
+template <typename CharType>
+typename CStringLookup<KeyType,CharType,ValueType>::type
+HashMap<KeyType,ValueType>::get(const CharType *key) const {
+   int i = findSlot(key, hashCode64(key));
+   if (i == -1) return ValueType();
+   return slots[i].value;
+}
+
+template <typename KeyType,typename ValueType>
+bool HashMap<KeyType,ValueType>::containsKey(const KeyType & key) const {
+   return findSlot(key, hashCode64(key)) != -1;
 }
 
 template <typename KeyType,typename ValueType>
-bool HashMap<KeyType,ValueType>::containsKey(KeyType key) const {
-   return findCell(hashCode(key) % nBuckets, key) != NULL;
+template <typename CharType>
+typename CStringLookup<KeyType,CharType,bool>::type
+HashMap<KeyType,ValueType>::containsKey(const CharType *key) const {
+   return findSlot(key, hashCode64(key)) != -1;
 }
 
 template <typename KeyType,typename ValueType>
-void HashMap<KeyType,ValueType>::remove(KeyType key) {
-   int bucket = hashCode(key) % nBuckets;
-   Cell *parent;
-   Cell *cp = findCell(bucket, key, parent);
-   if (cp != NULL) {
-      if (parent == NULL) {
-         buckets[bucket] = cp->next;
+void HashMap<KeyType,ValueType>::remove(const KeyType & key) {
+   int i = findSlot(key, hashCode64(key));
+   if (i != -1) {
+      slots[i].~Slot();
+      if (match(control + i / GROUP_SIZE * GROUP_SIZE, EMPTY) != 0) {
+         control[i] = EMPTY;
       } else {
-         parent->next = cp->next;
+         control[i] = DELETED;
+         numDeleted++;
       }
-      delete cp;
       numEntries--;
    }
 }
 
 template <typename KeyType,typename ValueType>
 void HashMap<KeyType,ValueType>::clear() {
-   deleteBuckets(buckets);
+   for (int i = 0; i < nGroups * GROUP_SIZE; i++) {
+      if (control[i] >= 0) slots[i].~Slot();
+      control[i] = EMPTY;
+   }
    numEntries = 0;
+   numDeleted = 0;
 }
 
 template <typename KeyType,typename ValueType>
-ValueType & HashMap<KeyType,ValueType>::operator[](KeyType key) {
-   int bucket = hashCode(key) % nBuckets;
-   Cell *cp = findCell(bucket, key);
-   if (cp == NULL) {
-      if (numEntries > MAX_LOAD_PERCENTAGE * nBuckets / 100.0) {
-         expandAndRehash();
-         bucket = hashCode(key) % nBuckets;
-      }
-      cp = new Cell;
-      cp->key = key;
-      cp->value = ValueType();
-      cp->next = buckets[bucket];
-      buckets[bucket] = cp;
-      numEntries++;
+void HashMap<KeyType,ValueType>::setLoadFactor(double factor) {
+   if (!(factor > 0 && factor < 1)) {
+      error("HashMap::setLoadFactor: factor must be between 0 and 1");
+   }
+   loadFactor = factor;
+}
+
+template <typename KeyType,typename ValueType>
+void HashMap<KeyType,ValueType>::reserve(int n) {
+   int count = (nGroups == 0) ? 1 : nGroups;
+   while (maxFilled(count) < n) {
+      count *= 2;
    }
-   return cp->value;
+   if (n > 0 && count > nGroups) rehash(count);
+}
+
+template <typename KeyType,typename ValueType>
+ValueType & HashMap<KeyType,ValueType>::operator[](const KeyType & key) {
+   unsigned long long hash = hashCode64(key);
+   int i = findSlot(key, hash);
+   if (i == -1) i = insertSlot(key, hash);
+   return slots[i].value;
+}
+
+template <typename KeyType,typename ValueType>
+ValueType & HashMap<KeyType,ValueType>::operator[](KeyType && key) {
+   unsigned long long hash = hashCode64(key);
+   int i = findSlot(key, hash);
+   if (i == -1) i = insertSlot(std::move(key), hash);
+   return slots[i].value;
 }
 
 template <typename KeyType,typename ValueType>
 void HashMap<KeyType,ValueType>::mapAll(void (*fn)(KeyType, ValueType)) const {
-   for (int i = 0 ; i < buckets.size(); i++) {
-      for (Cell *cp = buckets.get(i); cp != NULL; cp = cp->next) {
-         fn(cp->key, cp->value);
-      }
+   for (int i = 0; i < nGroups * GROUP_SIZE; i++) {
+      if (control[i] >= 0) fn(slots[i].key, slots[i].value);
    }
 }
 
 template <typename KeyType,typename ValueType>
 void HashMap<KeyType,ValueType>::mapAll(void (*fn)(const KeyType &,
                                                    const ValueType &)) const {
-   for (int i = 0 ; i < buckets.size(); i++) {
-      for (Cell *cp = buckets.get(i); cp != NULL; cp = cp->next) {
-         fn(cp->key, cp->value);
-      }
+   for (int i = 0; i < nGroups * GROUP_SIZE; i++) {
+      if (control[i] >= 0) fn(slots[i].key, slots[i].value);
    }
 }
 
 template <typename KeyType,typename ValueType>
 template <typename FunctorType>
 void HashMap<KeyType,ValueType>::mapAll(FunctorType fn) const {
-   for (int i = 0 ; i < buckets.size(); i++) {
-      for (Cell *cp = buckets.get(i); cp != NULL; cp = cp->next) {
-         fn(cp->key, cp->value);
-      }
+   for (int i = 0; i < nGroups * GROUP_SIZE; i++) {
+      if (control[i] >= 0) fn(slots[i].key, slots[i].value);
    }
 }
 
 template <typename KeyType, typename ValueType>
-ValueType HashMap<KeyType,ValueType>::operator[](KeyType key) const {
+ValueType HashMap<KeyType,ValueType>::operator[](const KeyType & key) const {
    return get(key);
 }
 
@@ -72,11 +72,14 @@ public:
  * ----------------------
  * Adds an element to this set, if it was not already there.  For
  * compatibility with the STL <code>set</code> class, this method
- * is also exported as <code>insert</code>.
+ * is also exported as <code>insert</code>.  A value that is about to
+ * disappear, such as a temporary, is moved instead of copied.
  */
 
    void add(const ValueType & value);
+   void add(ValueType && value);
    void insert(const ValueType & value);
+   void insert(ValueType && value);
 
 /*
  * Method: remove
@@ -94,9 +97,14 @@ public:
  * Usage: if (set.contains(value)) ...
  * -----------------------------------
  * Returns <code>true</code> if the specified value is in this set.
+ * A set of strings may also be asked about a C string, which is not
+ * copied into a <code>string</code> to do so.
  */
 
    bool contains(const ValueType & value) const;
+   template <typename CharType>
+   typename CStringLookup<ValueType,CharType,bool>::type
+   contains(const CharType *value) const;
 
 /*
  * Method: isSubsetOf
@@ -271,6 +279,7 @@ public:
  *
  *   - Stream I/O using the << and >> operators
  *   - Deep copying for the copy constructor and assignment operator
+ *   - Moving for the move constructor and move assignment
  *   - Iteration using the range-based for statement and STL iterators
  *
  * The iteration forms process the HashSet in an unspecified order.
@@ -308,6 +317,32 @@ public:
       return *this;
    }
 
+/*
+ * Copying and move support
+ * ------------------------
+ * A set is copied by copying its map.  A set that is about to
+ * disappear, such as one returned from a function, hands its map over
+ * instead and is left empty.
+ */
+
+   HashSet(const HashSet & src) : map(src.map) {
+      removeFlag = false;
+   }
+
+   HashSet(HashSet && src) : map(std::move(src.map)) {
+      removeFlag = false;
+   }
+
+   HashSet & operator=(const HashSet & src) {
+      map = src.map;
+      return *this;
+   }
+
+   HashSet & operator=(HashSet && src) {
+      map = std::move(src.map);
+      return *this;
+   }
+
 /*
  * Iterator support
  * ----------------
@@ -401,11 +436,21 @@ void HashSet<ValueType>::add(const ValueType & value) {
    map.put(value, true);
 }
 
+template <typename ValueType>
+void HashSet<ValueType>::add(ValueType && value) {
+   map.put(std::move(value), true);
+}
+
 template <typename ValueType>
 void HashSet<ValueType>::insert(const ValueType & value) {
    map.put(value, true);
 }
 
+template <typename ValueType>
+void HashSet<ValueType>::insert(ValueType && value) {
+   map.put(std::move(value), true);
+}
+
 template <typename ValueType>
 void HashSet<ValueType>::remove(const ValueType & value) {
    map.remove(value);
@@ -416,6 +461,13 @@ bool HashSet<ValueType>::contains(const ValueType & value) const {
    return map.containsKey(value);
 }
 
+template <typename ValueType>
+template <typename CharType>
+typename CStringLookup<ValueType,CharType,bool>::type
+HashSet<ValueType>::contains(const CharType *value) const {
+   return map.containsKey(value);
+}
+
 template <typename ValueType>
 void HashSet<ValueType>::clear() {
    map.clear();
@@ -9,6 +9,7 @@
 #define _map_h
 
 #include <cstdlib>
+#include <utility>
 #include "foreach.h"
 #include "stack.h"
 
@@ -68,10 +69,13 @@ public:
  * ---------------------------
  * Associates <code>key</code> with <code>value</code> in this map.
  * Any previous value associated with <code>key</code> is replaced
- * by the new value.
+ * by the new value.  A key or value that is about to disappear, such
+ * as a temporary, is moved into the map instead of copied.
  */
 
    void put(const KeyType & key, const ValueType & value);
+   void put(const KeyType & key, ValueType && value);
+   void put(KeyType && key, ValueType && value);
 
 /*
  * Method: get
@@ -125,6 +129,7 @@ public:
  */
 
    ValueType & operator[](const KeyType & key);
+   ValueType & operator[](KeyType && key);
    ValueType operator[](const KeyType & key) const;
 
 /*
@@ -158,6 +163,7 @@ public:
  *
  *   - Stream I/O using the << and >> operators
  *   - Deep copying for the copy constructor and assignment operator
+ *   - Moving for the move constructor and move assignment
  *   - Iteration using the range-based for statement and STL iterators
  *
  * All iteration is guaranteed to proceed in the order established by
@@ -284,14 +290,16 @@ private:
  * just like findNode.  If no matching node exists in the tree, addNode
  * creates a new node with a default value.  The heightFlag reference
  * parameter returns a bool indicating whether the height of the tree
- * was changed by this operation.
+ * was changed by this operation.  The key is passed on unchanged, so
+ * that a key that is about to disappear is moved into the new node.
  */
 
-   ValueType *addNode(BSTNode * & t, const KeyType & key, bool & heightFlag) {
+   template <typename KeyArg>
+   ValueType *addNode(BSTNode * & t, KeyArg && key, bool & heightFlag) {
       heightFlag = false;
       if (t == NULL)  {
          t = new BSTNode();
-         t->key = key;
+         t->key = std::forward<KeyArg>(key);
          t->value = ValueType();
          t->bf = BST_IN_BALANCE;
          t->left = t->right = NULL;
@@ -304,10 +312,10 @@ private:
       ValueType *vp = NULL;
       int bfDelta = BST_IN_BALANCE;
       if (sign < 0) {
-         vp = addNode(t->left, key, heightFlag);
+         vp = addNode(t->left, std::forward<KeyArg>(key), heightFlag);
          if (heightFlag) bfDelta = BST_LEFT_HEAVY;
       } else {
-         vp = addNode(t->right, key, heightFlag);
+         vp = addNode(t->right, std::forward<KeyArg>(key), heightFlag);
          if (heightFlag) bfDelta = BST_RIGHT_HEAVY;
       }
       updateBF(t, bfDelta);
@@ -367,7 +375,7 @@ private:
             successor = successor->right;
          }
          t->key = successor->key;
-         t->value = successor->value;
+         t->value = std::move(successor->value);
          if (removeNode(t->left, successor->key)) {
             updateBF(t, BST_RIGHT_HEAVY);
             return (t->bf == BST_IN_BALANCE);
@@ -619,6 +627,33 @@ public:
       deepCopy(src);
    }
 
+/*
+ * Move support
+ * ------------
+ * The move constructor and move assignment take over the tree of a
+ * map that is about to disappear instead of copying it.  The map moved
+ * from is left empty, with a copy of its comparator.
+ */
+
+   Map(Map && src) {
+      root = src.root;
+      nodeCount = src.nodeCount;
+      cmpp = src.cmpp;
+      src.root = NULL;
+      src.nodeCount = 0;
+      src.cmpp = cmpp->clone();
+   }
+
+   Map & operator=(Map && src) {
+      if (this != &src) {
+         std::swap(root, src.root);
+         std::swap(nodeCount, src.nodeCount);
+         std::swap(cmpp, src.cmpp);
+         src.clear();
+      }
+      return *this;
+   }
+
 /*
  * Iterator support
  * ----------------
@@ -759,6 +794,18 @@ void Map<KeyType,ValueType>::put(const KeyType & key,
    *addNode(root, key, dummy) = value;
 }
 
+template <typename KeyType, typename ValueType>
+void Map<KeyType,ValueType>::put(const KeyType & key, ValueType && value) {
+   bool dummy;
+   *addNode(root, key, dummy) = std::move(value);
+}
+
+template <typename KeyType, typename ValueType>
+void Map<KeyType,ValueType>::put(KeyType && key, ValueType && value) {
+   bool dummy;
+   *addNode(root, std::move(key), dummy) = std::move(value);
+}
+
 template <typename KeyType, typename ValueType>
 ValueType Map<KeyType,ValueType>::get(const KeyType & key) const {
    ValueType *vp = findNode(root, key);
@@ -789,6 +836,12 @@ ValueType & Map<KeyType,ValueType>::operator[](const KeyType & key) {
    return *addNode(root, key, dummy);
 }
 
+template <typename KeyType, typename ValueType>
+ValueType & Map<KeyType,ValueType>::operator[](KeyType && key) {
+   bool dummy;
+   return *addNode(root, std::move(key), dummy);
+}
+
 template <typename KeyType, typename ValueType>
 ValueType Map<KeyType,ValueType>::operator[](const KeyType & key) const {
    return get(key);
@@ -8,6 +8,7 @@
 #ifndef _pqueue_h
 #define _pqueue_h
 
+#include <utility>
 #include "vector.h"
 
 /*
@@ -18,6 +19,13 @@
  * English usage, lower priority numbers correspond to higher effective
  * priorities, so that a priority 1 item takes precedence over a
  * priority 2 item.
+ *
+ * Each call to <code>enqueue</code> returns a <i>handle</i> for the
+ * value, which stays valid until the value leaves the queue and can be
+ * used to change its priority in place.  Algorithms that lower the
+ * priority of a value they have already queued, such as Dijkstra's
+ * shortest-path algorithm, can therefore keep a single entry per value
+ * instead of enqueuing it again and skipping the stale copies.
  */
 
 template <typename ValueType>
@@ -34,6 +42,21 @@ public:
 
    PriorityQueue();
 
+/*
+ * Constructor: PriorityQueue
+ * Usage: PriorityQueue<ValueType> pq(values, priorities);
+ * -------------------------------------------------------
+ * Initializes a new priority queue that holds each element of
+ * <code>values</code> with the matching element of
+ * <code>priorities</code>, as if they had been enqueued in order.  The
+ * handle of each value is its index.  Building the queue this way takes
+ * linear time rather than the <i>N</i>&nbsp;log&nbsp;<i>N</i> of
+ * enqueuing the values one at a time.
+ */
+
+   PriorityQueue(const Vector<ValueType> & values,
+                 const Vector<double> & priorities);
+
 /*
  * Destructor: ~PriorityQueue
  * --------------------------
@@ -71,15 +94,29 @@ public:
 
 /*
  * Method: enqueue
- * Usage: pq.enqueue(value, priority);
- * -----------------------------------
- * Adds <code>value</code> to the queue with the specified priority.
- * Lower priority numbers correspond to higher priorities, which
- * means that all priority 1 elements are dequeued before any
- * priority 2 elements.
+ * Usage: int handle = pq.enqueue(value, priority);
+ * ------------------------------------------------
+ * Adds <code>value</code> to the queue with the specified priority
+ * and returns its handle.  Lower priority numbers correspond to higher
+ * priorities, which means that all priority 1 elements are dequeued
+ * before any priority 2 elements.  A value that is about to disappear,
+ * such as a temporary, is moved into the queue instead of copied.
+ * Handles of values that have left the queue are given out again.
+ */
+
+   int enqueue(const ValueType & value, double priority);
+   int enqueue(ValueType && value, double priority);
+
+/*
+ * Method: changePriority
+ * Usage: pq.changePriority(handle, priority);
+ * -------------------------------------------
+ * Changes the priority of the value with the given handle, which must
+ * still be in the queue.  Among values of equal priority, the value
+ * keeps its place in the order in which they were enqueued.
  */
 
-   void enqueue(ValueType value, double priority);
+   void changePriority(int handle, double priority);
 
 /*
  * Method: dequeue
@@ -150,33 +187,102 @@ public:
  * Implementation notes: PriorityQueue data structure
  * --------------------------------------------------
  * The PriorityQueue class is implemented using a data structure called
- * a heap.
+ * a heap, in which every node has four children rather than the usual
+ * two.  The tree is half as deep, and the four children sit next to
+ * each other in memory, which makes up for the extra comparisons on
+ * the way down and keeps down the cost of tracking where each value
+ * is as the heap changes.
+ *
+ * The values themselves live in the entries vector, indexed by handle,
+ * and never move.  The heap holds only what is needed to order them,
+ * which keeps the comparisons made while sifting within the heap.  Each
+ * entry records where its handle is in the heap, so that a value whose
+ * priority changes can be found and moved up or down from there.  The
+ * handles of entries that have left the queue are kept on the
+ * freeHandles list until enqueue gives them out again.
  */
 
 private:
 
-/* Type used for each heap entry */
+/* Types used for the heap and for the values it orders */
 
-   struct HeapEntry {
-      ValueType value;
+   struct HeapNode {
       double priority;
       long sequence;
+      int handle;
+   };
+
+   struct HeapEntry {
+      ValueType value;
+      int position;                 /* index in heap, or -1 if unused */
    };
 
+/* Constants */
+
+   static const int ARITY = 4;
+
 /* Instance variables */
 
-   Vector<HeapEntry> heap;
+   Vector<HeapEntry> entries;       /* indexed by handle              */
+   Vector<HeapNode> heap;
+   Vector<int> freeHandles;
    long enqueueCount;
-   int backIndex;
-   int count;
-   int capacity;
+   int backHandle;                  /* handle of the last value, or -1 */
 
 /* Private function prototypes */
 
-   void enqueueHeap(ValueType & value, double priority);
-   ValueType dequeueHeap();
-   bool takesPriority(int i1, int i2);
-   void swapHeapEntries(int i1, int i2);
+   bool takesPriority(const HeapNode & n1, const HeapNode & n2) const;
+   void place(int index, const HeapNode & node);
+   void siftUp(int index);
+   void siftDown(int index);
+
+public:
+
+/*
+ * Copying and move support
+ * ------------------------
+ * A priority queue is copied by copying its heap.  One that is about
+ * to disappear, such as one returned from a function, hands its heap
+ * over instead and is left empty.
+ */
+
+   PriorityQueue(const PriorityQueue & src)
+         : entries(src.entries), heap(src.heap),
+           freeHandles(src.freeHandles) {
+      enqueueCount = src.enqueueCount;
+      backHandle = src.backHandle;
+   }
+
+   PriorityQueue(PriorityQueue && src)
+         : entries(std::move(src.entries)), heap(std::move(src.heap)),
+           freeHandles(std::move(src.freeHandles)) {
+      enqueueCount = src.enqueueCount;
+      backHandle = src.backHandle;
+      src.backHandle = -1;
+   }
+
+   PriorityQueue & operator=(const PriorityQueue & src) {
+      if (this != &src) {
+         entries = src.entries;
+         heap = src.heap;
+         freeHandles = src.freeHandles;
+         enqueueCount = src.enqueueCount;
+         backHandle = src.backHandle;
+      }
+      return *this;
+   }
+
+   PriorityQueue & operator=(PriorityQueue && src) {
+      if (this != &src) {
+         entries = std::move(src.entries);
+         heap = std::move(src.heap);
+         freeHandles = std::move(src.freeHandles);
+         enqueueCount = src.enqueueCount;
+         backHandle = src.backHandle;
+         src.backHandle = -1;
+      }
+      return *this;
+   }
 
 };
 
@@ -187,6 +293,41 @@ PriorityQueue<ValueType>::PriorityQueue() {
    clear();
 }
 
+/*
+ * Implementation notes: PriorityQueue bulk constructor
+ * ----------------------------------------------------
+ * The nodes go into the heap in their original order, which is then
+ * repaired from the last parent back to the root, each node sifting
+ * down into subtrees that are already heaps.  Most nodes are near the
+ * bottom and have only a short way to go, so the pass is linear.  The
+ * last value is left for back to find.
+ */
+
+template <typename ValueType>
+PriorityQueue<ValueType>::PriorityQueue(const Vector<ValueType> & values,
+                                        const Vector<double> & priorities) {
+   if (values.size() != priorities.size()) {
+      error("PriorityQueue: Values and priorities differ in size");
+   }
+   clear();
+   int n = values.size();
+   entries.reserve(n);
+   heap.reserve(n);
+   for (int i = 0; i < n; i++) {
+      HeapEntry entry;
+      entry.value = values.get(i);
+      entry.position = i;
+      entries.add(std::move(entry));
+      HeapNode node = { priorities.get(i), enqueueCount++, i };
+      heap.add(node);
+   }
+   if (n > 1) {
+      for (int i = (n - 2) / ARITY; i >= 0; i--) {
+         siftDown(i);
+      }
+   }
+}
+
 /*
  * Implementation notes: ~PriorityQueue destructor
  * -----------------------------------------------
@@ -201,33 +342,89 @@ PriorityQueue<ValueType>::~PriorityQueue() {
 
 template <typename ValueType>
 int PriorityQueue<ValueType>::size() const {
-   return count;
+   return heap.size();
 }
 
 template <typename ValueType>
 bool PriorityQueue<ValueType>::isEmpty() const {
-   return count == 0;
+   return heap.isEmpty();
 }
 
 template <typename ValueType>
 void PriorityQueue<ValueType>::clear() {
+   entries.clear();
    heap.clear();
-   count = 0;
+   freeHandles.clear();
+   enqueueCount = 0;
+   backHandle = -1;
+}
+
+template <typename ValueType>
+int PriorityQueue<ValueType>::enqueue(const ValueType & value,
+                                      double priority) {
+   return enqueue(ValueType(value), priority);
+}
+
+/*
+ * Implementation notes: enqueue
+ * -----------------------------
+ * The new entry is filled in before it is stored, since value may be
+ * an element of entries itself, which adding to entries can move.
+ */
+
+template <typename ValueType>
+int PriorityQueue<ValueType>::enqueue(ValueType && value, double priority) {
+   HeapEntry entry;
+   entry.value = std::move(value);
+   entry.position = heap.size();
+   int handle;
+   if (freeHandles.isEmpty()) {
+      handle = entries.size();
+      entries.add(std::move(entry));
+   } else {
+      handle = freeHandles[freeHandles.size() - 1];
+      freeHandles.remove(freeHandles.size() - 1);
+      entries[handle] = std::move(entry);
+   }
+   HeapNode node = { priority, enqueueCount++, handle };
+   if (heap.isEmpty()) {
+      backHandle = handle;
+   } else if (backHandle != -1
+              && takesPriority(heap[entries[backHandle].position], node)) {
+      backHandle = handle;
+   }
+   heap.add(node);
+   siftUp(heap.size() - 1);
+   return handle;
 }
 
+/*
+ * Implementation notes: changePriority
+ * ------------------------------------
+ * The sequence number stays as it was, so that the value keeps its
+ * place among others of the same priority.  A value that moves toward
+ * the front may have been the last one, and which value is last then
+ * is left for back to work out.
+ */
+
 template <typename ValueType>
-void PriorityQueue<ValueType>::enqueue(ValueType value, double priority) {
-   if (count == heap.size()) heap.add(HeapEntry());
-   int index = count++;
-   heap[index].value = value;
+void PriorityQueue<ValueType>::changePriority(int handle, double priority) {
+   if (handle < 0 || handle >= entries.size()
+                  || entries[handle].position == -1) {
+      error("changePriority: No value in the queue has that handle");
+   }
+   int index = entries[handle].position;
+   double old = heap[index].priority;
    heap[index].priority = priority;
-   heap[index].sequence = enqueueCount++;
-   if (index == 0 || takesPriority(backIndex, index)) backIndex = index;
-   while (index > 0) {
-      int parent = (index - 1) / 2;
-      if (takesPriority(parent, index)) break;
-      swapHeapEntries(parent, index);
-      index = parent;
+   if (priority < old) {
+      if (handle == backHandle) backHandle = -1;
+      siftUp(index);
+   } else if (priority > old) {
+      if (backHandle != -1
+          && takesPriority(heap[entries[backHandle].position], heap[index])) {
+         backHandle = handle;
+      }
+      siftDown(index);
    }
 }
 
@@ -240,62 +437,113 @@ void PriorityQueue<ValueType>::enqueue(ValueType value, double priority) {
 
 template <typename ValueType>
 ValueType PriorityQueue<ValueType>::dequeue() {
-   if (count == 0) error("dequeue: Attempting to dequeue an empty queue");
-   count--;
-   bool wasBack = (backIndex == count);
-   ValueType value = heap[0].value;
-   swapHeapEntries(0, count);
-   int index = 0;
-   while (true) {
-      int left = 2 * index + 1;
-      int right = 2 * index + 2;
-      if (left >= count) break;
-      int child = left;
-      if (right < count && takesPriority(right, left)) child = right;
-      if (takesPriority(index, child)) break;
-      swapHeapEntries(index, child);
-      index = child;
+   if (heap.isEmpty()) error("dequeue: Attempting to dequeue an empty queue");
+   int handle = heap[0].handle;
+   ValueType value = std::move(entries[handle].value);
+   entries[handle].position = -1;
+   freeHandles.add(handle);
+   HeapNode last = heap[heap.size() - 1];
+   heap.remove(heap.size() - 1);
+   if (heap.isEmpty()) {
+      backHandle = -1;
+   } else {
+      heap[0] = last;
+      siftDown(0);
    }
-   if (wasBack) backIndex = index;
    return value;
 }
 
 template <typename ValueType>
 ValueType PriorityQueue<ValueType>::peek() const {
-   if (count == 0) error("peek: Attempting to peek at an empty queue");
-   return heap.get(0).value;
+   if (heap.isEmpty()) error("peek: Attempting to peek at an empty queue");
+   return entries[heap[0].handle].value;
 }
 
 template <typename ValueType>
 double PriorityQueue<ValueType>::peekPriority() const {
-   if (count == 0) error("peekPriority: Attempting to peek at an empty queue");
-   return heap.get(0).priority;
+   if (heap.isEmpty()) error("peekPriority: Attempting to peek at an empty queue");
+   return heap[0].priority;
 }
 
 template <typename ValueType>
 ValueType & PriorityQueue<ValueType>::front() {
-   if (count == 0) error("front: Attempting to read front of an empty queue");
-   return heap.get(0).value;
+   if (heap.isEmpty()) error("front: Attempting to read front of an empty queue");
+   return entries[heap[0].handle].value;
 }
 
+/*
+ * Implementation notes: back
+ * --------------------------
+ * The last value never has children, so when it is not known it is
+ * found by looking through the leaves, which start just after the
+ * parent of the final heap position.
+ */
+
 template <typename ValueType>
 ValueType & PriorityQueue<ValueType>::back() {
-   if (count == 0) error("back: Attempting to read back of an empty queue");
-   return heap.get(backIndex).value;
+   if (heap.isEmpty()) error("back: Attempting to read back of an empty queue");
+   if (backHandle == -1) {
+      int n = heap.size();
+      int last = n - 1;
+      for (int i = (n - 2) / ARITY + 1; i < n; i++) {
+         if (takesPriority(heap[last], heap[i])) last = i;
+      }
+      backHandle = heap[last].handle;
+   }
+   return entries[backHandle].value;
 }
 
 template <typename ValueType>
-bool PriorityQueue<ValueType>::takesPriority(int i1, int i2) {
-   if (heap[i1].priority < heap[i2].priority) return true;
-   if (heap[i1].priority > heap[i2].priority) return false;
-   return (heap[i1].sequence < heap[i2].sequence);
+bool PriorityQueue<ValueType>::takesPriority(const HeapNode & n1,
+                                             const HeapNode & n2) const {
+   if (n1.priority < n2.priority) return true;
+   if (n1.priority > n2.priority) return false;
+   return (n1.sequence < n2.sequence);
 }
 
 template <typename ValueType>
-void PriorityQueue<ValueType>::swapHeapEntries(int i1, int i2) {
-   HeapEntry entry = heap[i1];
-   heap[i1] = heap[i2];
-   heap[i2] = entry;
+void PriorityQueue<ValueType>::place(int index, const HeapNode & node) {
+   heap[index] = node;
+   entries[node.handle].position = index;
+}
+
+/*
+ * Implementation notes: siftUp, siftDown
+ * --------------------------------------
+ * Rather than swapping at each level, these methods hold on to the
+ * node being moved and shift the nodes it passes into the hole it
+ * leaves, placing it only once its position is known.
+ */
+
+template <typename ValueType>
+void PriorityQueue<ValueType>::siftUp(int index) {
+   HeapNode node = heap[index];
+   while (index > 0) {
+      int parent = (index - 1) / ARITY;
+      if (!takesPriority(node, heap[parent])) break;
+      place(index, heap[parent]);
+      index = parent;
+   }
+   place(index, node);
+}
+
+template <typename ValueType>
+void PriorityQueue<ValueType>::siftDown(int index) {
+   HeapNode node = heap[index];
+   int n = heap.size();
+   while (true) {
+      int first = ARITY * index + 1;
+      if (first >= n) break;
+      int limit = (first + ARITY < n) ? first + ARITY : n;
+      int best = first;
+      for (int child = first + 1; child < limit; child++) {
+         if (takesPriority(heap[child], heap[best])) best = child;
+      }
+      if (!takesPriority(heap[best], node)) break;
+      place(index, heap[best]);
+      index = best;
+   }
+   place(index, node);
 }
 
 template <typename ValueType>
@@ -9,7 +9,7 @@
 #ifndef _queue_h
 #define _queue_h
 
-#include "vector.h"
+#include "smallvector.h"
 
 /*
  * Class: Queue<ValueType>
@@ -73,10 +73,33 @@ public:
  * Method: enqueue
  * Usage: queue.enqueue(value);
  * ----------------------------
- * Adds <code>value</code> to the end of the queue.
+ * Adds <code>value</code> to the end of the queue.  A value that is
+ * about to disappear, such as a temporary, is moved instead of copied.
  */
 
-   void enqueue(ValueType value);
+   void enqueue(const ValueType & value);
+   void enqueue(ValueType && value);
+
+/*
+ * Method: emplace
+ * Usage: queue.emplace(args...);
+ * ------------------------------
+ * Adds a value built from the constructor arguments args to the end of
+ * the queue.
+ */
+
+   template <typename... ArgTypes>
+   void emplace(ArgTypes &&... args);
+
+/*
+ * Method: reserve
+ * Usage: queue.reserve(n);
+ * ------------------------
+ * Makes room for at least <code>n</code> elements, so that the queue
+ * does not have to grow again until it holds more than that.
+ */
+
+   void reserve(int n);
 
 /*
  * Method: dequeue
@@ -136,14 +159,15 @@ public:
 /*
  * Implementation notes: Queue data structure
  * ------------------------------------------
- * The Queue class is implemented using a ring buffer.
+ * The Queue class is implemented using a ring buffer, kept in a
+ * SmallVector so that a short queue never touches the heap.
  */
 
 private:
 
 /* Instance variables */
 
-   Vector<ValueType> ringBuffer;
+   SmallVector<ValueType> ringBuffer;
    int count;
    int capacity;
    int head;
@@ -152,6 +176,56 @@ private:
 /* Private functions */
 
    void expandRingBufferCapacity();
+   void resizeRingBuffer(int newCapacity);
+
+public:
+
+/*
+ * Copying and move support
+ * ------------------------
+ * A queue is copied by copying its ring buffer.  A queue that is about
+ * to disappear, such as one returned from a function, hands its ring
+ * buffer over instead and is left empty, with no buffer at all until
+ * something is enqueued.
+ */
+
+   Queue(const Queue & src) : ringBuffer(src.ringBuffer) {
+      count = src.count;
+      capacity = src.capacity;
+      head = src.head;
+      tail = src.tail;
+   }
+
+   Queue(Queue && src) : ringBuffer(std::move(src.ringBuffer)) {
+      count = src.count;
+      capacity = src.capacity;
+      head = src.head;
+      tail = src.tail;
+      src.count = src.capacity = src.head = src.tail = 0;
+   }
+
+   Queue & operator=(const Queue & src) {
+      if (this != &src) {
+         ringBuffer = src.ringBuffer;
+         count = src.count;
+         capacity = src.capacity;
+         head = src.head;
+         tail = src.tail;
+      }
+      return *this;
+   }
+
+   Queue & operator=(Queue && src) {
+      if (this != &src) {
+         ringBuffer = std::move(src.ringBuffer);
+         count = src.count;
+         capacity = src.capacity;
+         head = src.head;
+         tail = src.tail;
+         src.count = src.capacity = src.head = src.tail = 0;
+      }
+      return *this;
+   }
 
 };
 
@@ -173,10 +247,10 @@ extern void error(std::string msg);
  * this implementation lets each index wrap around back to the
  * beginning as if the ends of the array of elements were joined
  * to form a circle.  This representation is called a ring buffer.
+ * The buffer starts out as large as the inline capacity of the
+ * SmallVector that holds it and doubles when it is full.
  */
 
-const int INITIAL_CAPACITY = 10;
-
 /*
  * Implementation notes: Queue constructor
  * ---------------------------------------
@@ -192,7 +266,7 @@ Queue<ValueType>::Queue() {
 /*
  * Implementation notes: ~Queue destructor
  * ---------------------------------------
- * All of the dynamic memory is allocated in the Vector class,
+ * All of the dynamic memory is allocated in the SmallVector class,
  * so no work is required at this level.
  */
 
@@ -213,21 +287,37 @@ bool Queue<ValueType>::isEmpty() const {
 
 template <typename ValueType>
 void Queue<ValueType>::clear() {
-   capacity = INITIAL_CAPACITY;
-   ringBuffer = Vector<ValueType>(capacity);
+   capacity = SmallVector<ValueType>::INLINE_CAPACITY;
+   ringBuffer = SmallVector<ValueType>(capacity);
    head = 0;
    tail = 0;
    count = 0;
 }
 
 template <typename ValueType>
-void Queue<ValueType>::enqueue(ValueType value) {
-   if (count >= capacity - 1) expandRingBufferCapacity();
-   ringBuffer[tail] = value;
+void Queue<ValueType>::enqueue(const ValueType & value) {
+   enqueue(ValueType(value));
+}
+
+template <typename ValueType>
+void Queue<ValueType>::enqueue(ValueType && value) {
+   if (count == capacity) {
+      ValueType saved(std::move(value));
+      expandRingBufferCapacity();
+      ringBuffer[tail] = std::move(saved);
+   } else {
+      ringBuffer[tail] = std::move(value);
+   }
    tail = (tail + 1) % capacity;
    count++;
 }
 
+template <typename ValueType>
+template <typename... ArgTypes>
+void Queue<ValueType>::emplace(ArgTypes &&... args) {
+   enqueue(ValueType(std::forward<ArgTypes>(args)...));
+}
+
 /*
  * Implementation notes: dequeue, peek
  * -----------------------------------
@@ -238,7 +328,7 @@ void Queue<ValueType>::enqueue(ValueType value) {
 template <typename ValueType>
 ValueType Queue<ValueType>::dequeue() {
    if (count == 0) error("dequeue: Attempting to dequeue an empty queue");
-   ValueType result = ringBuffer[head];
+   ValueType result = std::move(ringBuffer[head]);
    head = (head + 1) % capacity;
    count--;
    return result;
@@ -263,23 +353,34 @@ ValueType & Queue<ValueType>::back() {
 }
 
 /*
- * Implementation notes: expandRingBufferCapacity
- * ----------------------------------------------
- * This private method doubles the capacity of the ringBuffer vector.
- * Note that this implementation also shifts all the elements back to
- * the beginning of the vector.
+ * Implementation notes: expandRingBufferCapacity, reserve
+ * -------------------------------------------------------
+ * The expandRingBufferCapacity method doubles the capacity of the
+ * ringBuffer vector, or gives a queue that was moved from its initial
+ * capacity back.  Both it and reserve move the elements into a new
+ * vector, which also shifts them back to the beginning.
  */
 
 template <typename ValueType>
 void Queue<ValueType>::expandRingBufferCapacity() {
-   Vector<ValueType> copy = ringBuffer;
-   ringBuffer = Vector<ValueType>(2 * capacity);
+   resizeRingBuffer(max(int(SmallVector<ValueType>::INLINE_CAPACITY), 2 * capacity));
+}
+
+template <typename ValueType>
+void Queue<ValueType>::reserve(int n) {
+   if (n > capacity) resizeRingBuffer(n);
+}
+
+template <typename ValueType>
+void Queue<ValueType>::resizeRingBuffer(int newCapacity) {
+   SmallVector<ValueType> old = std::move(ringBuffer);
+   ringBuffer = SmallVector<ValueType>(newCapacity);
    for (int i = 0; i < count; i++) {
-      ringBuffer[i] = copy[(head + i) % capacity];
+      ringBuffer[i] = std::move(old[(head + i) % capacity]);
    }
    head = 0;
    tail = count;
-   capacity *= 2;
+   capacity = newCapacity;
 }
 
 template <typename ValueType>
@@ -65,11 +65,14 @@ public:
  * ----------------------
  * Adds an element to this set, if it was not already there.  For
  * compatibility with the STL <code>set</code> class, this method
- * is also exported as <code>insert</code>.
+ * is also exported as <code>insert</code>.  A value that is about to
+ * disappear, such as a temporary, is moved instead of copied.
  */
 
    void add(const ValueType & value);
+   void add(ValueType && value);
    void insert(const ValueType & value);
+   void insert(ValueType && value);
 
 /*
  * Method: remove
@@ -264,6 +267,7 @@ public:
  *
  *   - Stream I/O using the << and >> operators
  *   - Deep copying for the copy constructor and assignment operator
+ *   - Moving for the move constructor and move assignment
  *   - Iteration using the range-based for statement and STL iterators
  *
  * The iteration forms process the Set in ascending order.
@@ -308,6 +312,32 @@ public:
       return *this;
    }
 
+/*
+ * Copying and move support
+ * ------------------------
+ * A set is copied by copying its map.  A set that is about to
+ * disappear, such as one returned from a function, hands its map over
+ * instead and is left empty.
+ */
+
+   Set(const Set & src) : map(src.map) {
+      removeFlag = false;
+   }
+
+   Set(Set && src) : map(std::move(src.map)) {
+      removeFlag = false;
+   }
+
+   Set & operator=(const Set & src) {
+      map = src.map;
+      return *this;
+   }
+
+   Set & operator=(Set && src) {
+      map = std::move(src.map);
+      return *this;
+   }
+
 /*
  * Iterator support
  * ----------------
@@ -401,11 +431,21 @@ void Set<ValueType>::add(const ValueType & value) {
    map.put(value, true);
 }
 
+template <typename ValueType>
+void Set<ValueType>::add(ValueType && value) {
+   map.put(std::move(value), true);
+}
+
 template <typename ValueType>
 void Set<ValueType>::insert(const ValueType & value) {
    map.put(value, true);
 }
 
+template <typename ValueType>
+void Set<ValueType>::insert(ValueType && value) {
+   map.put(std::move(value), true);
+}
+
 template <typename ValueType>
 void Set<ValueType>::remove(const ValueType & value) {
    map.remove(value);
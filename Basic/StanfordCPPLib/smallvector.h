@@ -0,0 +1,641 @@
+/*
+ * File: smallvector.h
+ * -------------------
+ * This file exports the <code>SmallVector</code> class, a variant of
+ * <code>Vector</code> that keeps its first few elements inside the
+ * object itself, so that short lists need no heap storage at all.
+ */
+
+#ifndef _smallvector_h
+#define _smallvector_h
+
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "error.h"
+#include "foreach.h"
+#include "strlib.h"
+
+/*
+ * Constant: SMALL_VECTOR_BYTES
+ * ----------------------------
+ * The space, one cache line, that a <code>SmallVector</code> sets aside
+ * for its elements unless told otherwise.  Elements larger than this
+ * still get one inline slot.
+ */
+
+const int SMALL_VECTOR_BYTES = 64;
+
+/*
+ * Class: SmallVector<ValueType,N>
+ * -------------------------------
+ * This class stores an ordered list of values, like
+ * <code>Vector</code>, with the same bounds-checked selection.  The
+ * first <code>N</code> elements live in an array inside the object;
+ * only a list that grows past that moves to the heap, where it then
+ * doubles as a <code>Vector</code> does.  It suits collections that
+ * are created and discarded often and seldom hold many elements, such
+ * as the stacks that iterators and evaluators keep.  The price is the
+ * size of the object, which includes room for N elements.
+ *
+ * Unlike <code>Vector</code>, a <code>SmallVector</code> constructs its
+ * elements only when they are added and destroys them when they are
+ * removed, so the element type needs no default constructor.
+ */
+
+template <typename ValueType,
+          int N = (sizeof(ValueType) < SMALL_VECTOR_BYTES)
+                  ? int(SMALL_VECTOR_BYTES / sizeof(ValueType)) : 1>
+class SmallVector {
+
+public:
+
+/*
+ * Constructor: SmallVector
+ * Usage: SmallVector<ValueType> vec;
+ *        SmallVector<ValueType> vec(n, value);
+ * --------------------------------------------
+ * Initializes a new vector.  The default constructor creates an empty
+ * vector.  The second form creates a vector with <code>n</code>
+ * elements, each of which is initialized to <code>value</code>; if
+ * <code>value</code> is missing, the elements are initialized to the
+ * default value for the type.
+ */
+
+   SmallVector();
+   explicit SmallVector(int n, const ValueType & value = ValueType());
+
+/*
+ * Destructor: ~SmallVector
+ * ------------------------
+ * Frees any heap storage allocated by this vector.
+ */
+
+   virtual ~SmallVector();
+
+/*
+ * Method: size
+ * Usage: int nElems = vec.size();
+ * -------------------------------
+ * Returns the number of elements in this vector.
+ */
+
+   int size() const;
+
+/*
+ * Method: isEmpty
+ * Usage: if (vec.isEmpty()) ...
+ * -----------------------------
+ * Returns <code>true</code> if this vector contains no elements.
+ */
+
+   bool isEmpty() const;
+
+/*
+ * Method: clear
+ * Usage: vec.clear();
+ * -------------------
+ * Removes all elements from this vector and frees its heap storage,
+ * if it has any.
+ */
+
+   void clear();
+
+/*
+ * Method: get
+ * Usage: ValueType val = vec.get(index);
+ * --------------------------------------
+ * Returns the element at the specified index in this vector.  This
+ * method signals an error if the index is not in the array range.
+ */
+
+   const ValueType & get(int index) const;
+
+/*
+ * Method: set
+ * Usage: vec.set(index, value);
+ * -----------------------------
+ * Replaces the element at the specified index in this vector with
+ * a new value.  This method signals an error if the index is not in
+ * the array range.
+ */
+
+   void set(int index, const ValueType & value);
+   void set(int index, ValueType && value);
+
+/*
+ * Method: insert
+ * Usage: vec.insert(0, value);
+ * ----------------------------
+ * Inserts the element into this vector before the specified index.
+ * All subsequent elements are shifted one position to the right.  This
+ * method signals an error if the index is outside the range from 0
+ * up to and including the length of the vector.
+ */
+
+   void insert(int index, const ValueType & value);
+   void insert(int index, ValueType && value);
+
+/*
+ * Method: emplace
+ * Usage: vec.emplace(index, args...);
+ * -----------------------------------
+ * Inserts a value built from the constructor arguments args before the
+ * specified index, as <code>insert</code> does.
+ */
+
+   template <typename... ArgTypes>
+   void emplace(int index, ArgTypes &&... args);
+
+/*
+ * Method: remove
+ * Usage: vec.remove(index);
+ * -------------------------
+ * Removes the element at the specified index from this vector.
+ * All subsequent elements are shifted one position to the left.  This
+ * method signals an error if the index is outside the array range.
+ */
+
+   void remove(int index);
+
+/*
+ * Method: add
+ * Usage: vec.add(value);
+ * ----------------------
+ * Adds a new value to the end of this vector.  This method is also
+ * called <code>push_back</code>.  A value that is about to disappear,
+ * such as a temporary, is moved instead of copied.
+ */
+
+   void add(const ValueType & value);
+   void add(ValueType && value);
+   void push_back(const ValueType & value);
+   void push_back(ValueType && value);
+
+/*
+ * Method: emplace_back
+ * Usage: vec.emplace_back(args...);
+ * ---------------------------------
+ * Builds a value from the constructor arguments args directly at the
+ * end of this vector.
+ */
+
+   template <typename... ArgTypes>
+   void emplace_back(ArgTypes &&... args);
+
+/*
+ * Method: reserve
+ * Usage: vec.reserve(n);
+ * ----------------------
+ * Makes room for at least <code>n</code> elements, so that the vector
+ * does not have to grow again until it holds more than that.
+ */
+
+   void reserve(int n);
+
+/*
+ * Operator: []
+ * Usage: vec[index]
+ * -----------------
+ * Overloads <code>[]</code> to select elements from this vector.
+ * This method signals an error if the index is outside the array
+ * range, exactly as the <code>Vector</code> version does.
+ */
+
+   ValueType & operator[](int index);
+   const ValueType & operator[](int index) const;
+
+/*
+ * Method: toString
+ * Usage: string str = vec.toString();
+ * -----------------------------------
+ * Converts the vector to a printable string representation.
+ */
+
+   std::string toString();
+
+/*
+ * Constant: INLINE_CAPACITY
+ * -------------------------
+ * The number of elements this vector holds without heap storage.
+ */
+
+   static const int INLINE_CAPACITY = N;
+
+/*
+ * Additional SmallVector operations
+ * ---------------------------------
+ * In addition to the methods listed in this interface, the SmallVector
+ * class supports the following operations:
+ *
+ *   - Stream I/O using the << and >> operators
+ *   - Deep copying for the copy constructor and assignment operator
+ *   - Moving for the move constructor and move assignment
+ *   - Iteration using the range-based for statement or STL iterators
+ *
+ * The iteration forms process the vector in index order.
+ */
+
+/* Private section */
+
+/**********************************************************************/
+/* Note: Everything below this point in the file is logically part    */
+/* of the implementation and should not be of interest to clients.    */
+/**********************************************************************/
+
+private:
+
+/*
+ * Implementation notes: SmallVector data structure
+ * ------------------------------------------------
+ * The elements are stored in raw storage, either the buffer inside the
+ * object or a heap array, and elements points at whichever is in use.
+ * Only the first count slots hold constructed elements.  Once a vector
+ * has moved to the heap it stays there until it is cleared.
+ */
+
+/* Instance variables */
+
+   ValueType *elements;        /* The buffer or the heap array      */
+   int capacity;               /* The number of slots in that array */
+   int count;                  /* The number of elements in use     */
+   typename std::aligned_storage<sizeof(ValueType),
+                                 alignof(ValueType)>::type buffer[N];
+
+/* Private methods */
+
+   bool isInline() const;
+   void replaceArray(ValueType *array, int newCapacity);
+   void deepCopy(const SmallVector & src);
+   void takeOver(SmallVector & src);
+
+/*
+ * Hidden features
+ * ---------------
+ * The remainder of this file consists of the code required to
+ * support deep copying and iteration.  Including these methods
+ * in the public interface would make that interface more
+ * difficult to understand for the average client.
+ */
+
+public:
+
+/*
+ * Deep copying support
+ * --------------------
+ * This copy constructor and operator= are defined to make a deep copy,
+ * making it possible to pass or return vectors by value and assign
+ * from one vector to another.
+ */
+
+   SmallVector(const SmallVector & src);
+   SmallVector & operator=(const SmallVector & src);
+
+/*
+ * Move support
+ * ------------
+ * A vector on the heap hands its array over.  One that is still inline
+ * moves its elements one by one, which is cheap for the few it holds.
+ * Either way the vector moved from is left empty.
+ */
+
+   SmallVector(SmallVector && src);
+   SmallVector & operator=(SmallVector && src);
+
+/*
+ * Iterator support
+ * ----------------
+ * The elements are contiguous, so pointers serve as random-access
+ * iterators.
+ */
+
+   typedef ValueType *iterator;
+   typedef const ValueType *const_iterator;
+
+   iterator begin() {
+      return elements;
+   }
+
+   iterator end() {
+      return elements + count;
+   }
+
+   const_iterator begin() const {
+      return elements;
+   }
+
+   const_iterator end() const {
+      return elements + count;
+   }
+
+};
+
+/* Implementation section */
+
+template <typename ValueType, int N>
+SmallVector<ValueType,N>::SmallVector() {
+   elements = reinterpret_cast<ValueType *>(buffer);
+   capacity = N;
+   count = 0;
+}
+
+template <typename ValueType, int N>
+SmallVector<ValueType,N>::SmallVector(int n, const ValueType & value) {
+   elements = reinterpret_cast<ValueType *>(buffer);
+   capacity = N;
+   count = 0;
+   reserve(n);
+   for (int i = 0; i < n; i++) {
+      new (&elements[i]) ValueType(value);
+      count++;
+   }
+}
+
+template <typename ValueType, int N>
+SmallVector<ValueType,N>::~SmallVector() {
+   clear();
+}
+
+template <typename ValueType, int N>
+int SmallVector<ValueType,N>::size() const {
+   return count;
+}
+
+template <typename ValueType, int N>
+bool SmallVector<ValueType,N>::isEmpty() const {
+   return count == 0;
+}
+
+template <typename ValueType, int N>
+void SmallVector<ValueType,N>::clear() {
+   for (int i = 0; i < count; i++) {
+      elements[i].~ValueType();
+   }
+   count = 0;
+   if (!isInline()) {
+      ::operator delete(elements);
+      elements = reinterpret_cast<ValueType *>(buffer);
+      capacity = N;
+   }
+}
+
+template <typename ValueType, int N>
+const ValueType & SmallVector<ValueType,N>::get(int index) const {
+   if (index < 0 || index >= count) error("get: index out of range");
+   return elements[index];
+}
+
+template <typename ValueType, int N>
+void SmallVector<ValueType,N>::set(int index, const ValueType & value) {
+   if (index < 0 || index >= count) error("set: index out of range");
+   elements[index] = value;
+}
+
+template <typename ValueType, int N>
+void SmallVector<ValueType,N>::set(int index, ValueType && value) {
+   if (index < 0 || index >= count) error("set: index out of range");
+   elements[index] = std::move(value);
+}
+
+/*
+ * Implementation notes: insert, remove, emplace_back
+ * --------------------------------------------------
+ * Inserting in the middle moves the last element into the first free
+ * slot and the others up by assignment; removing moves them down and
+ * destroys the last.  As in Vector, the value to insert may be one of
+ * the elements, so it is taken out of the way first.  The arguments of
+ * emplace_back may refer to elements too, which is why the new element
+ * is built in a new array before the old elements are moved over.
+ */
+
+template <typename ValueType, int N>
+void SmallVector<ValueType,N>::insert(int index, const ValueType & value) {
+   insert(index, ValueType(value));
+}
+
+template <typename ValueType, int N>
+void SmallVector<ValueType,N>::insert(int index, ValueType && value) {
+   if (index < 0 || index > count) error("insert: index out of range");
+   if (index == count) {
+      emplace_back(std::move(value));
+      return;
+   }
+   ValueType saved(std::move(value));
+   emplace_back(std::move(elements[count - 1]));
+   for (int i = count - 2; i > index; i--) {
+      elements[i] = std::move(elements[i - 1]);
+   }
+   elements[index] = std::move(saved);
+}
+
+template <typename ValueType, int N>
+template <typename... ArgTypes>
+void SmallVector<ValueType,N>::emplace(int index, ArgTypes &&... args) {
+   insert(index, ValueType(std::forward<ArgTypes>(args)...));
+}
+
+template <typename ValueType, int N>
+void SmallVector<ValueType,N>::remove(int index) {
+   if (index < 0 || index >= count) error("remove: index out of range");
+   for (int i = index; i < count - 1; i++) {
+      elements[i] = std::move(elements[i + 1]);
+   }
+   count--;
+   elements[count].~ValueType();
+}
+
+template <typename ValueType, int N>
+void SmallVector<ValueType,N>::add(const ValueType & value) {
+   emplace_back(value);
+}
+
+template <typename ValueType, int N>
+void SmallVector<ValueType,N>::add(ValueType && value) {
+   emplace_back(std::move(value));
+}
+
+template <typename ValueType, int N>
+void SmallVector<ValueType,N>::push_back(const ValueType & value) {
+   emplace_back(value);
+}
+
+template <typename ValueType, int N>
+void SmallVector<ValueType,N>::push_back(ValueType && value) {
+   emplace_back(std::move(value));
+}
+
+template <typename ValueType, int N>
+template <typename... ArgTypes>
+void SmallVector<ValueType,N>::emplace_back(ArgTypes &&... args) {
+   if (count < capacity) {
+      new (&elements[count]) ValueType(std::forward<ArgTypes>(args)...);
+   } else {
+      int newCapacity = 2 * capacity;
+      ValueType *array =
+         static_cast<ValueType *>(::operator new(newCapacity * sizeof(ValueType)));
+      new (&array[count]) ValueType(std::forward<ArgTypes>(args)...);
+      replaceArray(array, newCapacity);
+   }
+   count++;
+}
+
+template <typename ValueType, int N>
+void SmallVector<ValueType,N>::reserve(int n) {
+   if (n <= capacity) return;
+   replaceArray(static_cast<ValueType *>(::operator new(n * sizeof(ValueType))), n);
+}
+
+template <typename ValueType, int N>
+ValueType & SmallVector<ValueType,N>::operator[](int index) {
+   if (index < 0 || index >= count) error("Selection index out of range");
+   return elements[index];
+}
+
+template <typename ValueType, int N>
+const ValueType & SmallVector<ValueType,N>::operator[](int index) const {
+   if (index < 0 || index >= count) error("Selection index out of range");
+   return elements[index];
+}
+
+template <typename ValueType, int N>
+std::string SmallVector<ValueType,N>::toString() {
+   ostringstream os;
+   os << *this;
+   return os.str();
+}
+
+/*
+ * Implementation notes: private methods
+ * -------------------------------------
+ * The replaceArray method moves the elements into a new heap array,
+ * destroys the old ones and frees the old array unless it was the
+ * buffer.  The takeOver method is the common part of both kinds of
+ * move, for a vector that starts out empty and inline.
+ */
+
+template <typename ValueType, int N>
+bool SmallVector<ValueType,N>::isInline() const {
+   return elements == reinterpret_cast<const ValueType *>(buffer);
+}
+
+template <typename ValueType, int N>
+void SmallVector<ValueType,N>::replaceArray(ValueType *array, int newCapacity) {
+   for (int i = 0; i < count; i++) {
+      new (&array[i]) ValueType(std::move(elements[i]));
+      elements[i].~ValueType();
+   }
+   if (!isInline()) ::operator delete(elements);
+   elements = array;
+   capacity = newCapacity;
+}
+
+template <typename ValueType, int N>
+void SmallVector<ValueType,N>::deepCopy(const SmallVector & src) {
+   reserve(src.count);
+   for (int i = 0; i < src.count; i++) {
+      new (&elements[i]) ValueType(src.elements[i]);
+      count++;
+   }
+}
+
+template <typename ValueType, int N>
+void SmallVector<ValueType,N>::takeOver(SmallVector & src) {
+   if (src.isInline()) {
+      for (int i = 0; i < src.count; i++) {
+         new (&elements[i]) ValueType(std::move(src.elements[i]));
+         count++;
+      }
+      src.clear();
+   } else {
+      elements = src.elements;
+      capacity = src.capacity;
+      count = src.count;
+      src.elements = reinterpret_cast<ValueType *>(src.buffer);
+      src.capacity = N;
+      src.count = 0;
+   }
+}
+
+template <typename ValueType, int N>
+SmallVector<ValueType,N>::SmallVector(const SmallVector & src) {
+   elements = reinterpret_cast<ValueType *>(buffer);
+   capacity = N;
+   count = 0;
+   deepCopy(src);
+}
+
+template <typename ValueType, int N>
+SmallVector<ValueType,N> &
+SmallVector<ValueType,N>::operator=(const SmallVector & src) {
+   if (this != &src) {
+      clear();
+      deepCopy(src);
+   }
+   return *this;
+}
+
+template <typename ValueType, int N>
+SmallVector<ValueType,N>::SmallVector(SmallVector && src) {
+   elements = reinterpret_cast<ValueType *>(buffer);
+   capacity = N;
+   count = 0;
+   takeOver(src);
+}
+
+template <typename ValueType, int N>
+SmallVector<ValueType,N> &
+SmallVector<ValueType,N>::operator=(SmallVector && src) {
+   if (this != &src) {
+      clear();
+      takeOver(src);
+   }
+   return *this;
+}
+
+/*
+ * Implementation notes: << and >>
+ * -------------------------------
+ * The insertion and extraction operators use the template facilities in
+ * strlib.h to read and write generic values in a way that treats strings
+ * specially.
+ */
+
+template <typename ValueType, int N>
+std::ostream & operator<<(std::ostream & os,
+                          const SmallVector<ValueType,N> & vec) {
+   os << "{";
+   int len = vec.size();
+   for (int i = 0; i < len; i++) {
+      if (i > 0) os << ", ";
+      writeGenericValue(os, vec[i], true);
+   }
+   return os << "}";
+}
+
+template <typename ValueType, int N>
+std::istream & operator>>(std::istream & is, SmallVector<ValueType,N> & vec) {
+   char ch;
+   is >> ch;
+   if (ch != '{') error("operator >>: Missing {");
+   vec.clear();
+   is >> ch;
+   if (ch != '}') {
+      is.unget();
+      while (true) {
+         ValueType value;
+         readGenericValue(is, value);
+         vec.add(std::move(value));
+         is >> ch;
+         if (ch == '}') break;
+         if (ch != ',') {
+            error(std::string("operator >>: Unexpected character ") + ch);
+         }
+      }
+   }
+   return is;
+}
+
+#endif
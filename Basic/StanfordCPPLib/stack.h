@@ -8,7 +8,7 @@
 #ifndef _stack_h
 #define _stack_h
 
-#include "vector.h"
+#include "smallvector.h"
 
 /*
  * Class: Stack<ValueType>
@@ -74,10 +74,33 @@ public:
  * Method: push
  * Usage: stack.push(value);
  * -------------------------
- * Pushes the specified value onto this stack.
+ * Pushes the specified value onto this stack.  A value that is about
+ * to disappear, such as a temporary, is moved instead of copied.
  */
 
-   void push(ValueType value);
+   void push(const ValueType & value);
+   void push(ValueType && value);
+
+/*
+ * Method: emplace
+ * Usage: stack.emplace(args...);
+ * ------------------------------
+ * Pushes a value built from the constructor arguments args onto this
+ * stack.
+ */
+
+   template <typename... ArgTypes>
+   void emplace(ArgTypes &&... args);
+
+/*
+ * Method: reserve
+ * Usage: stack.reserve(n);
+ * ------------------------
+ * Makes room for at least <code>n</code> elements, so that the stack
+ * does not have to grow again until it holds more than that.
+ */
+
+   void reserve(int n);
 
 /*
  * Method: pop
@@ -123,13 +146,43 @@ public:
  * Implementation notes: Stack data structure
  * ------------------------------------------
  * The easiest way to implement a stack is to store the elements in a
- * Vector.  Doing so means that the problems of dynamic memory allocation
+ * vector.  Doing so means that the problems of dynamic memory allocation
  * and copy assignment are already solved by the implementation of the
- * underlying Vector class.
+ * underlying vector class.  The vector is a SmallVector, since most
+ * stacks are short-lived and shallow: those that never hold more than
+ * its inline capacity never touch the heap.
  */
 
 private:
-   Vector<ValueType> elements;
+   SmallVector<ValueType> elements;
+
+public:
+
+/*
+ * Copying and move support
+ * ------------------------
+ * A stack is copied by copying its vector.  A stack that is about to
+ * disappear, such as one returned from a function, hands its vector
+ * over instead and is left empty.
+ */
+
+   Stack(const Stack & src) : elements(src.elements) {
+      /* Empty */
+   }
+
+   Stack(Stack && src) : elements(std::move(src.elements)) {
+      /* Empty */
+   }
+
+   Stack & operator=(const Stack & src) {
+      elements = src.elements;
+      return *this;
+   }
+
+   Stack & operator=(Stack && src) {
+      elements = std::move(src.elements);
+      return *this;
+   }
 
 };
 
@@ -138,7 +191,7 @@ extern void error(std::string msg);
 /*
  * Stack class implementation
  * --------------------------
- * The Stack is internally managed using a Vector.  This layered design
+ * The Stack is internally managed using a SmallVector.  This layered design
  * makes the implementation extremely simple, to the point that most
  * methods can be implemented in as single line.
  */
@@ -164,14 +217,30 @@ bool Stack<ValueType>::isEmpty() const {
 }
 
 template <typename ValueType>
-void Stack<ValueType>::push(ValueType value) {
+void Stack<ValueType>::push(const ValueType & value) {
    elements.add(value);
 }
 
+template <typename ValueType>
+void Stack<ValueType>::push(ValueType && value) {
+   elements.add(std::move(value));
+}
+
+template <typename ValueType>
+template <typename... ArgTypes>
+void Stack<ValueType>::emplace(ArgTypes &&... args) {
+   elements.emplace_back(std::forward<ArgTypes>(args)...);
+}
+
+template <typename ValueType>
+void Stack<ValueType>::reserve(int n) {
+   elements.reserve(n);
+}
+
 template <typename ValueType>
 ValueType Stack<ValueType>::pop() {
    if (isEmpty()) error("pop: Attempting to pop an empty stack");
-   ValueType top = elements[elements.size() - 1];
+   ValueType top = std::move(elements[elements.size() - 1]);
    elements.remove(elements.size() - 1);
    return top;
 }
@@ -5,154 +5,352 @@
  */
 
 #include <cctype>
+#include <cstring>
 #include <iostream>
+#include <iterator>
 #include "error.h"
 #include "tokenscanner.h"
 #include "strlib.h"
 #include "stack.h"
 using namespace std;
 
-TokenScanner::TokenScanner() {
-   initScanner();
-   setInput("");
+/* Token */
+
+bool Token::equals(const char *str) const {
+   return strncmp(text, str, length) == 0 && str[length] == '\0';
 }
 
-TokenScanner::TokenScanner(string str) {
-   initScanner();
-   setInput(str);
+string Token::toString() const {
+   return string(text, length);
 }
 
-TokenScanner::TokenScanner(istream & infile) {
-   initScanner();
-   setInput(infile);
+/* Lexer */
+
+Lexer::Lexer() {
+   initLexer();
+   setInput("", 0);
 }
 
-TokenScanner::~TokenScanner() {
-   if (stringInputFlag) delete isp;
+Lexer::Lexer(const char *text, int length) {
+   initLexer();
+   setInput(text, length);
 }
 
-void TokenScanner::setInput(string str) {
-   stringInputFlag = true;
-   buffer = str;
-   isp = new istringstream(buffer);
-   savedTokens = NULL;
+void Lexer::setInput(const char *text, int length) {
+   begin = cursor = text;
+   end = text + length;
+   peekEnd = NULL;
 }
 
-void TokenScanner::setInput(istream & infile) {
-   stringInputFlag = false;
-   isp = &infile;
-   savedTokens = NULL;
+void Lexer::setInput(const string & str) {
+   setInput(str.data(), str.length());
 }
 
-bool TokenScanner::hasMoreTokens() {
-   string token = nextToken();
-   saveToken(token);
-   return (token != "");
+Token Lexer::next() {
+   if (peekEnd != NULL) {
+      cursor = peekEnd;
+      peekEnd = NULL;
+      return peeked;
+   }
+   return scan();
 }
 
-string TokenScanner::nextToken() {
-   if (savedTokens != NULL) {
-      StringCell *cp = savedTokens;
-      string token = cp->str;
-      savedTokens = cp->link;
-      delete cp;
-      return token;
+/*
+ * Implementation notes: peek
+ * --------------------------
+ * The peeked token is kept together with the position after it, so
+ * the next call to next costs nothing.  The cursor itself stays before
+ * the token, which keeps getPosition and getChar where the caller left
+ * them.
+ */
+
+Token Lexer::peek() {
+   if (peekEnd == NULL) {
+      const char *start = cursor;
+      peeked = scan();
+      peekEnd = cursor;
+      cursor = start;
    }
+   return peeked;
+}
+
+bool Lexer::hasMoreTokens() {
+   return peek().length > 0;
+}
+
+int Lexer::getPosition() const {
+   return cursor - begin;
+}
+
+int Lexer::getChar() {
+   peekEnd = NULL;
+   if (cursor == end) return EOF;
+   return (unsigned char) *cursor++;
+}
+
+void Lexer::ungetChar() {
+   peekEnd = NULL;
+   if (cursor > begin) cursor--;
+}
+
+void Lexer::ignoreWhitespace() {
+   ignoreWhitespaceFlag = true;
+   peekEnd = NULL;
+}
+
+void Lexer::ignoreComments() {
+   ignoreCommentsFlag = true;
+   peekEnd = NULL;
+}
+
+void Lexer::scanNumbers() {
+   scanNumbersFlag = true;
+   peekEnd = NULL;
+}
+
+void Lexer::scanStrings() {
+   scanStringsFlag = true;
+   peekEnd = NULL;
+}
+
+void Lexer::addWordCharacters(const string & str) {
+   for (size_t i = 0; i < str.length(); i++) wordTable[(unsigned char) str[i]] = true;
+   peekEnd = NULL;
+}
+
+void Lexer::addOperator(const string & op) {
+   operators.push_back(op);
+   peekEnd = NULL;
+}
+
+bool Lexer::isWordCharacter(char ch) const {
+   return wordTable[(unsigned char) ch];
+}
+
+void Lexer::initLexer() {
+   ignoreWhitespaceFlag = false;
+   ignoreCommentsFlag = false;
+   scanNumbersFlag = false;
+   scanStringsFlag = false;
+   for (int ch = 0; ch < 256; ch++) wordTable[ch] = isalnum(ch);
+}
+
+/*
+ * Implementation notes: scan
+ * --------------------------
+ * This is the loop of the original TokenScanner::nextToken, working on
+ * a pointer instead of an istream.  Comments are skipped by looping
+ * back to the top; every other branch finds the end of one token and
+ * leaves the cursor there.  The longest operator is found by comparing
+ * the operators in place, since any operator that matches here is
+ * what the old prefix search would have grown into.
+ */
+
+Token Lexer::scan() {
    while (true) {
-      if (ignoreWhitespaceFlag) skipSpaces();
-      int ch = isp->get();
-      if (ch == '/' && ignoreCommentsFlag) {
-         ch = isp->get();
-         if (ch == '/') {
-            while (true) {
-               ch = isp->get();
-               if (ch == '\n' || ch == '\r' || ch == EOF) break;
+      if (ignoreWhitespaceFlag) {
+         while (cursor < end && isspace((unsigned char) *cursor)) cursor++;
+      }
+      const char *start = cursor;
+      if (cursor == end) return makeToken(start);
+      unsigned char ch = *cursor;
+      if (ch == '/' && ignoreCommentsFlag && cursor + 1 < end) {
+         if (cursor[1] == '/') {
+            cursor += 2;
+            while (cursor < end) {
+               ch = *cursor++;
+               if (ch == '\n' || ch == '\r') break;
             }
             continue;
-         } else if (ch == '*') {
+         } else if (cursor[1] == '*') {
+            cursor += 2;
             int prev = EOF;
-            while (true) {
-               ch = isp->get();
-               if (ch == EOF || (prev == '*' && ch == '/')) break;
+            while (cursor < end) {
+               ch = *cursor++;
+               if (prev == '*' && ch == '/') break;
                prev = ch;
             }
             continue;
          }
-         if (ch != EOF) isp->unget();
-         ch = '/';
       }
-      if (ch == EOF) return "";
       if ((ch == '"' || ch == '\'') && scanStringsFlag) {
-         isp->unget();
-         return scanString();
-      }
-      if (isdigit(ch) && scanNumbersFlag) {
-         isp->unget();
-         return scanNumber();
-      }
-      if (isWordCharacter(ch)) {
-         isp->unget();
-         return scanWord();
-      }
-      string op = string(1, ch);
-      while (isOperatorPrefix(op)) {
-         ch = isp->get();
-         if (ch == EOF) break;
-         op += ch;
+         skipString();
+      } else if (isdigit(ch) && scanNumbersFlag) {
+         skipNumber();
+      } else if (wordTable[ch]) {
+         while (cursor < end && wordTable[(unsigned char) *cursor]) cursor++;
+      } else {
+         size_t longest = 1;
+         size_t left = end - cursor;
+         for (size_t i = 0; i < operators.size(); i++) {
+            const string & op = operators[i];
+            if (op.length() > longest && op.length() <= left
+                && memcmp(cursor, op.data(), op.length()) == 0) {
+               longest = op.length();
+            }
+         }
+         cursor += longest;
       }
-      while (op.length() > 1 && !isOperator(op)) {
-         isp->unget();
-         op.erase(op.length() - 1, 1);
+      return makeToken(start);
+   }
+}
+
+/*
+ * Implementation notes: makeToken
+ * -------------------------------
+ * Builds the token from start to the cursor.  The type is worked out
+ * from the characters by the same rules as getTokenType, so the two
+ * always agree.
+ */
+
+Token Lexer::makeToken(const char *start) const {
+   Token token;
+   token.text = start;
+   token.length = cursor - start;
+   if (token.length == 0) {
+      token.type = TokenType(EOF);
+      return token;
+   }
+   unsigned char ch = *start;
+   if (isspace(ch)) {
+      token.type = SEPARATOR;
+   } else if (ch == '"' || (ch == '\'' && token.length > 1)) {
+      token.type = STRING;
+   } else if (isdigit(ch)) {
+      token.type = NUMBER;
+   } else if (wordTable[ch]) {
+      token.type = WORD;
+   } else {
+      token.type = OPERATOR;
+   }
+   return token;
+}
+
+/*
+ * Implementation notes: skipNumber
+ * --------------------------------
+ * Moves the cursor to the end of the longest prefix that is a legal
+ * number: digits, an optional fraction and an optional exponent.  An
+ * exponent marker without digits after it is not part of the number,
+ * which is what the state machine of the original scanner did by
+ * pushing those characters back.
+ */
+
+void Lexer::skipNumber() {
+   while (cursor < end && isdigit((unsigned char) *cursor)) cursor++;
+   if (cursor < end && *cursor == '.') {
+      cursor++;
+      while (cursor < end && isdigit((unsigned char) *cursor)) cursor++;
+   }
+   if (cursor < end && (*cursor == 'E' || *cursor == 'e')) {
+      const char *p = cursor + 1;
+      if (p < end && (*p == '+' || *p == '-')) p++;
+      if (p < end && isdigit((unsigned char) *p)) {
+         while (p < end && isdigit((unsigned char) *p)) p++;
+         cursor = p;
       }
-      return op;
    }
 }
 
+/*
+ * Implementation notes: skipString
+ * --------------------------------
+ * Moves the cursor past the quoted string that starts there.  The
+ * scanner generates an error if there is no closing quotation mark
+ * before the end of the input.
+ */
+
+void Lexer::skipString() {
+   char delim = *cursor++;
+   bool escape = false;
+   while (true) {
+      if (cursor == end) error("TokenScanner found unterminated string");
+      char ch = *cursor++;
+      if (ch == delim && !escape) break;
+      escape = (ch == '\\') && !escape;
+   }
+}
+
+/* TokenScanner */
+
+TokenScanner::TokenScanner() {
+   setInput("");
+}
+
+TokenScanner::TokenScanner(string str) {
+   setInput(str);
+}
+
+TokenScanner::TokenScanner(istream & infile) {
+   setInput(infile);
+}
+
+TokenScanner::~TokenScanner() {
+   /* Empty */
+}
+
+void TokenScanner::setInput(string str) {
+   buffer = str;
+   lexer.setInput(buffer);
+   savedTokens.clear();
+}
+
+void TokenScanner::setInput(istream & infile) {
+   buffer.assign(istreambuf_iterator<char>(infile), istreambuf_iterator<char>());
+   lexer.setInput(buffer);
+   savedTokens.clear();
+}
+
+bool TokenScanner::hasMoreTokens() {
+   if (!savedTokens.empty()) return savedTokens.back() != "";
+   return lexer.hasMoreTokens();
+}
+
+string TokenScanner::nextToken() {
+   if (!savedTokens.empty()) {
+      string token = savedTokens.back();
+      savedTokens.pop_back();
+      return token;
+   }
+   return lexer.next().toString();
+}
+
 void TokenScanner::saveToken(string token) {
-   StringCell *cp = new StringCell;
-   cp->str = token;
-   cp->link = savedTokens;
-   savedTokens = cp;
+   savedTokens.push_back(token);
 }
 
 void TokenScanner::ignoreWhitespace() {
-   ignoreWhitespaceFlag = true;
+   lexer.ignoreWhitespace();
 }
 
 void TokenScanner::ignoreComments() {
-   ignoreCommentsFlag = true;
+   lexer.ignoreComments();
 }
 
 void TokenScanner::scanNumbers() {
-   scanNumbersFlag = true;
+   lexer.scanNumbers();
 }
 
 void TokenScanner::scanStrings() {
-   scanStringsFlag = true;
+   lexer.scanStrings();
 }
 
 void TokenScanner::addWordCharacters(string str) {
-   wordChars += str;
+   lexer.addWordCharacters(str);
 }
 
 void TokenScanner::addOperator(string op) {
-   StringCell *cp = new StringCell;
-   cp->str = op;
-   cp->link = operators;
-   operators = cp;
+   lexer.addOperator(op);
 }
 
 int TokenScanner::getPosition() const {
-   if (savedTokens == NULL) {
-      return int(isp->tellg());
-   } else {
-      return int(isp->tellg()) - savedTokens->str.length();
-   }
+   if (savedTokens.empty()) return lexer.getPosition();
+   if (savedTokens.size() == 1) return lexer.getPosition() - savedTokens.back().length();
    return -1;
 }
 
 bool TokenScanner::isWordCharacter(char ch) const {
-   return isalnum(ch) || wordChars.find(ch) != string::npos;
+   return lexer.isWordCharacter(ch);
 };
 
 void TokenScanner::verifyToken(string expected) {
@@ -230,185 +428,9 @@ string TokenScanner::getStringValue(string token) const {
 }
 
 int TokenScanner::getChar() {
-   return isp->get();
-}
-
-void TokenScanner::ungetChar(int ch) {
-   isp->unget();
-}
-
-/* Private methods */
-
-void TokenScanner::initScanner() {
-   ignoreWhitespaceFlag = false;
-   ignoreCommentsFlag = false;
-   scanNumbersFlag = false;
-   scanStringsFlag = false;
-   operators = NULL;
-}
-
-/*
- * Implementation notes: skipSpaces
- * --------------------------------
- * Advances the position of the scanner until the current character is
- * not a whitespace character.
- */
-
-void TokenScanner::skipSpaces() {
-   while (true) {
-      int ch = isp->get();
-      if (ch == EOF) return;
-      if (!isspace(ch)) {
-         isp->unget();
-         return;
-      }
-   }
-}
-
-/*
- * Implementation notes: scanWord
- * ------------------------------
- * Reads characters until the scanner reaches the end of a sequence
- * of word characters.
- */
-
-string TokenScanner::scanWord() {
-   string token = "";
-   while (true) {
-      int ch = isp->get();
-      if (ch == EOF) break;
-      if (!isWordCharacter(ch)) {
-         isp->unget();
-         break;
-      }
-      token += char(ch);
-   }
-   return token;
-}
-
-/*
- * Implementation notes: scanNumber
- * --------------------------------
- * Reads characters until the scanner reaches the end of a legal number.
- * The function operates by simulating what computer scientists
- * call a finite-state machine.  The program uses the variable
- * <code>state</code> to record the history of the process and
- * determine what characters would be legal at this point in time.
- */
-
-string TokenScanner::scanNumber() {
-   string token = "";
-   NumberScannerState state = INITIAL_STATE;
-   while (state != FINAL_STATE) {
-      int ch = isp->get();
-      int xch = 'e';
-      switch (state) {
-       case INITIAL_STATE:
-         if (!isdigit(ch)) {
-            error("Internal error: illegal call to scanNumber");
-         }
-         state = BEFORE_DECIMAL_POINT;
-         break;
-       case BEFORE_DECIMAL_POINT:
-         if (ch == '.') {
-            state = AFTER_DECIMAL_POINT;
-         } else if (ch == 'E' || ch == 'e') {
-            state = STARTING_EXPONENT;
-            xch = ch;
-         } else if (!isdigit(ch)) {
-            if (ch != EOF) isp->unget();
-            state = FINAL_STATE;
-         }
-         break;
-       case AFTER_DECIMAL_POINT:
-         if (ch == 'E' || ch == 'e') {
-            state = STARTING_EXPONENT;
-            xch = ch;
-         } else if (!isdigit(ch)) {
-            if (ch != EOF) isp->unget();
-            state = FINAL_STATE;
-         }
-         break;
-       case STARTING_EXPONENT:
-         if (ch == '+' || ch == '-') {
-            state = FOUND_EXPONENT_SIGN;
-         } else if (isdigit(ch)) {
-            state = SCANNING_EXPONENT;
-         } else {
-            if (ch != EOF) isp->unget();
-            isp->unget();
-            state = FINAL_STATE;
-         }
-         break;
-       case FOUND_EXPONENT_SIGN:
-         if (isdigit(ch)) {
-            state = SCANNING_EXPONENT;
-         } else {
-            if (ch != EOF) isp->unget();
-            isp->unget();
-            isp->unget();
-            state = FINAL_STATE;
-         }
-         break;
-       case SCANNING_EXPONENT:
-         if (!isdigit(ch)) {
-            if (ch != EOF) isp->unget();
-            state = FINAL_STATE;
-         }
-         break;
-       default:
-         state = FINAL_STATE;
-         break;
-      }
-      if (state != FINAL_STATE) {
-         token += char(ch);
-      }
-   }
-   return token;
-}
-
-/*
- * Implementation notes: scanString
- * --------------------------------
- * Reads and returns a quoted string from the scanner, continuing until
- * it scans the matching delimiter.  The scanner generates an error if
- * there is no closing quotation mark before the end of the input.
- */
-
-string TokenScanner::scanString() {
-   string token = "";
-   char delim = isp->get();
-   token += delim;
-   bool escape = false;
-   while (true) {
-      int ch = isp->get();
-      if (ch == EOF) error("TokenScanner found unterminated string");
-      if (ch == delim && !escape) break;
-      escape = (ch == '\\') && !escape;
-      token += ch;
-   }
-   return token + delim;
-}
-
-/*
- * Implementation notes: isOperator, isOperatorPrefix
- * --------------------------------------------------
- * These methods search the list of operators and return true if the
- * specified operator is either in the list or a prefix of an operator
- * in the list, respectively.  This code could be made considerably more
- * efficient by implementing operators as a trie.
- */
-
-bool TokenScanner::isOperator(string op) {
-   for (StringCell *cp = operators; cp != NULL; cp = cp->link) {
-      if (op == cp->str) return true;
-   }
-   return false;
+   return lexer.getChar();
 }
 
-bool TokenScanner::isOperatorPrefix(string op) {
-   for (StringCell *cp = operators; cp != NULL; cp = cp->link) {
-      if (startsWith(cp->str, op)) return true;
-   }
-   return false;
+void TokenScanner::ungetChar(int) {
+   lexer.ungetChar();
 }
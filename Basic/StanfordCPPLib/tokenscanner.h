@@ -10,6 +10,7 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 #include "private/tokenpatch.h"
 
 /*
@@ -21,6 +22,150 @@
 
 enum TokenType { SEPARATOR, WORD, NUMBER, STRING, OPERATOR };
 
+/*
+ * Type: Token
+ * -----------
+ * A token read by a <code>Lexer</code>.  The token does not own its
+ * characters: <code>text</code> points into the buffer the lexer is
+ * reading, so the token is valid only as long as that buffer is.  At
+ * the end of the input, <code>length</code> is 0 and <code>type</code>
+ * is <code>EOF</code>, as <code>TokenScanner::getTokenType</code>
+ * returns for the empty string.
+ */
+
+struct Token {
+   const char *text;
+   int length;
+   TokenType type;
+
+/*
+ * Methods: equals, toString
+ * Usage: if (token.equals("=")) ...
+ *        string str = token.toString();
+ * -------------------------------------
+ * <code>equals</code> compares the token with a C string without
+ * allocating; <code>toString</code> returns an owned copy.
+ */
+
+   bool equals(const char *str) const;
+   std::string toString() const;
+};
+
+/*
+ * Class: Lexer
+ * ------------
+ * This class splits a buffer into the same tokens as
+ * <code>TokenScanner</code>, but never allocates while it scans: it
+ * borrows the caller's characters and returns each token as a
+ * <code>Token</code> view with its type already known.  It is meant for
+ * code that scans many short strings, such as an interpreter reading
+ * program lines:
+ *
+ *<pre>
+ *    Lexer lexer;
+ *    lexer.ignoreWhitespace();
+ *    lexer.setInput(line);
+ *    for (Token t = lexer.next(); t.length > 0; t = lexer.next()) {
+ *       ... process t ...
+ *    }
+ *</pre>
+ *
+ * The options have the same meaning as the <code>TokenScanner</code>
+ * methods of the same name.  Only setting them up may allocate.
+ */
+
+class Lexer {
+
+public:
+
+/*
+ * Constructor: Lexer
+ * Usage: Lexer lexer;
+ *        Lexer lexer(text, length);
+ * ---------------------------------
+ * Initializes a lexer with all options off, reading the specified
+ * characters or nothing.
+ */
+
+   Lexer();
+   Lexer(const char *text, int length);
+
+/*
+ * Method: setInput
+ * Usage: lexer.setInput(text, length);
+ *        lexer.setInput(str);
+ * -----------------------------------
+ * Starts reading the specified characters, which must stay unchanged
+ * while the lexer uses them.  The string form borrows the buffer of
+ * <code>str</code>.
+ */
+
+   void setInput(const char *text, int length);
+   void setInput(const std::string & str);
+
+/*
+ * Methods: next, peek, hasMoreTokens
+ * Usage: Token token = lexer.next();
+ * ----------------------------------
+ * <code>next</code> reads the next token, <code>peek</code> returns it
+ * without consuming it, and <code>hasMoreTokens</code> returns
+ * <code>true</code> unless the input is exhausted.
+ */
+
+   Token next();
+   Token peek();
+   bool hasMoreTokens();
+
+/*
+ * Methods: getPosition, getChar, ungetChar
+ * ----------------------------------------
+ * Work on the characters directly, like the <code>TokenScanner</code>
+ * methods of the same names.  A token read by <code>peek</code> and
+ * not yet consumed is read again after them.
+ */
+
+   int getPosition() const;
+   int getChar();
+   void ungetChar();
+
+/*
+ * Methods: ignoreWhitespace, ignoreComments, scanNumbers, scanStrings,
+ *          addWordCharacters, addOperator, isWordCharacter
+ * --------------------------------------------------------------------
+ * Set up the lexer as the matching <code>TokenScanner</code> methods
+ * do.
+ */
+
+   void ignoreWhitespace();
+   void ignoreComments();
+   void scanNumbers();
+   void scanStrings();
+   void addWordCharacters(const std::string & str);
+   void addOperator(const std::string & op);
+   bool isWordCharacter(char ch) const;
+
+private:
+
+   const char *begin;               /* The borrowed input           */
+   const char *cursor;              /* The next character to read   */
+   const char *end;
+   const char *peekEnd;             /* Where a peeked token ends    */
+   Token peeked;                    /* Valid if peekEnd is not NULL */
+   bool ignoreWhitespaceFlag;
+   bool ignoreCommentsFlag;
+   bool scanNumbersFlag;
+   bool scanStringsFlag;
+   bool wordTable[256];             /* Word characters by code      */
+   std::vector<std::string> operators;
+
+   void initLexer();
+   Token scan();
+   Token makeToken(const char *start) const;
+   void skipNumber();
+   void skipString();
+
+};
+
 /*
  * Class: TokenScanner
  * -------------------
@@ -75,7 +220,8 @@ public:
  *        scanner.setInput(infile);
  * --------------------------------
  * Sets the token stream for this scanner to the specified string or
- * input stream.  Any previous token stream is discarded.
+ * input stream.  Any previous token stream is discarded.  A stream is
+ * read to its end at once, since the scanner works on a buffer.
  */
 
    void setInput(std::string str);
@@ -296,50 +442,20 @@ void ungetChar(int ch);
 private:
 
 /*
- * Private type: StringCell
- * ------------------------
- * This type is used to construct linked lists of cells, which are used
- * to represent both the stack of saved tokens and the set of defined
- * operators.  These types cannot use the Stack and Lexicon classes
- * directly because tokenscanner.h is an extremely low-level interface,
- * and doing so would create circular dependencies in the .h files.
+ * Implementation notes: private data
+ * ----------------------------------
+ * The scanner is a wrapper around a <code>Lexer</code> reading the
+ * scanner's own copy of the input.  Saved tokens are kept in a vector,
+ * whose storage is reused from one call to the next, and
+ * <code>hasMoreTokens</code> peeks instead of saving a token.
  */
 
-   struct StringCell {
-      std::string str;
-      StringCell *link;
-   };
-
-   enum NumberScannerState {
-      INITIAL_STATE,
-      BEFORE_DECIMAL_POINT,
-      AFTER_DECIMAL_POINT,
-      STARTING_EXPONENT,
-      FOUND_EXPONENT_SIGN,
-      SCANNING_EXPONENT,
-      FINAL_STATE
-   };
-
-   std::string buffer;              /* The original argument string */
-   std::istream *isp;               /* The input stream for tokens  */
-   bool stringInputFlag;            /* Flag indicating string input */
-   bool ignoreWhitespaceFlag;       /* Scanner ignores whitespace   */
-   bool ignoreCommentsFlag;         /* Scanner ignores comments     */
-   bool scanNumbersFlag;            /* Scanner parses numbers       */
-   bool scanStringsFlag;            /* Scanner parses strings       */
-   std::string wordChars;           /* Additional word characters   */
-   StringCell *savedTokens;         /* Stack of saved tokens        */
-   StringCell *operators;           /* List of multichar operators  */
-
-/* Private method prototypes */
-
-   void initScanner();
-   void skipSpaces();
-   std::string scanWord();
-   std::string scanNumber();
-   std::string scanString();
-   bool isOperator(std::string op);
-   bool isOperatorPrefix(std::string op);
+   std::string buffer;                       /* The input being scanned */
+   Lexer lexer;                              /* Scans buffer            */
+   std::vector<std::string> savedTokens;     /* Stack of saved tokens   */
+
+   TokenScanner(const TokenScanner &);
+   TokenScanner & operator=(const TokenScanner &);
 
 };
 
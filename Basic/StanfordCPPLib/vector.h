@@ -12,6 +12,7 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <utility>
 #include "foreach.h"
 #include "strlib.h"
 
@@ -111,7 +112,20 @@ public:
  * up to and including the length of the vector.
  */
 
-   void insert(int index, ValueType value);
+   void insert(int index, const ValueType & value);
+   void insert(int index, ValueType && value);
+
+/*
+ * Method: emplace
+ * Usage: vec.emplace(index, args...);
+ * -----------------------------------
+ * Inserts a value built from the constructor arguments args before the
+ * specified index, as <code>insert</code> does, moving it into place
+ * instead of copying it.
+ */
+
+   template <typename... ArgTypes>
+   void emplace(int index, ArgTypes &&... args);
 
 /*
  * Method: remove
@@ -130,11 +144,35 @@ public:
  * ----------------------
  * Adds a new value to the end of this vector.  To ensure compatibility
  * with the <code>vector</code> class in the Standard Template Library,
- * this method is also called <code>push_back</code>.
+ * this method is also called <code>push_back</code>.  A value that is
+ * about to disappear, such as a temporary, is moved instead of copied.
  */
 
-   void add(ValueType value);
-   void push_back(ValueType value);
+   void add(const ValueType & value);
+   void add(ValueType && value);
+   void push_back(const ValueType & value);
+   void push_back(ValueType && value);
+
+/*
+ * Method: emplace_back
+ * Usage: vec.emplace_back(args...);
+ * ---------------------------------
+ * Adds a value built from the constructor arguments args to the end of
+ * this vector.
+ */
+
+   template <typename... ArgTypes>
+   void emplace_back(ArgTypes &&... args);
+
+/*
+ * Method: reserve
+ * Usage: vec.reserve(n);
+ * ----------------------
+ * Makes room for at least <code>n</code> elements, so that the vector
+ * does not have to grow again until it holds more than that.
+ */
+
+   void reserve(int n);
 
 /*
  * Operator: []
@@ -210,6 +248,7 @@ public:
  *
  *   - Stream I/O using the << and >> operators
  *   - Deep copying for the copy constructor and assignment operator
+ *   - Moving for the move constructor and move assignment
  *   - Iteration using the range-based for statement or STL iterators
  *
  * The iteration forms process the Vector in index order.
@@ -265,6 +304,18 @@ public:
    Vector(const Vector & src);
    Vector & operator=(const Vector & src);
 
+/*
+ * Move support
+ * ------------
+ * The move constructor and move assignment take over the array of a
+ * vector that is about to disappear, such as one returned from a
+ * function, instead of copying its elements.  The vector moved from
+ * is left empty.
+ */
+
+   Vector(Vector && src);
+   Vector & operator=(Vector && src);
+
 /*
  * Operator: ,
  * -----------
@@ -480,39 +531,76 @@ void Vector<ValueType>::set(int index, const ValueType & value) {
  * -----------------------------------------
  * These methods must shift the existing elements in the array to
  * make room for a new element or to close up the space left by a
- * deleted one.
+ * deleted one.  The elements are moved, not copied.  The value to
+ * insert may be an element of this vector, as in vec.add(vec[0]), so
+ * the version taking a reference to a constant copies it before
+ * anything moves, and the other one moves it out of the way before
+ * the array is replaced.  Since the array holds constructed elements,
+ * the emplace methods build the value first and then move it in.
  */
 
 template <typename ValueType>
-void Vector<ValueType>::insert(int index, ValueType value) {
-   if (count == capacity) expandCapacity();
+void Vector<ValueType>::insert(int index, const ValueType & value) {
+   insert(index, ValueType(value));
+}
+
+template <typename ValueType>
+void Vector<ValueType>::insert(int index, ValueType && value) {
    if (index < 0 || index > count) {
       error("insert: index out of range");
    }
+   if (count == capacity) {
+      ValueType saved(std::move(value));
+      expandCapacity();
+      insert(index, std::move(saved));
+      return;
+   }
    for (int i = count; i > index; i--) {
-      elements[i] = elements[i - 1];
+      elements[i] = std::move(elements[i - 1]);
    }
-   elements[index] = value;
+   elements[index] = std::move(value);
    count++;
 }
 
+template <typename ValueType>
+template <typename... ArgTypes>
+void Vector<ValueType>::emplace(int index, ArgTypes &&... args) {
+   insert(index, ValueType(std::forward<ArgTypes>(args)...));
+}
+
 template <typename ValueType>
 void Vector<ValueType>::remove(int index) {
    if (index < 0 || index >= count) error("remove: index out of range");
    for (int i = index; i < count - 1; i++) {
-      elements[i] = elements[i + 1];
+      elements[i] = std::move(elements[i + 1]);
    }
    count--;
 }
 
 template <typename ValueType>
-void Vector<ValueType>::add(ValueType value) {
-   insert(count, value);
+void Vector<ValueType>::add(const ValueType & value) {
+   insert(count, ValueType(value));
+}
+
+template <typename ValueType>
+void Vector<ValueType>::add(ValueType && value) {
+   insert(count, std::move(value));
+}
+
+template <typename ValueType>
+void Vector<ValueType>::push_back(const ValueType & value) {
+   insert(count, ValueType(value));
+}
+
+template <typename ValueType>
+void Vector<ValueType>::push_back(ValueType && value) {
+   insert(count, std::move(value));
 }
 
 template <typename ValueType>
-void Vector<ValueType>::push_back(ValueType value) {
-   insert(count, value);
+template <typename... ArgTypes>
+void Vector<ValueType>::emplace_back(ArgTypes &&... args) {
+   insert(count, ValueType(std::forward<ArgTypes>(args)...));
 }
 
 /*
@@ -584,6 +672,28 @@ Vector<ValueType> & Vector<ValueType>::operator=(const Vector & src) {
    return *this;
 }
 
+template <typename ValueType>
+Vector<ValueType>::Vector(Vector && src) {
+   elements = src.elements;
+   capacity = src.capacity;
+   count = src.count;
+   src.elements = NULL;
+   src.capacity = src.count = 0;
+}
+
+template <typename ValueType>
+Vector<ValueType> & Vector<ValueType>::operator=(Vector && src) {
+   if (this != &src) {
+      if (elements != NULL) delete[] elements;
+      elements = src.elements;
+      capacity = src.capacity;
+      count = src.count;
+      src.elements = NULL;
+      src.capacity = src.count = 0;
+   }
+   return *this;
+}
+
 template <typename ValueType>
 void Vector<ValueType>::deepCopy(const Vector & src) {
    count = capacity = src.count;
@@ -637,21 +747,27 @@ void Vector<ValueType>::mapAll(FunctorType fn) const {
 }
 
 /*
- * Implementation notes: expandCapacity
- * ------------------------------------
- * This function doubles the array capacity, copies the old elements
- * into the new array, and then frees the old one.
+ * Implementation notes: expandCapacity, reserve
+ * ---------------------------------------------
+ * The expandCapacity function doubles the array capacity.  Both move
+ * the old elements into a new array and then free the old one.
  */
 
 template <typename ValueType>
 void Vector<ValueType>::expandCapacity() {
-   capacity = max(1, capacity * 2);
-   ValueType *array = new ValueType[capacity];
+   reserve(max(1, capacity * 2));
+}
+
+template <typename ValueType>
+void Vector<ValueType>::reserve(int n) {
+   if (n <= capacity) return;
+   ValueType *array = new ValueType[n];
    for (int i = 0; i < count; i++) {
-      array[i] = elements[i];
+      array[i] = std::move(elements[i]);
    }
    if (elements != NULL) delete[] elements;
    elements = array;
+   capacity = n;
 }
 
 /*
@@ -1,5 +1,15 @@
 #include <iostream>
 #include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 using namespace std;
@@ -13,7 +23,7 @@ const string defaultStanderBasic = "../linux-demo/Basic-Demo-32bit";
 #endif
 
 
-const int traceCount = 100;
+const int traceCount = 101;
 const string traces[traceCount] = {
   "trace00.txt", "trace01.txt", "trace02.txt", "trace03.txt", "trace04.txt", "trace05.txt", "trace06.txt", "trace07.txt", "trace08.txt", "trace09.txt", 
   "trace10.txt", "trace11.txt", "trace12.txt", "trace13.txt", "trace14.txt", "trace15.txt", "trace16.txt", "trace17.txt", "trace18.txt", "trace19.txt", 
@@ -25,23 +35,25 @@ const string traces[traceCount] = {
   "trace70.txt", "trace71.txt", "trace72.txt", "trace73.txt", "trace74.txt", "trace75.txt", "trace76.txt", "trace77.txt", "trace78.txt", "trace79.txt", 
   "trace80.txt", "trace81.txt", "trace82.txt", "trace83.txt", "trace84.txt", "trace85.txt", "trace86.txt", "trace87.txt", "trace88.txt", "trace89.txt", 
   "trace90.txt", "trace91.txt", "trace92.txt", "trace93.txt", "trace94.txt", "trace95.txt", "trace96.txt", "trace97.txt", "trace98.txt", "trace99.txt", 
+  "trace100.txt",
 };
 
 string studentBasic = "";
 string standerBasic = "";
 string traceFile = "";
-int runTraces = traceCount, currentTrace = 0;
+int runTraces = traceCount, currentTrace = 0, jobs = 1;
 bool silent = false, firstFail = false, hideError = false, useColor = true;
 
 int correct = 0, wrong = 0, total = 0;
 
 void useage(const char* progname) {
   cout
-    << progname << " [-h] [-e <your_exec>] [-s <stander_exec>] [-t <trace_file>] [-f] [-m] [-q] [-c]" << endl
+    << progname << " [-h] [-e <your_exec>] [-s <stander_exec>] [-t <trace_file>] [-j <jobs>] [-f] [-m] [-q] [-c]" << endl
     << "    -h  Show this message and quit" << endl
     << "    -e  Specify your executable file, default value: " << defaultStudentBasic << endl
     << "    -s  Specify demo executable file, default value: " << defaultStanderBasic << endl
     << "    -t  Run specified trace file" << endl
+    << "    -j  Run this many traces at once, results still in order, default value: 1" << endl
     << "    -f  Stop at first failed test" << endl
     << "    -m  Hide error message" << endl
     << "    -q  Show final score only, cannot use with -t or -f, include -m" << endl
@@ -57,12 +69,13 @@ string color(string ce) {
 void parseArguments(int argc, char** argv) {
   int c;
   opterr = 0;
-  while ((c = getopt (argc, argv, "e:s:t:fmqch")) != -1) {
+  while ((c = getopt (argc, argv, "e:s:t:j:fmqch")) != -1) {
     switch (c)
     {
       case 'e': if (studentBasic.size()) useage(argv[0]); studentBasic = optarg; break;
       case 's': if (standerBasic.size()) useage(argv[0]);standerBasic = optarg; break;
       case 't': if (traceFile.size()) useage(argv[0]); traceFile = optarg; break;
+      case 'j': jobs = atoi(optarg); if (jobs < 1) useage(argv[0]); break;
       case 'f': if (firstFail) useage(argv[0]); firstFail = true; break;
       case 'm': if (hideError) useage(argv[0]); hideError = true; break;
       case 'q': if (silent) useage(argv[0]); silent = true; break;
@@ -76,52 +89,134 @@ void parseArguments(int argc, char** argv) {
   if (standerBasic.size() == 0) standerBasic = defaultStanderBasic;
 }
 
-void clearTempFiles() {
-  int r = system("rm test_ans test_out -f");
-  (void)r;
+/*
+ * Each trace runs both programs with the trace file as stdin and their
+ * stdout read back through a pipe, so no temp file is shared and any
+ * number of traces can run at once.  The descriptors are opened
+ * close-on-exec, otherwise a child forked by another worker could hold
+ * a pipe open and delay its EOF.
+ */
+
+struct TraceResult {
+  int error;                  // 0 pass, 1 demo failed, 2 yours failed, 4 outputs differ
+  string ans, out;            // output of the demo and of your program
+  double ansTime, outTime;    // wall time in milliseconds
+};
+
+bool runProgram(const string &exec, const string &trace, string &output, double &millis) {
+  auto start = chrono::steady_clock::now();
+  output.clear();
+  millis = 0;
+  int in = open(trace.c_str(), O_RDONLY | O_CLOEXEC);
+  if (in < 0) return false;
+  int fds[2];
+  if (pipe2(fds, O_CLOEXEC) != 0) { close(in); return false; }
+  const char *args[] = { "timeout", "1", exec.c_str(), NULL };
+  pid_t pid = fork();
+  if (pid == 0) {
+    int null = open("/dev/null", O_WRONLY);
+    dup2(in, 0); dup2(fds[1], 1); dup2(null, 2);
+    execvp(args[0], (char **) args);
+    _exit(127);
+  }
+  close(in); close(fds[1]);
+  if (pid < 0) { close(fds[0]); return false; }
+  char buffer[4096];
+  ssize_t n;
+  while ((n = read(fds[0], buffer, sizeof buffer)) > 0) output.append(buffer, n);
+  close(fds[0]);
+  int status;
+  while (waitpid(pid, &status, 0) < 0) {}
+  millis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
 }
 
-int testTrace(const char* trace) {
-  clearTempFiles();
-  if (system((string() + "cat " + trace + " | timeout 1 " + standerBasic + " > test_ans 2> /dev/null").c_str()) != 0) return 1;
-  if (system((string() + "cat " + trace + " | timeout 1 " + studentBasic + " > test_out 2> /dev/null").c_str()) != 0) return 2;
-  if (system("diff test_ans test_out > /dev/null 2> /dev/null")) return 4;
-  clearTempFiles();
-  return 0;
+void testTrace(const string &trace, TraceResult &result) {
+  result.error = 0;
+  result.outTime = 0;
+  if (!runProgram(standerBasic, trace, result.ans, result.ansTime)) result.error = 1;
+  else if (!runProgram(studentBasic, trace, result.out, result.outTime)) result.error = 2;
+  else if (result.ans != result.out) result.error = 4;
 }
 
-void runTest(const string currentTrace) {
-  if (!silent) cout << "Trace \"" << currentTrace << "\" ... "; cout.flush();
-  int error = testTrace(currentTrace.c_str());
+void showFile(const string &file) {
+  FILE *f = fopen(file.c_str(), "r");
+  if (f == NULL) return;
+  char buffer[4096];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof buffer, f)) > 0) cout.write(buffer, n);
+  fclose(f);
+}
+
+void report(const string &currentTrace, const TraceResult &result) {
+  char times[64];
+  snprintf(times, sizeof times, " (demo %.1f ms, yours %.1f ms)", result.ansTime, result.outTime);
+  if (!silent) cout << "Trace \"" << currentTrace << "\" ... ";
   total++;
-  if (!error) {
-    if (!silent) cout << color("\x1b[32;1m") << "Pass" << color("\x1b[0m") << endl;
+  if (!result.error) {
+    if (!silent) cout << color("\x1b[32;1m") << "Pass" << color("\x1b[0m") << times << endl;
     correct++;
   } else {
     wrong++;
     if (!silent) {
-      cout << color("\x1b[31;1m") << "Fail" << color("\x1b[0m") << endl;
+      cout << color("\x1b[31;1m") << "Fail" << color("\x1b[0m") << times << endl;
       if (!hideError) {
-        cout << "Trace file: " << endl << color("\x1b[35m"); cout.flush();
-        int r0 = system((string() + "cat " + currentTrace).c_str()); (void)r0;
+        cout << "Trace file: " << endl << color("\x1b[35m");
+        showFile(currentTrace);
         cout << color("\x1b[0m") << endl;
-        if (error == 1) cout << color("\x1b[31m") << "Error occurred while running demo program" << color("\x1b[0m") << endl;
-        if (error == 2) cout << color("\x1b[31m") << "Error occurred while running your program" << color("\x1b[0m") << endl;
-        if (error == 4) {
-          cout << "Demo output: " << endl << color("\x1b[36m"); cout.flush();
-          int r1 = system("cat test_ans"); (void)r1;
+        if (result.error == 1) cout << color("\x1b[31m") << "Error occurred while running demo program" << color("\x1b[0m") << endl;
+        if (result.error == 2) cout << color("\x1b[31m") << "Error occurred while running your program" << color("\x1b[0m") << endl;
+        if (result.error == 4) {
+          cout << "Demo output: " << endl << color("\x1b[36m") << result.ans;
           cout << color("\x1b[0m") << endl;
-          cout << "Your output: " << endl << color("\x1b[33m"); cout.flush();
-          int r2 = system("cat test_out"); (void)r2;
+          cout << "Your output: " << endl << color("\x1b[33m") << result.out;
           cout << color("\x1b[0m") << endl;
         }
       }
     }
-    clearTempFiles();
     if (firstFail) throw exception();
   }
 }
 
+/*
+ * Workers take traces in order and park the results; the main thread
+ * reports each one as soon as it and all before it are done.  With -f
+ * the workers are told to stop and only finish what they are running.
+ */
+
+void runTests(const vector<string> &files) {
+  vector<TraceResult> results(files.size());
+  vector<char> done(files.size(), 0);
+  atomic<size_t> next(0);
+  atomic<bool> stop(false);
+  mutex lock;
+  condition_variable ready;
+  vector<thread> workers;
+  for (int k = 0; k < jobs && k < (int) files.size(); k++) {
+    workers.push_back(thread([&]() {
+      size_t i;
+      while (!stop && (i = next++) < files.size()) {
+        testTrace(files[i], results[i]);
+        lock_guard<mutex> guard(lock);
+        done[i] = 1;
+        ready.notify_all();
+      }
+    }));
+  }
+  try {
+    for (size_t i = 0; i < files.size(); i++) {
+      {
+        unique_lock<mutex> guard(lock);
+        ready.wait(guard, [&]() { return done[i] != 0; });
+      }
+      report(files[i], results[i]);
+    }
+  } catch (...) {
+    stop = true;
+  }
+  for (size_t k = 0; k < workers.size(); k++) workers[k].join();
+}
+
 void showScore() {
   int score = correct / 5 * 5;
   if (!silent)
@@ -132,13 +227,18 @@ void showScore() {
 
 int main(int argc, char** argv) {
   parseArguments(argc, argv);
-  try {
-    if (traceFile.size()) runTest(traceFile);
-    else {
-      int i = 0;
-      for (; i < traceCount; i++) runTest(traceFolder + traces[i]);
-    }
-  } catch (...) {}
+  auto start = chrono::steady_clock::now();
+  vector<string> files;
+  if (traceFile.size()) files.push_back(traceFile);
+  else {
+    int i = 0;
+    for (; i < traceCount; i++) files.push_back(traceFolder + traces[i]);
+  }
+  runTests(files);
+  if (!silent) {
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Wall time: " << seconds << " s with " << jobs << " job(s)." << endl;
+  }
   showScore();
   return 0;
 }